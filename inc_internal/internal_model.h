@@ -44,6 +44,7 @@ XX(token, model_string, none, token, __VA_ARGS__)\
 XX(id, model_string, none, id, __VA_ARGS__) \
 XX(edge_routers, ziti_edge_router, list, edgeRouters, __VA_ARGS__) \
 XX(service_id, model_string, none, serviceId, __VA_ARGS__) \
+XX(type, ziti_session_type, none, type, __VA_ARGS__) \
 XX(refresh, model_bool, none, , __VA_ARGS__)
 
 #define ZITI_PROCESS_MODEL(XX, ...) \
@@ -226,6 +227,8 @@ XX(name, model_string, none, name, __VA_ARGS__) \
 XX(apis, ctrl_apis, none, apiAddresses, __VA_ARGS__) \
 XX(is_online, model_bool, none, isOnline, __VA_ARGS__) \
 XX(offline_time, model_number, none, , __VA_ARGS__) \
+XX(latency, model_number, none, , __VA_ARGS__) \
+XX(failures, model_number, none, , __VA_ARGS__) \
 XX(cert_pem, model_string, none, certPem, __VA_ARGS__) \
 XX(fingerprint, model_string, none, fingerprint, __VA_ARGS__)
 
@@ -108,6 +108,11 @@ message *message_new(pool_t *pool, uint32_t content, const hdr_t *headers, int n
 
 void message_set_seq(message *m, uint32_t *seq);
 
+/**
+ * copy message out of (limited) pool, so that it can be held for later processing
+ */
+message *message_clone(message *m);
+
 message* new_inspect_result(uint32_t req_seq, uint32_t conn_id, connection_type_t type, const char *msg, size_t msglen);
 
 #ifdef __cplusplus
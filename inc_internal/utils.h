@@ -69,6 +69,8 @@ void ziti_fmt_time(char *time_str, size_t time_str_len, uv_timeval64_t *tv);
 
 int lt_zero(int v);
 
+int non_zero(int v);
+
 typedef const char *(*fmt_error_t)(int);
 
 typedef int *(*cond_error_t)(int);
@@ -39,17 +39,41 @@ typedef void (*ctrl_version_cb)(const ziti_version *, const ziti_error *, void *
 
 typedef void(*routers_cb)(ziti_service_routers *srv_routers, const ziti_error *, void *);
 
+#define CTRL_LATENCY_SAMPLES 32
+
 typedef struct ziti_controller_s {
     uv_loop_t *loop;
     tlsuv_http_t *client;
+    tls_context *tls;
 
     char *url;
     model_map endpoints;
 
+    // HA endpoint latency probes
+    uint64_t last_probe;
+    model_list probes;
+
+    // recent response latencies(ms) of the current endpoint
+    uint64_t latency_samples[CTRL_LATENCY_SAMPLES];
+    unsigned int latency_count;
+
+    // hedged requests are sent to the next fastest endpoint
+    bool hedging;
+    char *auth_header;
+    char *session_token;
+    tlsuv_http_t *hedge_client;
+    char *hedge_url;
+    unsigned int hedge_reqs;
+
     unsigned int active_reqs;
+    // map<method+path,ctrl_resp> -- GET requests in flight, identical requests join them
+    model_map inflight;
+    // map<path,validator> -- ETag/Last-Modified of polled responses
+    model_map validators;
 
     // tuning options
     unsigned int page_size;
+    unsigned int page_concurrency;
 
     bool is_ha;
     ziti_version version;
@@ -73,6 +97,32 @@ int ziti_ctrl_cancel(ziti_controller *ctrl);
 
 void ziti_ctrl_set_page_size(ziti_controller *ctrl, unsigned int size);
 
+/**
+ * Sets max number of pages fetched in parallel for list requests.
+ * 1 -- fetch pages sequentially
+ */
+void ziti_ctrl_set_page_concurrency(ziti_controller *ctrl, unsigned int concurrency);
+
+/**
+ * Enables hedging of idempotent GET requests with HA controllers:
+ * if the current controller does not respond within its recent p95 latency
+ * the request is also sent to the next fastest controller, first response is used.
+ */
+void ziti_ctrl_set_hedging(ziti_controller *ctrl, bool enabled);
+
+/**
+ * hedge delay: p95 of recent single-page GET latency of the current endpoint, 0 if not enough samples yet
+ */
+uint64_t ziti_ctrl_hedge_delay(ziti_controller *ctrl);
+
+/**
+ * switch to the fastest HA endpoint if it is significantly(>30%) faster than the current one,
+ * or if the current one is failing. No-op while requests are in flight.
+ */
+void ziti_ctrl_select_ep(ziti_controller *ctrl);
+
+void ziti_ctrl_set_tls(ziti_controller *ctrl, tls_context *tls);
+
 void ziti_ctrl_set_callbacks(ziti_controller *ctrl, void *ctx,
                              ziti_ctrl_redirect_cb redirect_cb,
                              ziti_ctrl_change_cb change_cb);
@@ -81,6 +131,11 @@ int ziti_ctrl_close(ziti_controller *ctrl);
 
 void ziti_ctrl_clear_api_session(ziti_controller *ctrl);
 
+/**
+ * forget validators of polled responses, next request for each path is unconditional
+ */
+void ziti_ctrl_clear_validators(ziti_controller *ctrl);
+
 void ziti_ctrl_get_version(ziti_controller *ctrl, ctrl_version_cb cb, void *ctx);
 
 void ziti_ctrl_login(ziti_controller *ctrl, model_list *cfg_types,
@@ -105,6 +160,11 @@ void ziti_ctrl_current_api_session(ziti_controller *ctrl, void(*cb)(ziti_api_ses
 
 void ziti_ctrl_create_api_certificate(ziti_controller *ctrl, const char *csr_pem, void(*cb)(ziti_create_api_cert_resp *, const ziti_error *, void *), void *ctx);
 
+/*
+ * current identity, current edge routers, and service updates are conditional requests:
+ * if the controller reports that response has not changed since the last one
+ * the callback is invoked without data and without error.
+ */
 void ziti_ctrl_current_identity(ziti_controller *ctrl, void(*cb)(ziti_identity_data *, const ziti_error *, void *), void *ctx);
 
 void ziti_ctrl_current_edge_routers(ziti_controller *ctrl, void(*cb)(ziti_edge_router_array, const ziti_error *, void *),
@@ -118,6 +178,20 @@ void ziti_ctrl_get_services_update(ziti_controller *ctrl, void (*cb)(ziti_servic
 void ziti_ctrl_get_services(ziti_controller *ctrl, void (*srv_cb)(ziti_service_array, const ziti_error *, void *),
                             void *ctx);
 
+/**
+ * List services without their configs, enough to detect added, removed, or modified services.
+ * Edge API has no field selection, so it is still a full paged listing (posture queries included).
+ */
+void ziti_ctrl_list_services(ziti_controller *ctrl, void (*srv_cb)(ziti_service_array, const ziti_error *, void *),
+                             void *ctx);
+
+/**
+ * Get services (with configs) matching controller filter expression,
+ * e.g. `updatedAt > datetime(2024-01-01T00:00:00Z) or id in ["a","b"]`.
+ */
+void ziti_ctrl_get_services_filtered(ziti_controller *ctrl, const char *filter,
+                                     void (*srv_cb)(ziti_service_array, const ziti_error *, void *), void *ctx);
+
 void ziti_ctrl_get_service(ziti_controller *ctrl, const char *service_name,
                            void (*srv_cb)(ziti_service *, const ziti_error *, void *), void *ctx);
 
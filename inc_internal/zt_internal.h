@@ -33,11 +33,17 @@
 
 #include <sodium.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 #if !defined(UUID_STR_LEN)
 #define UUID_STR_LEN 37
 #endif
 
 #define MARKER_BIN_LEN 6
+// number of channel round trip histogram buckets
+#define CH_RTT_BUCKETS 8
 #define MARKER_CHAR_LEN sodium_base64_ENCODED_LEN(MARKER_BIN_LEN, sodium_base64_VARIANT_URLSAFE_NO_PADDING)
 
 #define ZTX_LOG(lvl, fmt, ...) ZITI_LOG(lvl, "ztx[%u] " fmt, ztx->id, ##__VA_ARGS__)
@@ -85,13 +91,29 @@ struct ziti_channel {
     uv_timer_t *timer;
 
     uint64_t latency;
+    // smoothed latency and its mean deviation(jitter), UINT64_MAX until first sample
+    // sampled from hello and latency probe round trips, probes are only sent without a recent sample
+    uint64_t rtt;
+    uint64_t rtt_var;
+    uint64_t last_rtt_sample;
+    // rtt before the channel was disconnected, 0 if it was never measured
+    uint64_t last_rtt;
+    uint32_t rtt_hist[CH_RTT_BUCKETS];
     struct waiter_s *latency_waiter;
     uint64_t last_read;
     uint64_t last_write;
     uint64_t last_write_delay;
+    // smoothed write delay
+    uint64_t write_delay;
+    // last time connection was added or removed
+    uint64_t last_used;
     size_t out_q;
     size_t out_q_bytes;
 
+    // messages held by ziti_channel_cork()
+    bool corked;
+    model_list corked_reqs;
+
     ch_state state;
     uint32_t reconnect_count;
 
@@ -114,21 +136,27 @@ struct ziti_channel {
 };
 
 struct ziti_write_req_s {
+    uv_write_t w; // channel write
     struct ziti_conn *conn;
     struct ziti_channel *ch;
     uint8_t *buf;
     size_t len;
+    // ziti_writev(): buffers are gathered into the message, len is the total
+    uv_buf_t *iov;
+    unsigned int iovcnt;
     bool eof;
     bool close;
 
     struct message_s *message;
+    bool in_place; // message from ziti_write_alloc(), sequenced and encrypted when sent
     ziti_write_cb cb;
     uint64_t start_ts;
 
     void *ctx;
 
     TAILQ_ENTRY(ziti_write_req_s) _next;
-    model_list chain;
+    // requests consolidated into this one, linked with _next
+    TAILQ_HEAD(, ziti_write_req_s) chain;
     size_t chain_len;
 };
 
@@ -144,10 +172,64 @@ struct key_exchange {
 
 int init_key_pair(struct key_pair *kp);
 
+// default number of pre-generated key pairs kept by the context, see ziti_options.key_pool_size
+#define KEY_POOL_SIZE 64
+
+struct key_pool_work_s;
+struct cache_write_s;
+
+/**
+ * get key pair for new connection from context pool,
+ * generates one in place if the pool is empty and schedules pool refill
+ */
+void ztx_get_key_pair(ziti_context ztx, struct key_pair *kp);
+
+/**
+ * refill key pool on the loop threadpool if it is running low
+ */
+void ztx_fill_key_pool(ziti_context ztx);
+
+void ztx_free_key_pool(ziti_context ztx);
+
 int init_crypto(struct key_exchange *key_ex, struct key_pair *kp, const uint8_t *peer_key, bool server);
 
 void free_key_exchange(struct key_exchange *key_ex);
 
+/**
+ * connection offers/accepts AES-256-GCM end-to-end encryption
+ */
+bool ziti_conn_offer_gcm(ziti_connection conn);
+
+// AES-256-GCM stream header: method byte followed by nonce base
+#define GCM_STREAM_HEADERBYTES (1 + crypto_aead_aes256gcm_NPUBBYTES)
+#define GCM_STREAM_ABYTES crypto_aead_aes256gcm_ABYTES
+
+/**
+ * AES-256-GCM alternative to xchacha20poly1305 secretstream,
+ * message nonce is nonce base from stream header XOR'ed with message counter
+ */
+struct gcm_stream {
+    crypto_aead_aes256gcm_state state;
+    uint8_t nonce[crypto_aead_aes256gcm_NPUBBYTES];
+    uint64_t counter;
+};
+
+/**
+ * AES-256-GCM requires hardware support (AES-NI and PCLMUL)
+ */
+bool gcm_stream_available(void);
+
+int gcm_stream_init_push(struct gcm_stream *s, uint8_t header[GCM_STREAM_HEADERBYTES], const uint8_t *key);
+
+int gcm_stream_init_pull(struct gcm_stream *s, const uint8_t header[GCM_STREAM_HEADERBYTES], const uint8_t *key);
+
+int gcm_stream_push(struct gcm_stream *s, uint8_t *c, const uint8_t *m, size_t mlen);
+
+int gcm_stream_pull(struct gcm_stream *s, uint8_t *m, unsigned long long *mlen, const uint8_t *c, size_t clen);
+
+// connection payload encryption/decryption running on the threadpool (crypto_offload option)
+struct conn_crypto_work_s;
+
 enum ziti_conn_type {
     None,
     Transport,
@@ -187,6 +269,17 @@ struct ziti_conn {
             uv_timer_t *timer;
             unsigned int attempt;
             char listener_id[32];
+
+            // batched accept
+            int accept_batch;
+            int max_pending_dials;
+            uv_idle_t *accept_idle;
+
+            // load reporting, cost is what is currently advertised to routers
+            uint16_t base_cost;
+            bool healthy;
+            ziti_load_cb load_cb;
+            uv_timer_t *load_timer;
         } server;
 
         struct {
@@ -201,6 +294,12 @@ struct ziti_conn {
 
             ziti_channel_t *channel;
             ziti_data_cb data_cb;
+            // ziti_conn_read_start(): data_cb delivers into application buffers
+            ziti_alloc_cb alloc_cb;
+            ziti_read_cb read_cb;
+            // ziti_conn_read_stop(): hold data, EOF and errors until reading is resumed
+            bool read_paused;
+            int read_err;
             conn_state state;
             bool fin_sent;
             int fin_recv; // 0 - not received, 1 - received, 2 - called app data cb
@@ -211,6 +310,18 @@ struct ziti_conn {
             uv_idle_t *flusher;
             TAILQ_HEAD(, ziti_write_req_s) wreqs;
             TAILQ_HEAD(, ziti_write_req_s) pending_wreqs;
+            // ziti_write_alloc(): map<buffer, message>
+            model_map write_bufs;
+            // completed write requests for reuse
+            TAILQ_HEAD(, ziti_write_req_s) wreq_pool;
+            unsigned int wreq_pool_count;
+
+            // write coalescing
+            size_t max_frame;
+            uint64_t coalesce_delay;
+            uint64_t coalesce_since; // when the oldest queued write was submitted
+            bool corked;
+            uv_timer_t *coalesce_timer;
 
             struct ziti_conn *parent;
             uint32_t dial_req_seq;
@@ -219,6 +330,14 @@ struct ziti_conn {
 
             crypto_secretstream_xchacha20poly1305_state crypt_o;
             crypto_secretstream_xchacha20poly1305_state crypt_i;
+            // crypto_method for each direction: outbound is negotiated, inbound is set by peer's crypto header
+            uint8_t crypt_method_o;
+            uint8_t crypt_method_i;
+            struct gcm_stream gcm_o;
+            struct gcm_stream gcm_i;
+            // offloaded encryption/decryption in progress, further messages wait for it
+            struct conn_crypto_work_s *crypt_o_work;
+            struct conn_crypto_work_s *crypt_i_work;
 
             // stats
             bool bridged;
@@ -290,15 +409,31 @@ struct ziti_ctx {
     ziti_identity_data *identity_data;
 
     bool services_loaded;
+    // initial service list is in flight together with the first update check
+    bool initial_list_pending;
     // map<name,ziti_service>
     model_map services;
     // map<service_id,ziti_session>
     model_map sessions;
 
+    // map<service_id,session_req> -- in-flight 'Dial' session requests
+    model_map session_requests;
+    // list<service_id> -- services waiting for prefetched session
+    model_list prefetch_queue;
+    unsigned int prefetch_inflight;
+
     // map<service_id,*bool>
     model_map service_forced_updates;
 
+    // list<ziti_edge_router> -- loaded from cache, connected once authenticated
+    model_list cached_routers;
+    // cache is saved with a delay after changes, on the threadpool
+    uv_timer_t *cache_timer;
+    struct cache_write_s *cache_write;
+    bool cache_dirty;
+
     char *last_update;
+    unsigned int service_refresh_count;
 
     uv_timer_t *refresh_timer;
     uv_prepare_t *prepper;
@@ -314,8 +449,18 @@ struct ziti_ctx {
     // map to make removal easier
     model_map waiting_connections;
 
+    // smoothed time(ms) for Connect reply and its mean deviation
+    uint64_t dial_time;
+    uint64_t dial_time_var;
+
     uint32_t conn_seq;
 
+    // pre-generated key pairs for encrypted connections
+    struct key_pair *key_pool;
+    unsigned int key_pool_cap;
+    unsigned int key_pool_count;
+    struct key_pool_work_s *key_pool_work;
+
     /* context wide metrics */
     uint64_t start;
     rate_t up_rate;
@@ -332,14 +477,26 @@ struct ziti_ctx {
     uv_async_t w_async;
 };
 
-#ifdef __cplusplus
-extern "C" {
-#endif
-
 ziti_controller *ztx_get_controller(ziti_context ztx);
 
 void ziti_invalidate_session(ziti_context ztx, const char *service_id, ziti_session_type type);
 
+// get or refresh 'Dial' session for the service, only one request per service is sent to controller;
+// conn (optional) is continued with process_connect() once the session is received
+void ziti_get_dial_session(ziti_context ztx, const char *service_id, ziti_connection conn);
+
+// get 'Dial' session ahead of the first dial, ztx_prefetch_next() is called once it completes;
+// returns false if request for the service is already in flight
+bool ziti_prefetch_dial_session(ziti_context ztx, const char *service_id);
+
+// issue queued session prefetch requests, up to api_page_concurrency at a time
+void ztx_prefetch_next(ziti_context ztx);
+
+void ztx_clear_session_requests(ziti_context ztx);
+
+// connect to edge router, or only add it (disconnected) if max_edge_routers channels are active
+void ztx_add_edge_router(ziti_context ztx, const char *name, const char *url);
+
 void ziti_on_channel_event(ziti_channel_t *ch, ziti_router_status status, ziti_context ztx);
 
 void ziti_force_api_session_refresh(ziti_context ztx);
@@ -350,14 +507,46 @@ int ziti_close_channels(ziti_context ztx, int err);
 
 bool ziti_channel_is_connected(ziti_channel_t *ch);
 
+/**
+ * channel is not connected and not trying to connect
+ */
+bool ziti_channel_is_disconnected(ziti_channel_t *ch);
+
 uint64_t ziti_channel_latency(ziti_channel_t *ch);
 
+/**
+ * Dial cost of the channel (lower is better): smoothed latency with its variance,
+ * penalized by outbound queue, recent write delay, and number of active connections.
+ * UINT64_MAX if channel is not connected.
+ */
+uint64_t ziti_channel_score(ziti_channel_t *ch);
+
+/**
+ * upper bound(ms) of the round trip histogram bucket, the last bucket is unbounded
+ */
+uint64_t ziti_channel_rtt_bucket(int idx);
+
+/**
+ * with max_edge_routers set, channel is disconnected when it is idle and not among the fastest
+ */
+bool ziti_channel_is_idle(ziti_channel_t *ch);
+
+/**
+ * with max_edge_routers set, disconnected channel to connect in place of `ch`, or NULL
+ */
+ziti_channel_t *ziti_channel_swap_candidate(ziti_channel_t *ch);
+
 int ziti_channel_force_connect(ziti_channel_t *ch);
 
 int ziti_channel_update_token(ziti_channel_t *ch);
 
 int ziti_channel_connect(ziti_context ztx, const char *name, const char *url);
 
+/**
+ * create channel for the edge router without connecting it
+ */
+ziti_channel_t *ziti_channel_add(ziti_context ztx, const char *name, const char *url);
+
 int ziti_channel_prepare(ziti_channel_t *ch);
 
 int ziti_channel_close(ziti_channel_t *ch, int err);
@@ -368,6 +557,8 @@ void ziti_channel_rem_receiver(ziti_channel_t *ch, uint32_t id);
 
 int ziti_channel_send_message(ziti_channel_t *ch, message *msg, struct ziti_write_req_s *ziti_write);
 
+void on_channel_send(uv_write_t *w, int status);
+
 int ziti_channel_send(ziti_channel_t *ch, uint32_t content, const hdr_t *hdrs, int nhdrs, const uint8_t *body,
                       uint32_t body_len,
                       struct ziti_write_req_s *ziti_write);
@@ -379,6 +570,18 @@ ziti_channel_send_for_reply(ziti_channel_t *ch, uint32_t content, const hdr_t *h
 
 void ziti_channel_remove_waiter(ziti_channel_t *ch, struct waiter_s *waiter);
 
+/**
+ * hold outgoing messages until ziti_channel_uncork(), and send them with a single write
+ */
+void ziti_channel_cork(ziti_channel_t *ch);
+
+void ziti_channel_uncork(ziti_channel_t *ch);
+
+/**
+ * deliver reply for the pending request to a different callback
+ */
+void ziti_channel_redirect_waiter(ziti_channel_t *ch, struct waiter_s *waiter, reply_cb cb, void *reply_ctx);
+
 int parse_enrollment_jwt(const char *token, ziti_enrollment_jwt_header *zejh, ziti_enrollment_jwt *zej, char **sig, size_t *sig_len);
 
 int load_tls(ziti_config *cfg, tls_context **tls, struct tls_credentials *creds);
@@ -391,6 +594,9 @@ void conn_inbound_data_msg(ziti_connection conn, message *msg);
 void on_write_completed(struct ziti_conn *conn, struct ziti_write_req_s *req, int status);
 
 void update_bindings(struct ziti_conn *conn);
+
+// is new terminator cost far enough from the reported one to be sent to routers
+bool terminator_cost_changed(uint16_t reported, uint16_t cost);
 const char *ziti_conn_state(ziti_connection conn);
 
 int establish_crypto(ziti_connection conn, message *msg);
@@ -406,6 +612,19 @@ void ziti_force_service_update(ziti_context ztx, const char *service_id);
 
 void ziti_services_refresh(ziti_context ztx, bool now);
 
+enum service_check {
+    SERVICES_UNCHANGED,
+    SERVICES_CHANGED,
+    // controller reported no change, but there is no change marker to trust it with
+    SERVICES_CHECK_AGAIN,
+};
+
+/**
+ * compare result of service update check with the last recorded change marker,
+ * `update` is NULL if controller reported that it was not modified
+ */
+enum service_check ztx_service_check(const char *last_update, const ziti_service_update *update);
+
 extern void ziti_send_event(ziti_context ztx, const ziti_event_t *e);
 
 void reject_dial_request(uint32_t conn_id, ziti_channel_t *ch, uint32_t req_id, const char *reason);
@@ -0,0 +1,70 @@
+// Copyright (c) 2024.  NetFoundry Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ZITI_SDK_ZTX_CACHE_H
+#define ZITI_SDK_ZTX_CACHE_H
+
+#include <ziti/model_collections.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Last known state of ziti context, persisted between runs so that services
+ * and edge routers are usable before controller round trips complete.
+ *
+ * File layout (integers are little-endian uint32):
+ *   magic "ZTXC" | version | key_len | key
+ *   { section type | record count | { record len | record } * count } * 2
+ * Records are compact JSON of the model objects.
+ *
+ * Sessions are not cached: they are bound to the API session and are not valid after restart.
+ */
+typedef struct ztx_cache_s {
+    // map<name, ziti_service>
+    model_map services;
+    // list<ziti_edge_router>
+    model_list edge_routers;
+} ztx_cache;
+
+/**
+ * Serializes cache into file content.
+ * `key` identifies the owner of the cache, read with a different key is rejected.
+ */
+char *ztx_cache_encode(const char *key, const ztx_cache *cache, size_t *len);
+
+/**
+ * Writes serialized cache to `path` atomically (via temp file and rename).
+ * Does blocking I/O -- call it from a worker thread.
+ */
+int ztx_cache_save(const char *path, const char *data, size_t len);
+
+/**
+ * Serializes and writes cache to `path`.
+ */
+int ztx_cache_write(const char *path, const char *key, const ztx_cache *cache);
+
+/**
+ * Reads cache from `path`. On error `cache` is left empty.
+ */
+int ztx_cache_read(const char *path, const char *key, ztx_cache *cache);
+
+void ztx_cache_free(ztx_cache *cache);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //ZITI_SDK_ZTX_CACHE_H
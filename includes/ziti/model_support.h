@@ -28,6 +28,7 @@
 #include <string.h>
 
 #include <json-c/json.h>
+#include <uv.h>
 
 #include "externs.h"
 #include "model_collections.h"
@@ -141,6 +142,78 @@ int parse_##T##_array(array(T) *a, const char *json, size_t len) { return model_
 int parse_##T##_list(list(T) *l, const char *json, size_t len) { return model_parse_list(l, json, len, get_##T##_meta()); }\
 void free_##T##_array(array(T) *ap) { model_free_array((void***)ap, get_##T##_meta()); }
 
+/**
+ * IMPL_MODEL_SPECIALIZED(type, model_def) -- drop-in replacement for IMPL_MODEL
+ *
+ * In addition to field metadata it generates type-specific parse/serialize/compare functions
+ * and installs them into the type's meta:
+ * - parsing iterates JSON object keys once, resolves each key with a perfect hash over field paths
+ *   (built once on first use) and stores into the field directly
+ * - serialization and comparison walk fields with compile-time offsets and pre-computed keys
+ *
+ * If perfect hash cannot be built for the type, parsing falls back to the generic meta-driven path.
+ */
+#define gen_field_id(n, memtype, modifier, p, partype) partype##_FIELD_##n,
+
+#define gen_field_parse(n, memtype, modifier, p, partype) \
+case partype##_FIELD_##n: return model_field_from_json(&((partype *)obj)->n, j, modifier##_mod, get_##memtype##_meta());
+
+#define gen_field_json(n, memtype, modifier, p, partype) \
+if (rc == 0 && sizeof(#p) > 1) rc = model_field_to_json(buf, #p, sizeof(#p) - 1, &v->n, modifier##_mod, get_##memtype##_meta(), &comma, indent, flags);
+
+#define gen_field_cmp(n, memtype, modifier, p, partype) \
+if (rc == 0) rc = model_field_cmp(&l->n, &r->n, modifier##_mod, get_##memtype##_meta());
+
+#define IMPL_MODEL_SPECIALIZED(type, model) \
+static field_meta type##_FIELDS[] =  {\
+    model(gen_field_meta, type) \
+    };                          \
+enum { model(gen_field_id, type) };   \
+static model_field_index type##_INDEX; \
+static uv_once_t type##_INDEX_ONCE = UV_ONCE_INIT; \
+static void type##_build_index(void); \
+static int type##_set_field(void *obj, int field, struct json_object *j) { \
+    switch (field) {            \
+    model(gen_field_parse, type) \
+    default: return 0;          \
+    }                           \
+}                               \
+static int type##_from_json_s(void *obj, struct json_object *j, const type_meta *m) { \
+    uv_once(&type##_INDEX_ONCE, type##_build_index); \
+    return model_from_json_indexed(obj, j, m, &type##_INDEX, type##_set_field);       \
+}                               \
+static int type##_to_json_s(const void *obj, void *buf, int indent, int flags) { \
+    const type *v = (const type *)obj;  \
+    bool comma = false;         \
+    int rc = model_json_begin(buf); \
+    model(gen_field_json, type) \
+    return rc == 0 ? model_json_end(buf, indent, flags) : rc; \
+}                               \
+static int type##_cmp_s(const void *lh, const void *rh) { \
+    if (lh == rh) return 0;     \
+    if (lh == NULL) return -1;  \
+    if (rh == NULL) return 1;   \
+    const type *l = (const type *)lh; \
+    const type *r = (const type *)rh; \
+    int rc = 0;                 \
+    model(gen_field_cmp, type)  \
+    return rc;                  \
+}                               \
+static type_meta type##_META = { \
+.name = #type, \
+.size = sizeof(type),\
+.field_count = sizeof(type##_FIELDS) / sizeof(field_meta),\
+.fields = type##_FIELDS,\
+.comparer = type##_cmp_s, \
+.jsonifier = type##_to_json_s, \
+.destroyer = NULL, \
+.from_json = type##_from_json_s, \
+};                              \
+static void type##_build_index(void) { \
+    model_build_field_index(&type##_INDEX, &type##_META); \
+}                               \
+IMPL_MODEL_FUNCS(type)
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -193,6 +266,18 @@ typedef struct type_meta {
 #define MODEL_PARSE_INVALID (-2)
 #define MODEL_PARSE_PARTIAL (-3)
 
+#define MODEL_INDEX_MAX_SLOTS 256
+
+// perfect hash of field paths to field index, used by specialized models
+typedef struct model_field_index {
+    int state; // 0 - not built, 1 - ready, -1 - perfect hash not possible
+    uint32_t seed;
+    uint32_t mask;
+    uint8_t slots[MODEL_INDEX_MAX_SLOTS]; // field index + 1, 0 - empty slot
+} model_field_index;
+
+typedef int (*model_set_field_f)(void *obj, int field, struct json_object *json);
+
 ZITI_FUNC void model_free(void *obj, const type_meta *meta);
 
 ZITI_FUNC void model_free_array(void ***ap, const type_meta *meta);
@@ -213,6 +298,17 @@ ZITI_FUNC char *model_to_json(const void *obj, const type_meta *meta, int flags,
 
 ZITI_FUNC ssize_t model_to_json_r(const void *obj, const type_meta *meta, int flags, char *outbuf, size_t max);
 
+// building blocks for IMPL_MODEL_SPECIALIZED
+ZITI_FUNC void model_build_field_index(model_field_index *idx, const type_meta *meta);
+ZITI_FUNC int model_from_json_indexed(void *obj, struct json_object *json, const type_meta *meta,
+                                      model_field_index *idx, model_set_field_f set_field);
+ZITI_FUNC int model_field_from_json(void *field, struct json_object *json, enum _field_mod mod, const type_meta *fm);
+ZITI_FUNC int model_field_to_json(void *buf, const char *key, size_t key_len, const void *field,
+                                  enum _field_mod mod, const type_meta *fm, bool *comma, int indent, int flags);
+ZITI_FUNC int model_field_cmp(const void *lh, const void *rh, enum _field_mod mod, const type_meta *fm);
+ZITI_FUNC int model_json_begin(void *buf);
+ZITI_FUNC int model_json_end(void *buf, int indent, int flags);
+
 ZITI_FUNC extern const type_meta *get_model_bool_meta();
 
 ZITI_FUNC extern const type_meta *get_model_number_meta();
@@ -227,6 +323,9 @@ ZITI_FUNC extern const type_meta *get_duration_meta();
 
 typedef struct timeval timestamp;
 
+/** parse RFC3339 timestamp (e.g. `2024-01-01T00:00:00.5Z`), returns 0 on success */
+ZITI_FUNC int model_timestamp_from_string(timestamp *t, const char *s);
+
 int model_map_compare(const model_map *lh, const model_map *rh, const type_meta *m);
 
 typedef enum {
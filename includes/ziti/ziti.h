@@ -229,7 +229,41 @@ typedef struct ziti_options_s {
     const char **config_types;
 
     unsigned int api_page_size;
+    unsigned int api_page_concurrency; // max number of pages fetched in parallel for list requests, 1 -- sequential
+    // with HA controllers, resend slow GET requests to the next fastest controller
+    bool api_request_hedging;
     long refresh_interval; //the duration in seconds between checking for updates from the controller
+    // on service update only fetch services modified since last refresh, instead of full service list
+    bool incremental_service_refresh;
+    // get dial sessions for all dialable services after service refresh, instead of on first dial,
+    // at most api_page_concurrency session requests are sent at a time
+    bool prefetch_sessions;
+    // if edge router is slow to reply to Connect, race another Connect to the next best edge router
+    bool dial_racing;
+    // keep at most this many edge routers connected (the fastest ones), others are connected on demand
+    // and disconnected when not used, 0 -- connect to all edge routers.
+    // The slowest unused channel is periodically swapped for a router that was not tried yet
+    // (or was significantly faster before), so that connected set converges on the fastest routers
+    unsigned int max_edge_routers;
+    // use AES-256-GCM instead of XChaCha20-Poly1305 for end-to-end encryption
+    // if both peers have hardware AES support
+    bool prefer_aes_gcm;
+    // encrypt/decrypt large payloads on the loop threadpool instead of the loop thread,
+    // per-connection message order is preserved
+    bool crypto_offload;
+    // number of key pairs for encrypted connections generated ahead of time on the loop threadpool,
+    // pool is refilled when it is half empty, set it above the expected burst of dials.
+    // 0 -- default(64)
+    unsigned int key_pool_size;
+
+    /**
+     * \brief path of the file to persist last known services and edge routers.
+     *
+     * If set, state from the previous run is loaded on startup, so that services are reported
+     * and edge routers connected without waiting for controller, and then reconciled.
+     * The file is updated in the background a few seconds after changes.
+     */
+    const char *cache_path;
     rate_type metrics_type; //an enum describing the metrics to collect
 
     //posture query cbs
@@ -260,6 +294,12 @@ typedef struct ziti_dial_opts_s {
     char *identity;
     void *app_data;
     size_t app_data_sz;
+    /** max size of consolidated data message, 0 -- default(31KB) */
+    size_t max_frame_size;
+    /** hold writes for up to this long (milliseconds) to consolidate them into fewer messages,
+     * 0 -- send immediately
+     */
+    unsigned int coalesce_delay_ms;
 } ziti_dial_opts;
 
 typedef struct ziti_client_ctx_s {
@@ -274,6 +314,30 @@ typedef enum ziti_terminator_precedence_e {
     PRECEDENCE_FAILED
 } ziti_terminator_precedence;
 
+/**
+ * \brief Load of hosting connection, sampled for periodic terminator updates.
+ */
+typedef struct ziti_host_load_s {
+    /** cost configured at bind time (listen options or host config) */
+    uint16_t base_cost;
+    /** accepted client connections that are still active */
+    size_t active;
+    /** dials waiting for delivery, see ziti_listen_opts.accept_batch */
+    size_t pending;
+} ziti_host_load;
+
+/**
+ * \brief Terminator cost callback.
+ *
+ * Called every ziti_listen_opts.load_report_interval seconds to let application adjust
+ * terminator cost based on its own load signals.
+ *
+ * @param serv hosting connection
+ * @param load current load of the hosting connection
+ * @return terminator cost [0..65535], negative value reports terminator as unhealthy
+ */
+typedef int (*ziti_load_cb)(ziti_connection serv, const ziti_host_load *load);
+
 typedef struct ziti_listen_opts_s {
     uint16_t terminator_cost;
     uint8_t terminator_precedence;
@@ -281,6 +345,22 @@ typedef struct ziti_listen_opts_s {
     int max_connections;
     char *identity;
     bool bind_using_edge_identity;
+    /** deliver incoming dials in batches of up to this many per router on each loop iteration,
+     * accept replies for the dials accepted inside #ziti_client_cb are sent in a single write.
+     * 0 -- deliver every dial as soon as it arrives
+     */
+    int accept_batch;
+    /** with accept_batch: max number of dials waiting for delivery per router,
+     * dials over the limit are rejected, 0 -- default(1024)
+     */
+    int max_pending_dials;
+    /** update terminator cost and health on routers every N seconds based on load of the hosting connection,
+     * cost is only updated when it differs from the last reported cost by 10% or more,
+     * 0 -- cost is only set at bind time
+     */
+    int load_report_interval;
+    /** compute terminator cost from load, if not set cost is base cost plus number of active and pending connections */
+    ziti_load_cb load_cb;
 } ziti_listen_opts;
 
 /**
@@ -302,6 +382,34 @@ typedef struct ziti_listen_opts_s {
  */
 typedef ssize_t (*ziti_data_cb)(ziti_connection conn, const uint8_t *data, ssize_t length);
 
+/**
+ * @brief Buffer allocation callback for ziti_conn_read_start().
+ *
+ * Application provides a buffer for incoming data, similar to libuv's `uv_alloc_cb`.
+ * Buffer with zero length or `NULL` base signals that application cannot accept data at this time:
+ * read callback gets `UV_ENOBUFS` and reading is stopped (as with ziti_conn_read_stop()),
+ * incoming data is buffered until application calls ziti_conn_read_start() again.
+ *
+ * @param conn The Ziti connection
+ * @param suggested_size size of the incoming data
+ * @param buf buffer to populate
+ */
+typedef void (*ziti_alloc_cb)(ziti_connection conn, size_t suggested_size, uv_buf_t *buf);
+
+/**
+ * @brief Read callback for ziti_conn_read_start().
+ *
+ * Invoked with the buffer from #ziti_alloc_cb, similar to libuv's `uv_read_cb`.
+ * `nread` is the number of bytes written into the buffer, `UV_ENOBUFS` if application did not provide
+ * a buffer (reading is stopped until ziti_conn_read_start() is called again), or error code as defined in #ZITI_ERRORS (#ZITI_EOF when peer closed the connection).
+ * Buffer may be empty on error.
+ *
+ * @param conn The Ziti connection
+ * @param nread number of bytes read or error
+ * @param buf application buffer
+ */
+typedef void (*ziti_read_cb)(ziti_connection conn, ssize_t nread, const uv_buf_t *buf);
+
 /**
  * @brief Connection callback.
  * 
@@ -606,6 +714,33 @@ extern void ziti_conn_set_data(ziti_connection conn, void *data);
 ZITI_FUNC
 extern int ziti_conn_set_data_cb(ziti_connection conn, ziti_data_cb cb);
 
+/**
+ * @brief Start reading data into application supplied buffers.
+ *
+ * This is an alternative to #ziti_data_cb that mirrors `uv_read_start()`: incoming data is decrypted or copied
+ * directly into buffers provided by \p alloc_cb, and passed to \p read_cb.
+ * Replaces data callback set by ziti_dial()/ziti_accept()/ziti_conn_set_data_cb().
+ *
+ * @param conn the #ziti_connection
+ * @param alloc_cb buffer allocation callback
+ * @param read_cb read callback
+ * @return ZITI_OK or error code
+ */
+ZITI_FUNC
+extern int ziti_conn_read_start(ziti_connection conn, ziti_alloc_cb alloc_cb, ziti_read_cb read_cb);
+
+/**
+ * @brief Stop reading data.
+ *
+ * Incoming data is buffered until reading is started again. End of stream and errors
+ * are reported to read callback after the buffered data once reading is resumed.
+ *
+ * @param conn the #ziti_connection
+ * @return ZITI_OK or error code
+ */
+ZITI_FUNC
+extern int ziti_conn_read_stop(ziti_connection conn);
+
 /**
  * @brief Get the identity of the client that initiated the #ziti_connection.
  *
@@ -776,6 +911,97 @@ extern int ziti_close_write(ziti_connection conn);
 ZITI_FUNC
 extern int ziti_write(ziti_connection conn, uint8_t *data, size_t length, ziti_write_cb write_cb, void *write_ctx);
 
+/**
+ * @brief Get a buffer for zero-copy write.
+ *
+ * Returns a buffer of at least \p len bytes, backed by an outgoing message. The application fills it and
+ * passes it to ziti_write_submit(). Data is encrypted/framed in place, so no copy is made by the SDK.
+ * A buffer that will not be submitted must be released with ziti_write_discard().
+ *
+ * Connection must be in connected state.
+ *
+ * @param conn the #ziti_connection to write data to
+ * @param len required buffer size
+ *
+ * @return buffer or NULL if connection is not in a valid state
+ */
+ZITI_FUNC
+extern uint8_t *ziti_write_alloc(ziti_connection conn, size_t len);
+
+/**
+ * @brief Send data in the buffer obtained with ziti_write_alloc().
+ *
+ * Buffer ownership is transferred to the SDK: the application must not access it after this call,
+ * regardless of the result, unless #ZITI_INVALID_STATE is returned.
+ * \p write_cb is invoked once the data is written to the wire.
+ *
+ * @param conn the #ziti_connection to write data to
+ * @param buf buffer from ziti_write_alloc()
+ * @param len number of bytes to send, up to the size of the allocated buffer
+ * @param write_cb a callback invoked after data is sent
+ * @param write_ctx additional context to be passed to the #ziti_write_cb callback
+ *
+ * @return #ZITI_OK or corresponding #ZITI_ERRORS
+ */
+ZITI_FUNC
+extern int ziti_write_submit(ziti_connection conn, uint8_t *buf, size_t len, ziti_write_cb write_cb, void *write_ctx);
+
+/**
+ * @brief Release buffer obtained with ziti_write_alloc() without sending it.
+ *
+ * @param conn the #ziti_connection
+ * @param buf buffer from ziti_write_alloc()
+ */
+ZITI_FUNC
+extern void ziti_write_discard(ziti_connection conn, uint8_t *buf);
+
+/**
+ * @brief Hold outgoing data on the connection.
+ *
+ * Data written after this call is not sent until ziti_conn_uncork() is called, or enough of it is queued
+ * to fill a message (see ziti_dial_opts.max_frame_size). This allows the application to consolidate
+ * several writes into fewer messages.
+ * ziti_close_write() and ziti_close() send held data immediately.
+ *
+ * @param conn the #ziti_connection
+ *
+ * @return #ZITI_OK or corresponding #ZITI_ERRORS
+ */
+ZITI_FUNC
+extern int ziti_conn_cork(ziti_connection conn);
+
+/**
+ * @brief Send data held by ziti_conn_cork().
+ *
+ * @param conn the #ziti_connection
+ *
+ * @return #ZITI_OK or corresponding #ZITI_ERRORS
+ */
+ZITI_FUNC
+extern int ziti_conn_uncork(ziti_connection conn);
+
+/**
+ * @brief Send data from multiple buffers to the connection peer.
+ *
+ * Same as ziti_write() but the data is gathered from the given buffers into a single message, so that callers
+ * do not have to concatenate header and payload fragments, or issue a write per fragment.
+ * The peer receives the data as if it was written with a single ziti_write() call.
+ *
+ * The buffers array is copied, but the data it points to must not be freed until the #ziti_write_cb callback
+ * is invoked. Callback is invoked once with total number of bytes written.
+ *
+ * @param conn the #ziti_connection used to write data to
+ * @param bufs array of data buffers
+ * @param nbufs number of buffers in the array
+ * @param write_cb a callback invoked after the function completes indicating the buffers can now be reclaimed
+ * @param write_ctx additional context to be passed to the #ziti_write_cb callback
+ *
+ * @return #ZITI_OK or corresponding #ZITI_ERRORS
+ */
+ZITI_FUNC
+extern int ziti_writev(ziti_connection conn, const uv_buf_t bufs[], unsigned int nbufs,
+                       ziti_write_cb write_cb, void *write_ctx);
+
 /**
  * @brief Bridge [ziti_connection] to a given IO stream
  *
@@ -26,6 +26,8 @@
 
 #define DEFAULT_MAX_BINDINGS 3
 #define REBIND_DELAY 1000
+#define DEFAULT_MAX_PENDING_DIALS 1024
+#define COST_CHANGE_THRESHOLD 10 // percent of reported cost
 
 #define CONN_LOG(lvl, fmt, ...) \
 ZITI_LOG(lvl, "server[%u.%u](%s) " fmt, \
@@ -45,6 +47,10 @@ struct binding_s {
     struct key_pair key_pair;
     enum bind_state state;
     struct waiter_s *waiter;
+
+    // dials waiting for batched delivery
+    TAILQ_HEAD(, message_s) dials;
+    int pending;
 };
 
 
@@ -66,7 +72,24 @@ static void session_cb(ziti_session *session, const ziti_error *err, void *ctx);
 
 static void notify_status(struct ziti_conn *conn, int err);
 
+static void process_pending_dials(uv_idle_t *idle);
+
+static void report_load(uv_timer_t *t);
+
+static void drop_pending_dials(struct binding_s *b) {
+    while (!TAILQ_EMPTY(&b->dials)) {
+        message *m = TAILQ_FIRST(&b->dials);
+        TAILQ_REMOVE(&b->dials, m, _next);
+        if (b->ch && ziti_channel_is_connected(b->ch)) {
+            reject_dial_request(b->conn_id, b->ch, m->header.seq, "binding is closing");
+        }
+        pool_return_obj(m);
+    }
+    b->pending = 0;
+}
+
 static void free_binding(struct binding_s *b) {
+    drop_pending_dials(b);
     free(b);
 }
 
@@ -84,12 +107,32 @@ int ziti_bind(ziti_connection conn, const char *service, const ziti_listen_opts
     uv_random(NULL, NULL, conn->server.listener_id, sizeof(conn->server.listener_id), 0 , NULL);
     conn->server.cost = get_terminator_cost(listen_opts, service, conn->ziti_ctx);
     conn->server.precedence = get_terminator_precedence(listen_opts, service, conn->ziti_ctx);
+    conn->server.base_cost = conn->server.cost;
+    conn->server.healthy = true;
     conn->server.max_bindings = listen_opts && listen_opts->max_connections > 0 ?
                                 listen_opts->max_connections : DEFAULT_MAX_BINDINGS;
     conn->server.timer = calloc(1, sizeof(uv_timer_t));
     conn->server.timer->data = conn;
     uv_timer_init(conn->ziti_ctx->loop, conn->server.timer);
 
+    if (listen_opts && listen_opts->accept_batch > 0) {
+        conn->server.accept_batch = listen_opts->accept_batch;
+        conn->server.max_pending_dials = listen_opts->max_pending_dials > 0 ?
+                                         listen_opts->max_pending_dials : DEFAULT_MAX_PENDING_DIALS;
+        conn->server.accept_idle = calloc(1, sizeof(uv_idle_t));
+        conn->server.accept_idle->data = conn;
+        uv_idle_init(conn->ziti_ctx->loop, conn->server.accept_idle);
+    }
+
+    if (listen_opts && listen_opts->load_report_interval > 0) {
+        uint64_t interval = (uint64_t) listen_opts->load_report_interval * 1000;
+        conn->server.load_cb = listen_opts->load_cb;
+        conn->server.load_timer = calloc(1, sizeof(uv_timer_t));
+        conn->server.load_timer->data = conn;
+        uv_timer_init(conn->ziti_ctx->loop, conn->server.load_timer);
+        uv_timer_start(conn->server.load_timer, report_load, interval, interval);
+    }
+
     if (listen_opts) {
         if (listen_opts->bind_using_edge_identity) {
             conn->server.identity = strdup(conn->ziti_ctx->identity_data->name);
@@ -117,6 +160,7 @@ static struct binding_s* new_binding(struct ziti_conn *conn) {
     b->conn_id = conn->conn_id;
     b->conn = conn;
     b->state = st_unbound;
+    TAILQ_INIT(&b->dials);
     init_key_pair(&b->key_pair);
     return b;
 }
@@ -377,6 +421,18 @@ static int dispose(ziti_connection server) {
         server->server.timer = NULL;
     }
 
+    if (server->server.load_timer != NULL) {
+        server->server.load_timer->data = NULL;
+        uv_close((uv_handle_t *) server->server.load_timer, (uv_close_cb) free);
+        server->server.load_timer = NULL;
+    }
+
+    if (server->server.accept_idle != NULL) {
+        server->server.accept_idle->data = NULL;
+        uv_close((uv_handle_t *) server->server.accept_idle, (uv_close_cb) free);
+        server->server.accept_idle = NULL;
+    }
+
     FREE(server->server.token);
     free_ziti_session_ptr(server->server.session);
     model_list_clear(&server->server.routers, (void (*)(void *)) free_ziti_edge_router_ptr);
@@ -435,6 +491,13 @@ static void process_dial(struct binding_s *b, message *msg) {
             ziti_close(client, NULL);
             return;
         }
+
+        // dialer can receive AES-256-GCM stream
+        int32_t method = CryptoMethodLibsodium;
+        if (message_get_int32_header(msg, CryptoMethodHeader, &method) &&
+            method == CryptoMethodAES256GCM && ziti_conn_offer_gcm(client)) {
+            client->crypt_method_o = CryptoMethodAES256GCM;
+        }
     }
     client->state = Accepting;
     client->channel = b->ch;
@@ -457,6 +520,148 @@ static void process_dial(struct binding_s *b, message *msg) {
 
 }
 
+static void queue_dial(struct binding_s *b, message *msg) {
+    struct ziti_conn *conn = b->conn;
+    if (b->pending >= conn->server.max_pending_dials) {
+        CONN_LOG(WARN, "rejecting dial: %d dials pending on router[%s]", b->pending, b->ch->name);
+        reject_dial_request(conn->conn_id, b->ch, msg->header.seq, "too many pending dials");
+        pool_return_obj(msg);
+        return;
+    }
+
+    // holding on to channel's pooled message would stall reading from the router
+    message *copy = message_clone(msg);
+    if (copy == NULL) {
+        CONN_LOG(ERROR, "failed to queue dial");
+        reject_dial_request(conn->conn_id, b->ch, msg->header.seq, "failed to queue dial");
+        pool_return_obj(msg);
+        return;
+    }
+    pool_return_obj(msg);
+
+    TAILQ_INSERT_TAIL(&b->dials, copy, _next);
+    b->pending++;
+    if (!uv_is_active((const uv_handle_t *) conn->server.accept_idle)) {
+        uv_idle_start(conn->server.accept_idle, process_pending_dials);
+    }
+}
+
+// deliver dials received since last loop iteration,
+// accept replies sent from client_cb are written to each router in one go
+static void process_pending_dials(uv_idle_t *idle) {
+    struct ziti_conn *conn = idle->data;
+    bool more = false;
+
+    const char *id;
+    struct binding_s *b;
+    MODEL_MAP_FOREACH(id, b, &conn->server.bindings) {
+        if (TAILQ_EMPTY(&b->dials)) continue;
+
+        ziti_channel_t *ch = b->ch;
+        if (ch == NULL) {
+            drop_pending_dials(b);
+            continue;
+        }
+
+        ziti_channel_cork(ch);
+        int count = 0;
+        while (!TAILQ_EMPTY(&b->dials) && count < conn->server.accept_batch) {
+            message *msg = TAILQ_FIRST(&b->dials);
+            TAILQ_REMOVE(&b->dials, msg, _next);
+            b->pending--;
+            process_dial(b, msg);
+            pool_return_obj(msg);
+            count++;
+        }
+        ziti_channel_uncork(ch);
+        CONN_LOG(DEBUG, "delivered %d dials from router[%s], %d pending", count, ch->name, b->pending);
+
+        more = more || !TAILQ_EMPTY(&b->dials);
+    }
+
+    if (!more) {
+        uv_idle_stop(idle);
+    }
+}
+
+static void send_cost(struct binding_s *b) {
+    struct ziti_conn *conn = b->conn;
+    int32_t conn_id = htole32(conn->conn_id);
+    uint16_t cost = htole16(conn->server.cost);
+    hdr_t headers[] = {
+            var_header(ConnIdHeader, conn_id),
+            var_header(CostHeader, cost),
+    };
+    CONN_LOG(DEBUG, "updating terminator cost[%u] on router[%s]", conn->server.cost, b->ch->name);
+    ziti_channel_send(b->ch, ContentTypeUpdateBind, headers, 2, NULL, 0, NULL);
+}
+
+static void send_health(struct binding_s *b) {
+    struct ziti_conn *conn = b->conn;
+    int32_t conn_id = htole32(conn->conn_id);
+    uint8_t healthy = conn->server.healthy ? 1 : 0;
+    hdr_t headers[] = {
+            var_header(ConnIdHeader, conn_id),
+            var_header(HealthStatusHeader, healthy),
+    };
+    CONN_LOG(DEBUG, "reporting terminator %s on router[%s]", healthy ? "healthy" : "unhealthy", b->ch->name);
+    ziti_channel_send(b->ch, ContentTypeHealthEvent, headers, 2, NULL, 0, NULL);
+}
+
+// cost is only pushed to routers once it drifts far enough from the reported value,
+// so that every client coming and going does not cause an update on every router
+bool terminator_cost_changed(uint16_t reported, uint16_t cost) {
+    uint32_t delta = cost > reported ? cost - reported : reported - cost;
+    return delta > 0 && delta * 100 >= (uint32_t) reported * COST_CHANGE_THRESHOLD;
+}
+
+// sample load of the hosting connection and push cost/health changes to routers
+static void report_load(uv_timer_t *t) {
+    struct ziti_conn *conn = t->data;
+
+    ziti_host_load load = {
+            .base_cost = conn->server.base_cost,
+            .active = model_map_size(&conn->server.children),
+    };
+    bool saturated = false;
+
+    const char *id;
+    struct binding_s *b;
+    MODEL_MAP_FOREACH(id, b, &conn->server.bindings) {
+        load.pending += b->pending;
+        if (conn->server.max_pending_dials > 0 && b->pending >= conn->server.max_pending_dials) {
+            saturated = true;
+        }
+    }
+
+    uint16_t cost;
+    bool healthy;
+    if (conn->server.load_cb) {
+        int rc = conn->server.load_cb(conn, &load);
+        healthy = rc >= 0;
+        cost = healthy ? (uint16_t) MIN(rc, UINT16_MAX) : conn->server.cost;
+    } else {
+        healthy = !saturated;
+        cost = (uint16_t) MIN(load.base_cost + load.active + load.pending, UINT16_MAX);
+    }
+
+    bool cost_changed = terminator_cost_changed(conn->server.cost, cost);
+    bool health_changed = healthy != conn->server.healthy;
+    if (!cost_changed && !health_changed) return;
+
+    CONN_LOG(VERBOSE, "load active[%zd] pending[%zd]: cost[%u] %s",
+             load.active, load.pending, cost, healthy ? "healthy" : "unhealthy");
+    if (cost_changed) conn->server.cost = cost;
+    conn->server.healthy = healthy;
+
+    MODEL_MAP_FOREACH(id, b, &conn->server.bindings) {
+        if (b->state != st_bound || !ziti_channel_is_connected(b->ch)) continue;
+
+        if (cost_changed) send_cost(b);
+        if (health_changed) send_health(b);
+    }
+}
+
 static void on_message(struct binding_s *b, message *msg, int code) {
     struct ziti_conn *conn = b->conn;
     if (code != ZITI_OK) {
@@ -479,6 +684,11 @@ static void on_message(struct binding_s *b, message *msg, int code) {
                 schedule_rebind(conn);
                 break;
             case ContentTypeDial:
+                if (conn->server.accept_batch > 0) {
+                    // message is released once dial is delivered
+                    queue_dial(b, msg);
+                    return;
+                }
                 process_dial(b, msg);
                 break;
             case ContentTypeConnInspectRequest:
@@ -503,6 +713,11 @@ static void bind_reply_cb(void *ctx, message *msg, int code) {
         ziti_channel_add_receiver(b->ch, conn->conn_id, b,
                                   (void (*)(void *, message *, int)) on_message);
         b->state = st_bound;
+
+        // bind request carries current cost, health is only reported once it goes bad
+        if (!conn->server.healthy) {
+            send_health(b);
+        }
     } else {
         CONN_LOG(DEBUG, "failed to bind on router[%s]", b->ch->name);
         ziti_channel_rem_receiver(b->ch, conn->conn_id);
@@ -536,8 +751,9 @@ int start_binding(struct binding_s *b, ziti_channel_t *ch) {
     int32_t conn_id = htole32(conn->conn_id);
     int32_t msg_seq = htole32(0);
     uint16_t cost = htole16(conn->server.cost);
+    int32_t crypto_method = htole32(CryptoMethodAES256GCM);
 
-    hdr_t headers[8] = {
+    hdr_t headers[9] = {
             var_header(ConnIdHeader, conn_id),
             var_header(SeqHeader, msg_seq),
             header(ListenerId, sizeof(b->conn->server.listener_id), b->conn->server.listener_id),
@@ -547,6 +763,10 @@ int start_binding(struct binding_s *b, ziti_channel_t *ch) {
     int nheaders = 4;
     if (conn->encrypted) {
         headers[nheaders++] = header(PublicKeyHeader, sizeof(b->key_pair.pk), b->key_pair.pk);
+        // advertise that this side can receive AES-256-GCM stream
+        if (ziti_conn_offer_gcm(conn)) {
+            headers[nheaders++] = var_header(CryptoMethodHeader, crypto_method);
+        }
     }
 
     if (conn->server.identity != NULL) {
@@ -598,6 +818,8 @@ void on_unbind(void *ctx, message *m, int code) {
 static void stop_binding(struct binding_s *b) {
     struct ziti_conn *conn = b->conn;
 
+    drop_pending_dials(b);
+
     // stop accepting incoming requests
     ziti_channel_rem_receiver(b->ch, b->conn_id);
     ziti_channel_remove_waiter(b->ch, b->waiter);
@@ -627,6 +849,9 @@ int ziti_close_server(struct ziti_conn *conn) {
     const char *id;
     struct binding_s *b;
     uv_timer_stop(conn->server.timer);
+    if (conn->server.load_timer) {
+        uv_timer_stop(conn->server.load_timer);
+    }
     MODEL_MAP_FOREACH(id, b, &conn->server.bindings) {
         CONN_LOG(VERBOSE, "stopping binding[%s]", id);
         stop_binding(b);
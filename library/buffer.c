@@ -212,21 +212,7 @@ int string_buf_append_urlsafe(string_buf_t *wb, const char *str) {
 }
 
 int string_buf_append(string_buf_t *wb, const char *str) {
-    const char *s = str;
-
-    copy:
-    while (*s != '\0' && wb->wp < wb->chunk + wb->chunk_size) { *wb->wp++ = *s++; }
-
-    if (*s != 0) {
-        if (wb->fixed) { return -1; }
-
-        buffer_append(wb->buf, wb->chunk, wb->wp - wb->chunk);
-        wb->chunk = malloc(wb->chunk_size);
-        wb->wp = wb->chunk;
-        goto copy;
-    }
-
-    return 0;
+    return string_buf_appendn(wb, str, strlen(str));
 }
 
 char *string_buf_to_string(string_buf_t *wb, size_t *outlen) {
@@ -35,6 +35,17 @@
 #define MAX_BACKOFF 5 /* max reconnection timeout: (1 << MAX_BACKOFF) * BACKOFF_TIME = 160 seconds */
 #define WRITE_DELAY_WARNING (1000)
 
+// channel scoring: outbound queue is charged at 1ms per SCORE_QUEUE_BYTES_PER_MS bytes,
+// each active connection adds SCORE_CONN_PENALTY ms, write delay is only considered
+// if there was a write within SCORE_WRITE_WINDOW ms
+#define SCORE_QUEUE_BYTES_PER_MS (16 * 1024)
+#define SCORE_CONN_PENALTY (2)
+#define SCORE_WRITE_WINDOW (10*1000)
+
+// with bounded edge router policy, channel without connections for this long
+// is disconnected unless it is among the fastest
+#define CHANNEL_IDLE_TIMEOUT (5*60*1000) /* 5 minutes */
+
 #define POOLED_MESSAGE_SIZE (32 * 1024)
 #define INBOUND_POOL_SIZE (32)
 
@@ -106,6 +117,8 @@ static uint32_t channel_counter = 0;
 
 struct waiter_s {
     uint32_t seq;
+    uint32_t content;
+    uint64_t sent;
     reply_cb cb;
     void *reply_ctx;
 };
@@ -167,6 +180,9 @@ static int ziti_channel_init(struct ziti_ctx *ctx, ziti_channel_t *ch, uint32_t
     ch->in_msg_pool = pool_new(POOLED_MESSAGE_SIZE, INBOUND_POOL_SIZE, (void (*)(void *)) message_free);
 
     ch->waiters = (model_map){0};
+    ch->latency = UINT64_MAX;
+    ch->rtt = UINT64_MAX;
+    ch->rtt_var = 0;
 
     ch->timer = calloc(1, sizeof(uv_timer_t));
     uv_timer_init(ch->loop, ch->timer);
@@ -241,6 +257,7 @@ void ziti_channel_add_receiver(ziti_channel_t *ch, uint32_t id, void *receiver,
     r->receive = receive_f;
 
     model_map_setl(&ch->receivers, r->id, r);
+    ch->last_used = uv_now(ch->loop);
     CH_LOG(DEBUG, "added receiver[%d]", id);
 }
 
@@ -251,6 +268,7 @@ void ziti_channel_rem_receiver(ziti_channel_t *ch, uint32_t id) {
 
     if (r) {
         CH_LOG(DEBUG, "removed receiver[%d]", id);
+        ch->last_used = uv_now(ch->loop);
         free(r);
     }
 }
@@ -259,10 +277,118 @@ bool ziti_channel_is_connected(ziti_channel_t *ch) {
     return ch->state == Connected;
 }
 
+bool ziti_channel_is_disconnected(ziti_channel_t *ch) {
+    return ch->state == Initial || ch->state == Disconnected;
+}
+
+// channel is among max_edge_routers channels with the lowest latency
+static bool is_preferred_channel(ziti_channel_t *ch) {
+    unsigned int max = ch->ztx->opts.max_edge_routers;
+    if (max == 0) {
+        return true;
+    }
+
+    unsigned int faster = 0;
+    const char *url;
+    ziti_channel_t *other;
+    MODEL_MAP_FOREACH(url, other, &ch->ztx->channels) {
+        if (other != ch && other->state == Connected && other->rtt < ch->rtt) {
+            faster++;
+        }
+    }
+    return faster < max;
+}
+
+bool ziti_channel_is_idle(ziti_channel_t *ch) {
+    return ch->ztx->opts.max_edge_routers > 0 &&
+           model_map_size(&ch->receivers) == 0 &&
+           model_map_size(&ch->waiters) == 0 &&
+           uv_now(ch->loop) - ch->last_used >= CHANNEL_IDLE_TIMEOUT &&
+           !is_preferred_channel(ch);
+}
+
+// bounded edge router policy connects routers in the order they are listed,
+// to converge on the fastest ones the slowest channel (while it has no connections)
+// is swapped for a router that was not tried yet, or for one that was significantly faster
+ziti_channel_t *ziti_channel_swap_candidate(ziti_channel_t *ch) {
+    ziti_context ztx = ch->ztx;
+    if (ztx->opts.max_edge_routers == 0 || ch->rtt == UINT64_MAX ||
+        model_map_size(&ch->receivers) > 0 || model_map_size(&ch->waiters) > 0) {
+        return NULL;
+    }
+
+    unsigned int active = 0;
+    ziti_channel_t *candidate = NULL;
+    const char *url;
+    ziti_channel_t *other;
+    MODEL_MAP_FOREACH(url, other, &ztx->channels) {
+        if (other == ch) continue;
+
+        if (!ziti_channel_is_disconnected(other)) {
+            active++;
+            // only the slowest one is swapped, and not while another one is being tried
+            if (other->state != Connected || other->rtt > ch->rtt) {
+                return NULL;
+            }
+        } else if (other->state == Initial) {
+            if (candidate == NULL || candidate->state != Initial) {
+                candidate = other;
+            }
+        } else if (other->last_rtt > 0 && other->last_rtt * 10 <= ch->rtt * 7 &&
+                   (candidate == NULL || (candidate->state != Initial && other->last_rtt < candidate->last_rtt))) {
+            candidate = other;
+        }
+    }
+
+    return active + 1 >= ztx->opts.max_edge_routers ? candidate : NULL;
+}
+
 uint64_t ziti_channel_latency(ziti_channel_t *ch) {
     return ch->latency;
 }
 
+uint64_t ziti_channel_score(ziti_channel_t *ch) {
+    if (ch->state != Connected || ch->rtt == UINT64_MAX) {
+        return UINT64_MAX;
+    }
+
+    uint64_t score = ch->rtt + 4 * ch->rtt_var;
+    score += ch->out_q_bytes / SCORE_QUEUE_BYTES_PER_MS;
+    if (ch->out_q > 0 || uv_now(ch->loop) - ch->last_write < SCORE_WRITE_WINDOW) {
+        score += ch->write_delay;
+    }
+    score += SCORE_CONN_PENALTY * model_map_size(&ch->receivers);
+    return score;
+}
+
+static const uint64_t rtt_buckets[CH_RTT_BUCKETS] = {
+        5, 10, 25, 50, 100, 250, 1000, UINT64_MAX,
+};
+
+uint64_t ziti_channel_rtt_bucket(int idx) {
+    return rtt_buckets[idx];
+}
+
+static void update_rtt(ziti_channel_t *ch, uint64_t sample) {
+    ch->latency = sample;
+    ch->last_rtt_sample = uv_now(ch->loop);
+    for (int i = 0; i < CH_RTT_BUCKETS; i++) {
+        if (sample < rtt_buckets[i]) {
+            ch->rtt_hist[i]++;
+            break;
+        }
+    }
+
+    if (ch->rtt == UINT64_MAX) {
+        ch->rtt = sample;
+        ch->rtt_var = sample / 2;
+    } else {
+        uint64_t dev = sample > ch->rtt ? sample - ch->rtt : ch->rtt - sample;
+        ch->rtt_var = (3 * ch->rtt_var + dev) / 4;
+        ch->rtt = (7 * ch->rtt + sample) / 8;
+    }
+}
+
 static ziti_channel_t *new_ziti_channel(ziti_context ztx, const char *ch_name, const char *url) {
     ziti_channel_t *ch = calloc(1, sizeof(ziti_channel_t));
     ziti_channel_init(ztx, ch, channel_counter++);
@@ -342,14 +468,14 @@ int ziti_channel_force_connect(ziti_channel_t *ch) {
         return ZITI_GATEWAY_UNAVAILABLE;
     }
 
-    if (ch->state == Disconnected) {
+    if (ch->state == Initial || ch->state == Disconnected) {
         reconnect_channel(ch, true);
     }
 
     return ZITI_OK;
 }
 
-int ziti_channel_connect(ziti_context ztx, const char *ch_name, const char *url) {
+ziti_channel_t *ziti_channel_add(ziti_context ztx, const char *ch_name, const char *url) {
     ziti_channel_t *ch = model_map_get(&ztx->channels, url);
 
     if (ch != NULL) {
@@ -359,6 +485,11 @@ int ziti_channel_connect(ziti_context ztx, const char *ch_name, const char *url)
         ch = new_ziti_channel(ztx, ch_name, url);
         ch->notify_cb(ch, EdgeRouterAdded, ch->notify_ctx);
     }
+    return ch;
+}
+
+int ziti_channel_connect(ziti_context ztx, const char *ch_name, const char *url) {
+    ziti_channel_t *ch = ziti_channel_add(ztx, ch_name, url);
 
     if (ch->state == Connecting) {
         check_connecting_state(ch);
@@ -371,7 +502,7 @@ int ziti_channel_connect(ziti_context ztx, const char *ch_name, const char *url)
 }
 
 void on_channel_send(uv_write_t *w, int status) {
-    struct ziti_write_req_s *zwreq = w->data;
+    struct ziti_write_req_s *zwreq = container_of(w, struct ziti_write_req_s, w);
 
     ziti_channel_t *ch = zwreq->ch;
     uint64_t now = uv_now(ch->loop);
@@ -387,6 +518,7 @@ void on_channel_send(uv_write_t *w, int status) {
     }
     ch->last_write = now;
     ch->last_write_delay = write_delay;
+    ch->write_delay = (7 * ch->write_delay + write_delay) / 8;
     ch->out_q--;
     ch->out_q_bytes -= zwreq->message->msgbuflen;
 
@@ -405,8 +537,6 @@ void on_channel_send(uv_write_t *w, int status) {
             on_channel_close(ch, ZITI_CONNABORT, status);
         }
     }
-
-    free(w);
 }
 
 int ziti_channel_send_message(ziti_channel_t *ch, message *msg, struct ziti_write_req_s *ziti_write) {
@@ -414,17 +544,21 @@ int ziti_channel_send_message(ziti_channel_t *ch, message *msg, struct ziti_writ
     message_set_seq(msg, &ch->msg_seq);
     CH_LOG(TRACE, "=> ct[%04X] seq[%d] len[%d]", msg->header.content, msg->header.seq, msg->header.body_len);
 
-    NEWP(req, uv_write_t);
     if (ziti_write == NULL) {
         ziti_write = calloc(1, sizeof(struct ziti_write_req_s));
     }
     ziti_write->ch = ch;
 
+    uv_write_t *req = &ziti_write->w;
     req->data = ziti_write;
     ziti_write->message = msg;
     ziti_write->start_ts = uv_now(ch->loop);
     ch->out_q++;
     ch->out_q_bytes += buf.len;
+    if (ch->corked) {
+        model_list_append(&ch->corked_reqs, ziti_write);
+        return 0;
+    }
     int rc = tlsuv_stream_write(req, ch->connection, &buf, on_channel_send);
     if (rc != 0) {
         on_channel_send(req, rc);
@@ -433,6 +567,73 @@ int ziti_channel_send_message(ziti_channel_t *ch, message *msg, struct ziti_writ
     return 0;
 }
 
+struct batch_write_s {
+    uv_write_t w;
+    model_list reqs;
+    uint8_t *buf;
+};
+
+static void on_channel_batch_send(uv_write_t *w, int status) {
+    struct batch_write_s *bw = container_of(w, struct batch_write_s, w);
+    struct ziti_write_req_s *req;
+    MODEL_LIST_FOREACH(req, bw->reqs) {
+        on_channel_send(&req->w, status);
+    }
+    model_list_clear(&bw->reqs, NULL);
+    free(bw->buf);
+    free(bw);
+}
+
+void ziti_channel_cork(ziti_channel_t *ch) {
+    ch->corked = true;
+}
+
+// held writes are never going to be sent
+static void fail_corked_writes(ziti_channel_t *ch, int status) {
+    ch->corked = false;
+    while (model_list_size(&ch->corked_reqs) > 0) {
+        struct ziti_write_req_s *req = model_list_pop(&ch->corked_reqs);
+        on_channel_send(&req->w, status);
+    }
+}
+
+void ziti_channel_uncork(ziti_channel_t *ch) {
+    if (ch->connection == NULL) {
+        CH_LOG(DEBUG, "uncorked without connection");
+        fail_corked_writes(ch, UV_ENOTCONN);
+        return;
+    }
+
+    ch->corked = false;
+    size_t count = model_list_size(&ch->corked_reqs);
+    if (count == 0) {
+        return;
+    }
+
+    NEWP(bw, struct batch_write_s);
+    size_t total = 0;
+    struct ziti_write_req_s *req;
+    MODEL_LIST_FOREACH(req, ch->corked_reqs) {
+        total += req->message->msgbuflen;
+    }
+
+    bw->buf = malloc(total);
+    uint8_t *p = bw->buf;
+    MODEL_LIST_FOREACH(req, ch->corked_reqs) {
+        memcpy(p, req->message->msgbufp, req->message->msgbuflen);
+        p += req->message->msgbuflen;
+        model_list_append(&bw->reqs, req);
+    }
+    model_list_clear(&ch->corked_reqs, NULL);
+
+    CH_LOG(TRACE, "=> sending %zd messages(%zd bytes) in one write", count, total);
+    uv_buf_t buf = uv_buf_init((char *) bw->buf, total);
+    int rc = tlsuv_stream_write(&bw->w, ch->connection, &buf, on_channel_batch_send);
+    if (rc != 0) {
+        on_channel_batch_send(&bw->w, rc);
+    }
+}
+
 int ziti_channel_send(ziti_channel_t *ch, uint32_t content, const hdr_t *hdrs, int nhdrs, const uint8_t *body,
                       uint32_t body_len,
                       struct ziti_write_req_s *ziti_write) {
@@ -452,6 +653,12 @@ void ziti_channel_remove_waiter(ziti_channel_t *ch, struct waiter_s *waiter) {
     }
 }
 
+void ziti_channel_redirect_waiter(ziti_channel_t *ch, struct waiter_s *waiter, reply_cb cb, void *reply_ctx) {
+    assert(model_map_getl(&ch->waiters, (long)waiter->seq) == waiter);
+    waiter->cb = cb;
+    waiter->reply_ctx = reply_ctx;
+}
+
 struct waiter_s *ziti_channel_send_for_reply(ziti_channel_t *ch, uint32_t content,
                                              const hdr_t *hdrs, int nhdrs,
                                              const uint8_t *body, uint32_t body_len,
@@ -470,6 +677,8 @@ struct waiter_s *ziti_channel_send_for_reply(ziti_channel_t *ch, uint32_t conten
     if (rc == ZITI_OK) {
         NEWP(w, struct waiter_s);
         w->seq = seq;
+        w->content = content;
+        w->sent = uv_now(ch->loop);
         w->cb = rep_cb;
         w->reply_ctx = reply_ctx;
         model_map_setl(&ch->waiters, (long)w->seq, w);
@@ -505,6 +714,18 @@ static bool is_edge(uint32_t content) {
     }
 }
 
+// replies that edge router produces on its own, their round trips measure the channel;
+// dial, bind, and token update replies wait for the hosting side or controller
+static bool is_rtt_sample(uint32_t content) {
+    switch (content) {
+        case ContentTypeHelloType:
+        case ContentTypeLatencyType:
+            return true;
+        default:
+            return false;
+    }
+}
+
 static void dispatch_message(ziti_channel_t *ch, message *m) {
     struct waiter_s *w = NULL;
 
@@ -516,6 +737,9 @@ static void dispatch_message(ziti_channel_t *ch, message *m) {
         w = model_map_removel(&ch->waiters, (long)reply_to);
 
         if (w) {
+            if (is_rtt_sample(w->content)) {
+                update_rtt(ch, uv_now(ch->loop) - w->sent);
+            }
             w->cb(w->reply_ctx, m, 0);
             free(w);
             pool_return_obj(m);
@@ -643,11 +867,12 @@ static void latency_reply_cb(void *ctx, message *reply, int err) {
         return;
     }
 
+    // round trip is recorded by reply dispatch
     uint64_t ts;
     if (reply->header.content == ContentTypeResultType &&
         message_get_uint64_header(reply, LatencyProbeTime, &ts)) {
-        ch->latency = uv_now(ch->loop) - ts;
-        CH_LOG(VERBOSE, "latency is now %llu", (unsigned long long)ch->latency);
+        CH_LOG(VERBOSE, "latency is now %llu (avg %llu, var %llu)", (unsigned long long)ch->latency,
+               (unsigned long long)ch->rtt, (unsigned long long)ch->rtt_var);
     } else {
         CH_LOG(WARN, "invalid latency probe result ct[%04X]", reply->header.content);
     }
@@ -673,6 +898,29 @@ static void latency_timeout(uv_timer_t *t) {
 
 static void send_latency_probe(uv_timer_t *t) {
     ziti_channel_t *ch = t->data;
+
+    if (ziti_channel_is_idle(ch)) {
+        CH_LOG(INFO, "disconnecting idle channel");
+        on_channel_close(ch, ZITI_GATEWAY_UNAVAILABLE, 0);
+        return;
+    }
+
+    ziti_channel_t *candidate = ziti_channel_swap_candidate(ch);
+    if (candidate) {
+        CH_LOG(INFO, "swapping slowest channel rtt[%" PRIu64 "ms] for ch[%d](%s) last rtt[%" PRIu64 "ms]",
+               ch->rtt, candidate->id, candidate->name, candidate->last_rtt);
+        ziti_channel_force_connect(candidate);
+        on_channel_close(ch, ZITI_GATEWAY_UNAVAILABLE, 0);
+        return;
+    }
+
+    // recent replies provided latency samples, no need to probe yet
+    uint64_t since_sample = uv_now(t->loop) - ch->last_rtt_sample;
+    if (since_sample < LATENCY_INTERVAL) {
+        uv_timer_start(t, send_latency_probe, LATENCY_INTERVAL - since_sample, 0);
+        return;
+    }
+
     uint64_t now = htole64(uv_now(t->loop));
     hdr_t headers[] = {
             {
@@ -711,11 +959,12 @@ static void hello_reply_cb(void *ctx, message *msg, int err) {
         message_get_bytes_header(msg, HelloVersionHeader, (const uint8_t **) &erVersion, &erVersionLen);
         CH_LOG(INFO, "connected. EdgeRouter version: %.*s", (int) erVersionLen, erVersion);
         ch->state = Connected;
+        // idle time is counted from connect for channels that never had connections
+        ch->last_used = uv_now(ch->loop);
         FREE(ch->version);
         ch->version = calloc(1, erVersionLen + 1);
         memcpy(ch->version, erVersion, erVersionLen);
         ch->notify_cb(ch, EdgeRouterConnected, ch->notify_ctx);
-        ch->latency = uv_now(ch->loop) - ch->latency;
         uv_timer_start(ch->timer, send_latency_probe, LATENCY_INTERVAL, 0);
     } else {
         if (msg) {
@@ -740,7 +989,6 @@ static void send_hello(ziti_channel_t *ch, const char *token) {
                 .value = &true_val,
             },
     };
-    ch->latency = uv_now(ch->loop);
     ziti_channel_send_for_reply(ch, ContentTypeHelloType, headers, 2, ch->token, strlen(ch->token), hello_reply_cb, ch);
 }
 
@@ -828,7 +1076,13 @@ static void on_channel_close(ziti_channel_t *ch, int ziti_err, ssize_t uv_err) {
     }
     ch->state = Disconnected;
 
+    if (ch->rtt != UINT64_MAX) {
+        ch->last_rtt = ch->rtt;
+    }
     ch->latency = UINT64_MAX;
+    ch->rtt = UINT64_MAX;
+    ch->rtt_var = 0;
+    ch->write_delay = 0;
     if (uv_is_active((const uv_handle_t *) &ch->timer)) {
         uv_timer_stop(ch->timer);
     }
@@ -849,6 +1103,9 @@ static void on_channel_close(ziti_channel_t *ch, int ziti_err, ssize_t uv_err) {
         free(con);
     }
 
+    // after receivers got the channel error, so it is not masked by write failures
+    fail_corked_writes(ch, UV_ECANCELED);
+
     // dump all buffered data
     free_buffer(ch->incoming);
     ch->incoming = new_buffer();
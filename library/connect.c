@@ -23,6 +23,12 @@
 static const char *INVALID_SESSION = "Invalid Session";
 static const int MAX_CONNECT_RETRY = 3;
 
+// dial racing: second Connect is sent if the first one gets no reply within
+// adaptive delay(smoothed dial time + 4 * deviation) bounded by these
+#define DIAL_RACE_DEFAULT_DELAY 250
+#define DIAL_RACE_MIN_DELAY 50
+#define DIAL_RACE_MAX_DELAY 3000
+
 #define CONN_CAP_MASK (EDGE_MULTIPART | EDGE_TRACE_UUID | EDGE_STREAM)
 #define BOOL_STR(v) ((v) ? "Y" : "N")
 
@@ -32,6 +38,10 @@ conn->marker, conn_state_str[conn->state], conn->service,                     \
 ##__VA_ARGS__)
 
 
+// default and max size of consolidated data message
+#define DEFAULT_FRAME_LEN (31 * 1024)
+#define MAX_FRAME_LEN (1024 * 1024)
+
 #define DEFAULT_DIAL_OPTS (ziti_dial_opts){ \
                  .connect_timeout_seconds = ZITI_DEFAULT_TIMEOUT/1000, \
     }
@@ -74,7 +84,14 @@ struct ziti_conn_req {
     int retry_count;
     uv_timer_t *conn_timeout;
     struct waiter_s *waiter;
+    uint64_t connect_start;
     bool failed;
+
+    // dial racing: Connect also sent to the next best channel
+    uv_timer_t *race_timer;
+    ziti_channel_t *race_ch;
+    struct waiter_s *race_waiter;
+    uint64_t race_start;
 };
 
 static void flush_connection(ziti_connection conn);
@@ -91,11 +108,42 @@ static void process_edge_message(struct ziti_conn *conn, message *msg);
 
 static bool ziti_connect(struct ziti_ctx *ztx, ziti_session *session, struct ziti_conn *conn);
 static int ziti_channel_start_connection(struct ziti_conn *conn, ziti_channel_t *ch, ziti_session *session);
+static struct waiter_s *send_connect(struct ziti_conn *conn, ziti_channel_t *ch, ziti_session *session,
+                                     reply_cb reply_f);
 
 static int ziti_disconnect(ziti_connection conn);
 
 static void restart_connect(struct ziti_conn *conn);
 
+static void stop_dial_race(struct ziti_conn *conn);
+
+void connect_reply_cb(void *ctx, message *msg, int err);
+
+// smaller payloads are cheaper to encrypt/decrypt than to hand off to the threadpool
+#define CRYPTO_OFFLOAD_MIN (8 * 1024)
+
+struct conn_crypto_work_s {
+    uv_work_t w;
+    struct ziti_conn *conn; // NULL if connection was closed while in flight
+    int rc;
+    bool gcm;
+    // copy of the stream state, worker does not touch the connection
+    crypto_secretstream_xchacha20poly1305_state crypt;
+    struct gcm_stream gcm_s;
+
+    const uint8_t *in;
+    size_t in_len;
+
+    // outbound
+    struct ziti_write_req_s *req;
+    message *msg;
+
+    // inbound
+    int32_t flags;
+    uint8_t *plain;
+    unsigned long long plain_len;
+};
+
 static void free_handle(uv_handle_t *h) {
     free(h);
 }
@@ -117,12 +165,75 @@ int ziti_conn_set_data_cb(ziti_connection conn, ziti_data_cb cb) {
     }
 
     conn->data_cb = cb;
+    conn->read_paused = false;
     if (!TAILQ_EMPTY(&conn->in_q) || buffer_available(conn->inbound) > 0) {
         flush_connection(conn);
     }
     return ZITI_OK;
 }
 
+// data_cb for ziti_conn_read_start(): copy data into application buffers
+static ssize_t conn_read_data(ziti_connection conn, const uint8_t *data, ssize_t len) {
+    if (data == NULL || len < 0) {
+        if (conn->read_paused) {
+            // reported after buffered data when reading is resumed
+            if (conn->read_err == 0) {
+                conn->read_err = (int) len;
+            }
+            return 0;
+        }
+        if (conn->read_err != 0) {
+            len = conn->read_err;
+            conn->read_err = 0;
+        }
+        uv_buf_t buf = uv_buf_init(NULL, 0);
+        conn->read_cb(conn, len, &buf);
+        return 0;
+    }
+
+    ssize_t consumed = 0;
+    while (consumed < len && conn->data_cb == conn_read_data && !conn->read_paused) {
+        uv_buf_t buf = uv_buf_init(NULL, 0);
+        conn->alloc_cb(conn, len - consumed, &buf);
+        if (buf.base == NULL || buf.len == 0) {
+            // hold the data until application resumes reading, instead of asking again on every flush
+            conn->read_paused = true;
+            conn->read_cb(conn, UV_ENOBUFS, &buf);
+            break;
+        }
+
+        size_t n = MIN(buf.len, (size_t)(len - consumed));
+        memcpy(buf.base, data + consumed, n);
+        consumed += (ssize_t) n;
+        conn->read_cb(conn, (ssize_t) n, &buf);
+    }
+    return consumed;
+}
+
+int ziti_conn_read_start(ziti_connection conn, ziti_alloc_cb alloc_cb, ziti_read_cb read_cb) {
+    if (conn == NULL || alloc_cb == NULL || read_cb == NULL) return ZITI_INVALID_STATE;
+
+    conn->alloc_cb = alloc_cb;
+    conn->read_cb = read_cb;
+    if (conn->data_cb == conn_read_data && conn->read_paused) {
+        // connection may have been closed while paused, data and error are still to be delivered
+        conn->read_paused = false;
+        flush_connection(conn);
+        return ZITI_OK;
+    }
+    return ziti_conn_set_data_cb(conn, conn_read_data);
+}
+
+int ziti_conn_read_stop(ziti_connection conn) {
+    if (conn == NULL) return ZITI_INVALID_STATE;
+
+    // keep data_cb, it is called directly on errors
+    if (conn->data_cb == conn_read_data) {
+        conn->read_paused = true;
+    }
+    return ZITI_OK;
+}
+
 static void conn_set_state(struct ziti_conn *conn, enum conn_state state) {
     CONN_LOG(VERBOSE, "transitioning %s => %s", conn_state_str[conn->state], conn_state_str[state]);
     conn->state = state;
@@ -136,6 +247,8 @@ static void clone_ziti_dial_opts(ziti_dial_opts *dest, const ziti_dial_opts *dia
 
     dest->stream = dial_opts->stream;
     dest->connect_timeout_seconds = dial_opts->connect_timeout_seconds;
+    dest->max_frame_size = dial_opts->max_frame_size;
+    dest->coalesce_delay_ms = dial_opts->coalesce_delay_ms;
     if (dial_opts->identity != NULL && dial_opts->identity[0] != '\0') {
         dest->identity = strdup(dial_opts->identity);
     }
@@ -156,6 +269,9 @@ static void free_conn_req(struct ziti_conn_req *r) {
     if (r->conn_timeout != NULL) {
         uv_close((uv_handle_t *) r->conn_timeout, free_handle);
     }
+    if (r->race_timer != NULL) {
+        uv_close((uv_handle_t *) r->race_timer, free_handle);
+    }
 
     free_ziti_dial_opts(&r->dial_opts);
     FREE(r->service_id);
@@ -173,6 +289,9 @@ static int close_conn_internal(struct ziti_conn *conn) {
             if (req->cb) {
                 req->cb(conn, ZITI_INVALID_STATE, req->ctx);
             }
+            if (req->message) {
+                pool_return_obj(req->message);
+            }
             free(req);
         }
 
@@ -181,6 +300,15 @@ static int close_conn_internal(struct ziti_conn *conn) {
             return 0;
         }
 
+        model_map_clear(&conn->write_bufs, pool_return_obj);
+
+        while (!TAILQ_EMPTY(&conn->wreq_pool)) {
+            struct ziti_write_req_s *req = TAILQ_FIRST(&conn->wreq_pool);
+            TAILQ_REMOVE(&conn->wreq_pool, req, _next);
+            free(req);
+        }
+        conn->wreq_pool_count = 0;
+
         CONN_LOG(DEBUG, "removing");
         if (conn->close_cb) {
             conn->close_cb(conn);
@@ -192,6 +320,7 @@ static int close_conn_internal(struct ziti_conn *conn) {
 
         if (conn->conn_req) {
             ziti_channel_remove_waiter(conn->channel, conn->conn_req->waiter);
+            stop_dial_race(conn);
             free_conn_req(conn->conn_req);
         }
 
@@ -201,12 +330,22 @@ static int close_conn_internal(struct ziti_conn *conn) {
 
         free_key_exchange(&conn->key_ex);
 
+        if (conn->crypt_i_work) {
+            conn->crypt_i_work->conn = NULL;
+            conn->crypt_i_work = NULL;
+        }
+
         if (conn->flusher) {
             conn->flusher->data = NULL;
             uv_close((uv_handle_t *) conn->flusher, free_handle);
             conn->flusher = NULL;
         }
 
+        if (conn->coalesce_timer) {
+            uv_close((uv_handle_t *) conn->coalesce_timer, free_handle);
+            conn->coalesce_timer = NULL;
+        }
+
         int count = 0;
         while (!TAILQ_EMPTY(&conn->in_q)) {
             message *m = TAILQ_FIRST(&conn->in_q);
@@ -231,6 +370,32 @@ static int close_conn_internal(struct ziti_conn *conn) {
     return 0;
 }
 
+// keep up to this many completed write requests per connection
+#define WRITE_REQ_POOL_MAX 32
+
+static struct ziti_write_req_s *new_write_req(struct ziti_conn *conn) {
+    struct ziti_write_req_s *req = TAILQ_FIRST(&conn->wreq_pool);
+    if (req) {
+        TAILQ_REMOVE(&conn->wreq_pool, req, _next);
+        conn->wreq_pool_count--;
+        memset(req, 0, sizeof(*req));
+    } else {
+        req = calloc(1, sizeof(struct ziti_write_req_s));
+    }
+    req->conn = conn;
+    return req;
+}
+
+static void free_write_req(struct ziti_conn *conn, struct ziti_write_req_s *req) {
+    // ziti_writev() requests carry buffer array in the same allocation, they are not reused
+    if (req->iov != NULL || conn->wreq_pool_count >= WRITE_REQ_POOL_MAX) {
+        free(req);
+        return;
+    }
+    TAILQ_INSERT_HEAD(&conn->wreq_pool, req, _next);
+    conn->wreq_pool_count++;
+}
+
 void on_write_completed(struct ziti_conn *conn, struct ziti_write_req_s *req, int status) {
     if (req->conn == NULL) {
         ZITI_LOG(DEBUG, "write completed for timed out or closed connection");
@@ -246,23 +411,24 @@ void on_write_completed(struct ziti_conn *conn, struct ziti_write_req_s *req, in
 
     TAILQ_REMOVE(&conn->pending_wreqs, req, _next);
 
-    struct ziti_write_req_s *r = req;
-    model_list_iter it = model_list_iterator(&req->chain);
-    do {
+    if (req->cb != NULL) {
+        req->cb(conn, status ? status : (ssize_t) req->len, req->ctx);
+    }
+    while (!TAILQ_EMPTY(&req->chain)) {
+        struct ziti_write_req_s *r = TAILQ_FIRST(&req->chain);
+        TAILQ_REMOVE(&req->chain, r, _next);
         if (r->cb != NULL) {
             r->cb(conn, status ? status : (ssize_t) r->len, r->ctx);
         }
-        r = model_list_it_element(it);
-        it = model_list_it_next(it);
-    } while(r);
-    model_list_clear(&req->chain, free);
-    free(req);
+        free_write_req(conn, r);
+    }
+    free_write_req(conn, req);
 }
 
 #define mk_hdr(idx, hid, l, v) headers[(idx)++] = (hdr_t){ .header_id = (hid), .length = (l), .value = (uint8_t*)(v) }
 
-message *create_message(struct ziti_conn *conn, uint32_t content, uint32_t flags, size_t body_len) {
-
+static uint32_t conn_msg_flags(struct ziti_conn *conn, uint32_t flags) {
+    // first message advertises our capabilities
     if (conn->edge_msg_seq == 0) {
         flags |= EDGE_TRACE_UUID;
         if (conn->flags & EDGE_STREAM)
@@ -270,6 +436,12 @@ message *create_message(struct ziti_conn *conn, uint32_t content, uint32_t flags
         else
             flags |= EDGE_MULTIPART;
     }
+    return flags;
+}
+
+message *create_message(struct ziti_conn *conn, uint32_t content, uint32_t flags, size_t body_len) {
+
+    flags = conn_msg_flags(conn, flags);
 
     int32_t conn_id = htole32(conn->conn_id);
     int32_t msg_seq = htole32(conn->edge_msg_seq++);
@@ -293,6 +465,40 @@ message *create_message(struct ziti_conn *conn, uint32_t content, uint32_t flags
     return message_new(NULL, content, headers, hcount, body_len);
 }
 
+// data message for ziti_write_alloc(), all headers are reserved and set with stamp_data_message()
+static message *alloc_data_message(struct ziti_conn *conn, size_t body_len) {
+    int32_t conn_id = htole32(conn->conn_id);
+    int32_t msg_seq = 0;
+    uint32_t msg_flags = 0;
+    struct msg_uuid uuid = {0};
+    hdr_t headers[] = {
+            var_header(ConnIdHeader, conn_id),
+            var_header(SeqHeader, msg_seq),
+            header(UUIDHeader, sizeof(uuid.raw), uuid.raw),
+            var_header(FlagsHeader, msg_flags),
+    };
+    return message_new(NULL, ContentTypeData, headers, sizeof(headers)/sizeof(headers[0]), body_len);
+}
+
+static void stamp_data_message(struct ziti_conn *conn, message *m) {
+    uint32_t msg_flags = htole32(conn_msg_flags(conn, 0));
+    int32_t msg_seq = htole32(conn->edge_msg_seq++);
+    uint8_t *v;
+    size_t len;
+
+    if (message_get_bytes_header(m, SeqHeader, (const uint8_t **) &v, &len)) {
+        memcpy(v, &msg_seq, sizeof(msg_seq));
+    }
+    if (message_get_bytes_header(m, FlagsHeader, (const uint8_t **) &v, &len)) {
+        memcpy(v, &msg_flags, sizeof(msg_flags));
+    }
+    if (message_get_bytes_header(m, UUIDHeader, (const uint8_t **) &v, &len)) {
+        struct msg_uuid *uuid = (struct msg_uuid *) v;
+        uuid->ts = uv_now(conn->ziti_ctx->loop);
+        uuid->seq = msg_seq;
+    }
+}
+
 static int send_message(struct ziti_conn *conn, message *m, struct ziti_write_req_s *wr) {
     ziti_channel_t *ch = conn->channel;
     if (m->header.content == ContentTypeData) {
@@ -325,6 +531,7 @@ static void complete_conn_req(struct ziti_conn *conn, int code) {
         if (conn->conn_req->conn_timeout != NULL) {
             uv_timer_stop(conn->conn_req->conn_timeout);
         }
+        stop_dial_race(conn);
         conn->conn_req->cb(conn, code);
         conn->conn_req->cb = NULL;
 
@@ -336,7 +543,7 @@ static void complete_conn_req(struct ziti_conn *conn, int code) {
                 if (req->cb) {
                     req->cb(conn, code, req->ctx);
                 }
-                free(req);
+                free_write_req(conn, req);
             }
         }
 
@@ -369,49 +576,90 @@ static void connect_timeout(uv_timer_t *timer) {
     }
 }
 
-static bool ziti_connect(struct ziti_ctx *ztx, ziti_session *session, struct ziti_conn *conn) {
-    bool result = false;
-
+// connected channel with the lowest score among session edge routers,
+// disconnected channels are collected if list is provided
+static ziti_channel_t *select_channel(struct ziti_ctx *ztx, ziti_session *session, ziti_channel_t *exclude,
+                                      model_list *disconnected) {
     ziti_edge_router *er;
     ziti_channel_t *ch;
     ziti_channel_t *best_ch = NULL;
-    uint64_t best_latency = UINT64_MAX;
-
-    model_list disconnected = {0};
-
-    conn->channel = NULL;
-
+    uint64_t best_score = UINT64_MAX;
 
     MODEL_LIST_FOREACH(er, session->edge_routers) {
         const char *tls = er->protocols.tls;
 
         if (tls) {
             ch = model_map_get(&ztx->channels, tls);
-            if (ch == NULL) continue;
+            if (ch == NULL || ch == exclude) continue;
 
             if (ch->state == Connected) {
-                uint64_t latency = ziti_channel_latency(ch);
-                if (latency < best_latency) {
+                uint64_t score = ziti_channel_score(ch);
+                if (best_ch == NULL || score < best_score) {
                     best_ch = ch;
-                    best_latency = latency;
+                    best_score = score;
                 }
             }
 
-            if (ch->state == Disconnected) {
-                model_list_append(&disconnected, ch);
+            if (disconnected && ziti_channel_is_disconnected(ch)) {
+                model_list_append(disconnected, ch);
             }
         }
     }
+    return best_ch;
+}
+
+static uint64_t dial_race_delay(struct ziti_ctx *ztx, ziti_channel_t *ch) {
+    uint64_t delay = ztx->dial_time == 0 ? DIAL_RACE_DEFAULT_DELAY : ztx->dial_time + 4 * ztx->dial_time_var;
+    // can't get reply faster than router round trip
+    if (ch->rtt != UINT64_MAX) {
+        delay = MAX(delay, 2 * (ch->rtt + 4 * ch->rtt_var));
+    }
+    return MIN(MAX(delay, DIAL_RACE_MIN_DELAY), DIAL_RACE_MAX_DELAY);
+}
+
+static void dial_race_cb(uv_timer_t *t);
+
+static void start_dial_race(struct ziti_conn *conn) {
+    struct ziti_conn_req *req = conn->conn_req;
+    struct ziti_ctx *ztx = conn->ziti_ctx;
+
+    if (!ztx->opts.dial_racing || req->waiter == NULL || model_map_size(&ztx->channels) < 2) {
+        return;
+    }
+
+    if (req->race_timer == NULL) {
+        req->race_timer = calloc(1, sizeof(uv_timer_t));
+        uv_timer_init(ztx->loop, req->race_timer);
+        req->race_timer->data = conn;
+    }
+    uv_timer_start(req->race_timer, dial_race_cb, dial_race_delay(ztx, conn->channel), 0);
+}
+
+static bool ziti_connect(struct ziti_ctx *ztx, ziti_session *session, struct ziti_conn *conn) {
+    bool result = false;
+
+    ziti_channel_t *ch;
+    model_list disconnected = {0};
+
+    conn->channel = NULL;
+
+    ziti_channel_t *best_ch = select_channel(ztx, session, NULL, &disconnected);
 
     if (best_ch) {
-        CONN_LOG(DEBUG, "selected ch[%s@%s] for best latency(%llu ms)", best_ch->name, best_ch->url,
-                 (unsigned long long) best_latency);
+        CONN_LOG(DEBUG, "selected ch[%s@%s] for best score(%llu) latency(%llu ms) q[%zu] conns[%zu]",
+                 best_ch->name, best_ch->url, (unsigned long long) ziti_channel_score(best_ch),
+                 (unsigned long long) best_ch->rtt, best_ch->out_q_bytes, model_map_size(&best_ch->receivers));
         ziti_channel_start_connection(conn, best_ch, session);
+        start_dial_race(conn);
         result = true;
     } else {
         // if no channels are currently connected
-        // force them to connect
+        // force them to connect, within edge router limit if set
+        unsigned int count = 0;
         MODEL_LIST_FOREACH(ch, disconnected) {
+            if (ztx->opts.max_edge_routers > 0 && count++ >= ztx->opts.max_edge_routers) {
+                break;
+            }
             ziti_channel_force_connect(ch);
         }
 
@@ -458,35 +706,116 @@ static void refresh_session_cb(ziti_session *s, const ziti_error *err, void *ctx
     }
 }
 
+// in-flight 'Dial' session request, shared by all connections waiting for the same service
+struct session_req_s {
+    ziti_context ztx;
+    char *service_id;
+    // list<conn_id> -- connections waiting for the session
+    model_list waiters;
+    bool prefetch;
+};
+
 static void connect_get_net_session_cb(ziti_session *s, const ziti_error *err, void *ctx) {
-    struct ziti_conn *conn = ctx;
-    struct ziti_conn_req *req = conn->conn_req;
-    struct ziti_ctx *ztx = conn->ziti_ctx;
+    struct session_req_s *sr = ctx;
+    struct ziti_ctx *ztx = sr->ztx;
 
-    if (err != NULL) {
-        int e = err->err == ZITI_NOT_FOUND ? ZITI_SERVICE_UNAVAILABLE : (int)err->err;
-        CONN_LOG(WARN, "failed to get '%s' session for service[%s]: %s(%s)",
-                 ziti_session_types.name(req->session_type), conn->service, err->code, err->message);
+    model_map_remove(&ztx->session_requests, sr->service_id);
 
+    if (err != NULL) {
+        ZTX_LOG(WARN, "failed to get 'Dial' session for service[%s]: %s(%s)",
+                sr->service_id, err->code, err->message);
         if (err->err == ZITI_NOT_AUTHORIZED) {
             ziti_force_api_session_refresh(ztx);
-            restart_connect(conn);
-        } else {
-            complete_conn_req(conn, e);
+        } else if (err->err == ZITI_NOT_FOUND) {
+            // stale session could not be refreshed, new one will be created on next dial
+            free_ziti_session_ptr(model_map_remove(&ztx->sessions, sr->service_id));
         }
     } else {
-        ziti_session *existing = model_map_set(&ztx->sessions, req->service_id, s);
-        // this happens with concurrent connection requests for the same service (common with browsers)
+        ziti_session *existing = model_map_set(&ztx->sessions, sr->service_id, s);
         if (existing) {
-            CONN_LOG(DEBUG, "discarding existing session[%s] for service[%s]", existing->id, conn->service);
-            free_ziti_session(existing);
-            free(existing);
+            ZTX_LOG(DEBUG, "replaced session[%s] for service[%s]", existing->id, sr->service_id);
+            free_ziti_session_ptr(existing);
+        } else {
+            ZTX_LOG(DEBUG, "got session[%s] for service[%s]", s->id, sr->service_id);
+        }
+    }
+
+    void *id;
+    MODEL_LIST_FOREACH(id, sr->waiters) {
+        struct ziti_conn *conn = model_map_getl(&ztx->connections, (long)(uintptr_t)id);
+        // connection was closed or completed while waiting
+        if (conn == NULL || conn->conn_req == NULL || conn->conn_req->cb == NULL) {
+            continue;
+        }
+
+        if (err == NULL) {
+            process_connect(conn, s);
+        } else if (err->err == ZITI_NOT_AUTHORIZED) {
+            restart_connect(conn);
+        } else {
+            complete_conn_req(conn, err->err == ZITI_NOT_FOUND ? ZITI_SERVICE_UNAVAILABLE : (int) err->err);
+        }
+    }
+
+    if (sr->prefetch) {
+        ztx->prefetch_inflight--;
+        ztx_prefetch_next(ztx);
+    }
+
+    model_list_clear(&sr->waiters, NULL);
+    free(sr->service_id);
+    free(sr);
+}
+
+static void free_session_req(struct session_req_s *sr) {
+    model_list_clear(&sr->waiters, NULL);
+    free(sr->service_id);
+    free(sr);
+}
+
+void ztx_clear_session_requests(ziti_context ztx) {
+    model_map_clear(&ztx->session_requests, (void (*)(void *)) free_session_req);
+}
+
+void ziti_get_dial_session(ziti_context ztx, const char *service_id, ziti_connection conn) {
+    struct session_req_s *sr = model_map_get(&ztx->session_requests, service_id);
+    if (sr == NULL) {
+        NEWP(req, struct session_req_s);
+        req->ztx = ztx;
+        req->service_id = strdup(service_id);
+        model_map_set(&ztx->session_requests, service_id, req);
+
+        // this happens with concurrent connection requests for the same service (common with browsers),
+        // only the first one talks to controller
+        ziti_session *session = model_map_get(&ztx->sessions, service_id);
+        if (session != NULL && session->refresh) {
+            ziti_ctrl_get_session(ztx_get_controller(ztx), session->id, connect_get_net_session_cb, req);
         } else {
-            CONN_LOG(DEBUG, "got session[%s] for service[%s]", s->id, conn->service);
-            model_map_set(&ztx->sessions, s->service_id, s);
+            ziti_ctrl_create_session(ztx_get_controller(ztx), service_id, ziti_session_types.Dial,
+                                     connect_get_net_session_cb, req);
         }
-        process_connect(conn, s);
+        sr = req;
+    }
+
+    if (conn) {
+        CONN_LOG(DEBUG, "waiting for 'Dial' session for service[%s]", conn->service);
+        model_list_append(&sr->waiters, (void *) (uintptr_t) conn->conn_id);
+    }
+}
+
+bool ziti_prefetch_dial_session(ziti_context ztx, const char *service_id) {
+    if (model_map_get(&ztx->session_requests, service_id) != NULL) {
+        return false;
+    }
+
+    ziti_get_dial_session(ztx, service_id, NULL);
+    struct session_req_s *sr = model_map_get(&ztx->session_requests, service_id);
+    // request could have failed right away
+    if (sr == NULL) {
+        return false;
     }
+    sr->prefetch = true;
+    return true;
 }
 
 void process_connect(struct ziti_conn *conn, ziti_session *session) {
@@ -525,14 +854,13 @@ void process_connect(struct ziti_conn *conn, ziti_session *session) {
     if (session == NULL) {
         CONN_LOG(DEBUG, "requesting 'Dial' session for service[%s]", conn->service);
         // this will re-enter with session if create succeeds
-        ziti_ctrl_create_session(ztx_get_controller(ztx), req->service_id, ziti_session_types.Dial,
-                                 connect_get_net_session_cb, conn);
+        ziti_get_dial_session(ztx, req->service_id, conn);
         return;
     }
 
     if (model_list_size(&session->edge_routers) == 0) {
         if (session->refresh) {
-            ziti_ctrl_get_session(ztx_get_controller(ztx), session->id, connect_get_net_session_cb, conn);
+            ziti_get_dial_session(ztx, req->service_id, conn);
             return;
         } else {
             CONN_LOG(ERROR, "no edge routers available for service[%s] session[%s]", conn->service, session->id);
@@ -542,9 +870,12 @@ void process_connect(struct ziti_conn *conn, ziti_session *session) {
     }
 
     if (req->dial_opts.connect_timeout_seconds > 0) {
-        req->conn_timeout = calloc(1, sizeof(uv_timer_t));
-        uv_timer_init(loop, req->conn_timeout);
-        req->conn_timeout->data = conn;
+        // restarted connect reuses the timer
+        if (req->conn_timeout == NULL) {
+            req->conn_timeout = calloc(1, sizeof(uv_timer_t));
+            uv_timer_init(loop, req->conn_timeout);
+            req->conn_timeout->data = conn;
+        }
         uv_timer_start(req->conn_timeout, connect_timeout, req->dial_opts.connect_timeout_seconds * 1000, 0);
     }
 
@@ -597,6 +928,11 @@ static int do_ziti_dial(ziti_connection conn, const char *service, ziti_dial_opt
         if (dial_opts->stream) {
             conn->flags |= EDGE_STREAM;
         }
+
+        if (dial_opts->max_frame_size > 0) {
+            conn->max_frame = MIN(dial_opts->max_frame_size, MAX_FRAME_LEN);
+        }
+        conn->coalesce_delay = dial_opts->coalesce_delay_ms;
     }
 
     conn->data_cb = data_cb;
@@ -625,6 +961,173 @@ int ziti_dial_with_options(ziti_connection conn, const char *service, ziti_dial_
     return do_ziti_dial(conn, service, dial_opts, conn_cb, data_cb);
 }
 
+static void conn_inbound_plain(ziti_connection conn, int32_t flags, uint8_t *plain_text, unsigned long long plain_len,
+                               uv_buf_t *app_buf);
+
+static bool conn_crypto_offload(struct ziti_conn *conn, size_t len) {
+    return conn->ziti_ctx->opts.crypto_offload && len >= CRYPTO_OFFLOAD_MIN;
+}
+
+static void crypto_push_work(uv_work_t *w) {
+    struct conn_crypto_work_s *cw = container_of(w, struct conn_crypto_work_s, w);
+    if (cw->gcm) {
+        cw->rc = gcm_stream_push(&cw->gcm_s, cw->msg->body, cw->in, cw->in_len);
+    } else {
+        cw->rc = crypto_secretstream_xchacha20poly1305_push(&cw->crypt, cw->msg->body, NULL,
+                                                            cw->in, cw->in_len, NULL, 0, 0);
+    }
+}
+
+static void crypto_push_done(uv_work_t *w, int status) {
+    struct conn_crypto_work_s *cw = container_of(w, struct conn_crypto_work_s, w);
+    struct ziti_conn *conn = cw->conn;
+    // write request stays pending until this completes, so connection cannot go away
+    assert(conn != NULL);
+
+    conn->crypt_o_work = NULL;
+    if (cw->gcm) {
+        conn->gcm_o = cw->gcm_s;
+    } else {
+        conn->crypt_o = cw->crypt;
+    }
+    sodium_memzero(&cw->crypt, sizeof(cw->crypt));
+    sodium_memzero(&cw->gcm_s, sizeof(cw->gcm_s));
+
+    if (status != 0 || cw->rc != 0) {
+        CONN_LOG(ERROR, "failed to encrypt payload: %d/%d", status, cw->rc);
+        pool_return_obj(cw->msg);
+        on_write_completed(conn, cw->req, ZITI_CRYPTO_FAIL);
+    } else if (conn->channel == NULL || conn->state >= Disconnected) {
+        // channel was lost while encrypting
+        CONN_LOG(DEBUG, "connection closed while encrypting payload");
+        pool_return_obj(cw->msg);
+        on_write_completed(conn, cw->req, ZITI_CONN_CLOSED);
+    } else {
+        send_message(conn, cw->msg, cw->req);
+    }
+    free(cw);
+    flush_connection(conn);
+}
+
+static void crypto_start_push(struct ziti_conn *conn, struct ziti_write_req_s *req, message *m,
+                              const uint8_t *in, size_t len) {
+    NEWP(cw, struct conn_crypto_work_s);
+    cw->conn = conn;
+    cw->req = req;
+    cw->msg = m;
+    cw->in = in;
+    cw->in_len = len;
+    cw->gcm = conn->crypt_method_o == CryptoMethodAES256GCM;
+    if (cw->gcm) {
+        cw->gcm_s = conn->gcm_o;
+    } else {
+        cw->crypt = conn->crypt_o;
+    }
+    conn->crypt_o_work = cw;
+    CONN_LOG(VERBOSE, "offloading encryption of %zd bytes", len);
+    uv_queue_work(conn->ziti_ctx->loop, &cw->w, crypto_push_work, crypto_push_done);
+}
+
+static void crypto_pull_work(uv_work_t *w) {
+    struct conn_crypto_work_s *cw = container_of(w, struct conn_crypto_work_s, w);
+    if (cw->gcm) {
+        cw->plain = malloc(cw->in_len - GCM_STREAM_ABYTES);
+        cw->rc = gcm_stream_pull(&cw->gcm_s, cw->plain, &cw->plain_len, cw->in, cw->in_len);
+    } else {
+        unsigned char tag;
+        cw->plain = malloc(cw->in_len - crypto_secretstream_xchacha20poly1305_ABYTES);
+        cw->rc = crypto_secretstream_xchacha20poly1305_pull(&cw->crypt, cw->plain, &cw->plain_len, &tag,
+                                                            cw->in, cw->in_len, NULL, 0);
+    }
+}
+
+static void crypto_pull_done(uv_work_t *w, int status) {
+    struct conn_crypto_work_s *cw = container_of(w, struct conn_crypto_work_s, w);
+    struct ziti_conn *conn = cw->conn;
+    sodium_memzero(&cw->crypt, sizeof(cw->crypt));
+    sodium_memzero(&cw->gcm_s, sizeof(cw->gcm_s));
+    free((void *) cw->in);
+
+    if (conn == NULL) {
+        ZITI_LOG(DEBUG, "decryption completed for closed connection");
+        free(cw->plain);
+        free(cw);
+        return;
+    }
+
+    conn->crypt_i_work = NULL;
+    if (cw->gcm) {
+        conn->gcm_i = cw->gcm_s;
+    } else {
+        conn->crypt_i = cw->crypt;
+    }
+
+    if (status != 0 || cw->rc != 0) {
+        CONN_LOG(ERROR, "failed to decrypt payload: %d/%d", status, cw->rc);
+        free(cw->plain);
+        conn_set_state(conn, Disconnected);
+        conn->data_cb(conn, NULL, ZITI_CRYPTO_FAIL);
+    } else if (conn->state >= Disconnected) {
+        CONN_LOG(WARN, "inbound data on closed connection");
+        free(cw->plain);
+    } else {
+        CONN_LOG(VERBOSE, "decrypted %lld bytes", cw->plain_len);
+        conn_inbound_plain(conn, cw->flags, cw->plain, cw->plain_len, NULL);
+    }
+    free(cw);
+    flush_connection(conn);
+}
+
+static void crypto_start_pull(struct ziti_conn *conn, message *msg, int32_t flags) {
+    NEWP(cw, struct conn_crypto_work_s);
+    cw->conn = conn;
+    cw->flags = flags;
+    cw->gcm = conn->crypt_method_i == CryptoMethodAES256GCM;
+    if (cw->gcm) {
+        cw->gcm_s = conn->gcm_i;
+    } else {
+        cw->crypt = conn->crypt_i;
+    }
+    // message goes back to the channel pool, keep a copy of the payload
+    uint8_t *in = malloc(msg->header.body_len);
+    memcpy(in, msg->body, msg->header.body_len);
+    cw->in = in;
+    cw->in_len = msg->header.body_len;
+    conn->crypt_i_work = cw;
+    CONN_LOG(VERBOSE, "offloading decryption of %zd bytes", cw->in_len);
+    uv_queue_work(conn->ziti_ctx->loop, &cw->w, crypto_pull_work, crypto_pull_done);
+}
+
+static void write_req_gather(string_buf_t *buf, struct ziti_write_req_s *req) {
+    if (req->iov == NULL) {
+        string_buf_appendn(buf, (char *) req->buf, req->len);
+        return;
+    }
+
+    for (unsigned int i = 0; i < req->iovcnt; i++) {
+        string_buf_appendn(buf, req->iov[i].base, req->iov[i].len);
+    }
+}
+
+// encrypt(or copy) payload into message body
+// returns true if encryption was offloaded, message is sent when it completes
+static bool push_payload(struct ziti_conn *conn, struct ziti_write_req_s *req, message *m,
+                         const uint8_t *payload, size_t len) {
+    bool gcm = conn->crypt_method_o == CryptoMethodAES256GCM;
+    if (conn->encrypted && conn_crypto_offload(conn, len)) {
+        crypto_start_push(conn, req, m, payload, len);
+        return true;
+    } else if (conn->encrypted && gcm) {
+        gcm_stream_push(&conn->gcm_o, m->body, payload, len);
+    } else if (conn->encrypted) {
+        crypto_secretstream_xchacha20poly1305_push(&conn->crypt_o, m->body, NULL,
+                                                   payload, len, NULL, 0, 0);
+    } else if (payload != m->body) {
+        memcpy(m->body, payload, len);
+    }
+    return false;
+}
+
 static void ziti_write_req(struct ziti_write_req_s *req) {
     struct ziti_conn *conn = req->conn;
 
@@ -637,53 +1140,59 @@ static void ziti_write_req(struct ziti_write_req_s *req) {
         send_message(conn, m, req);
     } else {
         message *m = req->message;
+        bool gcm = conn->crypt_method_o == CryptoMethodAES256GCM;
         if (m == NULL) {
-            bool multipart = model_list_size(&req->chain) > 0;
+            bool multipart = !TAILQ_EMPTY(&req->chain);
             bool stream = conn->flags & EDGE_STREAM;
 
             uint32_t flags = multipart && !stream ? EDGE_MULTIPART_MSG : 0;
-            size_t total_len = conn->encrypted ? crypto_secretstream_xchacha20poly1305_abytes() : 0;
+            size_t total_len = !conn->encrypted ? 0 :
+                               gcm ? GCM_STREAM_ABYTES : crypto_secretstream_xchacha20poly1305_abytes();
             total_len += (multipart ? req->chain_len : req->len);
             m = create_message(conn, ContentTypeData, flags, total_len);
 
-            if (multipart) {
-                uint8_t *p = m->body + conn->encrypted;
+            const uint8_t *payload = req->buf;
+            size_t payload_len = multipart ? req->chain_len : req->len;
+            if (multipart || req->iov) {
+                // payload is gathered into message body and encrypted in place:
+                // secretstream output starts with one byte tag
+                uint8_t *p = m->body + (conn->encrypted && !gcm);
                 string_buf_t buf;
                 string_buf_init_fixed(&buf, (char*)p, total_len);
                 struct ziti_write_req_s *r = req;
-                model_list_iter it = model_list_iterator(&req->chain);
                 int count = 0;
                 size_t tot = 0;
                 do {
-                    if (!stream) {
+                    if (multipart && !stream) {
                         uint16_t part_len = (uint16_t) r->len;
                         part_len = htole16(part_len);
                         string_buf_appendn(&buf, (char *) &part_len, sizeof(part_len));
                     }
-                    string_buf_appendn(&buf, (char*)r->buf, r->len);
+                    write_req_gather(&buf, r);
                     count++;
                     tot += r->len;
 
-                    r = model_list_it_element(it);
-                    it = model_list_it_next(it);
+                    r = (r == req) ? TAILQ_FIRST(&req->chain) : TAILQ_NEXT(r, _next);
                 } while(r != NULL);
-                CONN_LOG(DEBUG, "consolidated %d payloads total_len[%zd]", count, tot);
-                conn->sent += tot;
-
-                if (conn->encrypted) {
-                    crypto_secretstream_xchacha20poly1305_push(&conn->crypt_o, m->body, NULL,
-                                                               p, req->chain_len, NULL, 0, 0);
-                }
                 string_buf_free(&buf);
-            } else {
-                if (conn->encrypted) {
-                    crypto_secretstream_xchacha20poly1305_push(&conn->crypt_o, m->body, NULL,
-                                                               req->buf, req->len, NULL, 0, 0);
-                } else {
-                    memcpy(m->body, req->buf, req->len);
+                if (multipart) {
+                    CONN_LOG(DEBUG, "consolidated %d payloads total_len[%zd]", count, tot);
                 }
+                payload = p;
+                conn->sent += tot;
+            } else {
                 conn->sent += req->len;
             }
+
+            if (push_payload(conn, req, m, payload, payload_len)) {
+                return;
+            }
+        } else if (req->in_place) {
+            stamp_data_message(conn, m);
+            conn->sent += req->len;
+            if (push_payload(conn, req, m, m->body + (conn->encrypted && !gcm), req->len)) {
+                return;
+            }
         }
         send_message(conn, m, req);
     }
@@ -710,8 +1219,7 @@ static void ziti_disconnect_async(struct ziti_conn *conn) {
         case Connected:
         case CloseWrite:
         case Timedout: {
-            NEWP(wr, struct ziti_write_req_s);
-            wr->conn = conn;
+            struct ziti_write_req_s *wr = new_write_req(conn);
             wr->close = true;
             wr->cb = on_disconnect;
             TAILQ_INSERT_TAIL(&conn->wreqs, wr, _next);
@@ -772,16 +1280,33 @@ int establish_crypto(ziti_connection conn, message *msg) {
         free_key_exchange(&conn->key_ex);
         return ZITI_CRYPTO_FAIL;
     }
+
+    // peer can receive AES-256-GCM stream
+    int32_t method = CryptoMethodLibsodium;
+    if (message_get_int32_header(msg, CryptoMethodHeader, &method) &&
+        method == CryptoMethodAES256GCM && ziti_conn_offer_gcm(conn)) {
+        conn->crypt_method_o = CryptoMethodAES256GCM;
+    }
     return ZITI_OK;
 }
 
+bool ziti_conn_offer_gcm(ziti_connection conn) {
+    return conn->encrypted && conn->ziti_ctx->opts.prefer_aes_gcm && gcm_stream_available();
+}
+
 static int send_crypto_header(ziti_connection conn) {
     if (conn->encrypted) {
-        size_t crypto_header_len = crypto_secretstream_xchacha20poly1305_headerbytes();
-        message *m = create_message(conn, ContentTypeData, 0, crypto_header_len);
-        crypto_secretstream_xchacha20poly1305_init_push(&conn->crypt_o, m->body, conn->key_ex.tx);
-        NEWP(wr, struct ziti_write_req_s);
-        wr->conn = conn;
+        message *m;
+        if (conn->crypt_method_o == CryptoMethodAES256GCM) {
+            m = create_message(conn, ContentTypeData, 0, GCM_STREAM_HEADERBYTES);
+            gcm_stream_init_push(&conn->gcm_o, m->body, conn->key_ex.tx);
+            CONN_LOG(DEBUG, "using AES-256-GCM for outbound stream");
+        } else {
+            size_t crypto_header_len = crypto_secretstream_xchacha20poly1305_headerbytes();
+            m = create_message(conn, ContentTypeData, 0, crypto_header_len);
+            crypto_secretstream_xchacha20poly1305_init_push(&conn->crypt_o, m->body, conn->key_ex.tx);
+        }
+        struct ziti_write_req_s *wr = new_write_req(conn);
         wr->message = m;
 
         TAILQ_INSERT_HEAD(&conn->wreqs, wr, _next);
@@ -814,14 +1339,64 @@ static void flush_connection(ziti_connection conn) {
     conn->last_activity = uv_now(conn->ziti_ctx->loop);
 }
 
+static void on_coalesce_timer(uv_timer_t *t) {
+    flush_connection(t->data);
+}
+
+static void conn_queue_write(struct ziti_conn *conn, struct ziti_write_req_s *req) {
+    if (TAILQ_EMPTY(&conn->wreqs)) {
+        conn->coalesce_since = uv_now(conn->ziti_ctx->loop);
+    }
+    TAILQ_INSERT_TAIL(&conn->wreqs, req, _next);
+    flush_connection(conn);
+}
+
+// hold queued data while corked, or until coalesce delay expires, unless there is enough for a full frame
+static bool hold_writes(struct ziti_conn *conn) {
+    if (!conn->corked && conn->coalesce_delay == 0) return false;
+    if (conn->state != Connected) return false;
+
+    size_t max_frame = conn->max_frame ? conn->max_frame : DEFAULT_FRAME_LEN;
+    size_t queued = 0;
+    struct ziti_write_req_s *req;
+    TAILQ_FOREACH(req, &conn->wreqs, _next) {
+        // close/FIN are not delayed, and push out data ahead of them
+        if ((req->message && !req->in_place) || req->close || req->eof) return false;
+
+        queued += req->len;
+        if (queued >= max_frame) return false;
+    }
+    if (queued == 0) return false;
+    if (conn->corked) return true;
+
+    uint64_t now = uv_now(conn->ziti_ctx->loop);
+    uint64_t send_at = conn->coalesce_since + conn->coalesce_delay;
+    if (now >= send_at) return false;
+
+    if (conn->coalesce_timer == NULL) {
+        conn->coalesce_timer = calloc(1, sizeof(uv_timer_t));
+        uv_timer_init(conn->ziti_ctx->loop, conn->coalesce_timer);
+        conn->coalesce_timer->data = conn;
+    }
+    if (!uv_is_active((const uv_handle_t *) conn->coalesce_timer)) {
+        uv_timer_start(conn->coalesce_timer, on_coalesce_timer, send_at - now, 0);
+    }
+    return true;
+}
+
 void chain_data_requests(ziti_connection conn, struct ziti_write_req_s *req) {
     if (req->message)
         return;
 
-    int boundary_len = (conn->flags & EDGE_STREAM) ? 0 : 2;
-#define MAX_CHAIN_LEN (31 * 1024)
+    bool stream = conn->flags & EDGE_STREAM;
+    int boundary_len = stream ? 0 : 2;
+    size_t max_frame = conn->max_frame ? conn->max_frame : DEFAULT_FRAME_LEN;
     size_t chain_len = 0;
-    if (req->len + boundary_len >= MAX_CHAIN_LEN)
+    TAILQ_INIT(&req->chain);
+    if (req->len + boundary_len >= max_frame)
+        return;
+    // multipart boundary is 16-bit length
+    if (!stream && req->len > UINT16_MAX)
         return;
 
     chain_len += (req->len + boundary_len);
@@ -831,15 +1406,18 @@ void chain_data_requests(ziti_connection conn, struct ziti_write_req_s *req) {
         if (next->message || next->close || next->eof)
             break;
 
-        if (chain_len + next->len + boundary_len > MAX_CHAIN_LEN)
+        if (chain_len + next->len + boundary_len > max_frame)
+            break;
+
+        if (!stream && next->len > UINT16_MAX)
             break;
 
         TAILQ_REMOVE(&conn->wreqs, next, _next);
-        model_list_append(&req->chain, next);
+        TAILQ_INSERT_TAIL(&req->chain, next, _next);
         chain_len += (next->len + boundary_len);
     }
 
-    if (model_list_size(&req->chain) > 0) {
+    if (!TAILQ_EMPTY(&req->chain)) {
         req->chain_len = chain_len;
     }
 }
@@ -851,7 +1429,14 @@ static bool flush_to_service(ziti_connection conn) {
     if (conn->state < Connected || conn->state == Accepting) { return false; }
 
     int count = 0;
-    while (!TAILQ_EMPTY(&conn->wreqs)) {
+    bool held = false;
+    // offloaded encryption will resume flushing when it completes
+    while (!TAILQ_EMPTY(&conn->wreqs) && conn->crypt_o_work == NULL) {
+        // coalescing timer or uncork will resume flushing
+        if ((held = hold_writes(conn))) {
+            break;
+        }
+
         struct ziti_write_req_s *req = TAILQ_FIRST(&conn->wreqs);
         TAILQ_REMOVE(&conn->wreqs, req, _next);
 
@@ -874,30 +1459,40 @@ static bool flush_to_service(ziti_connection conn) {
             if (req->cb) {
                 req->cb(conn, ZITI_INVALID_STATE, req->ctx);
             }
-            free(req);
+            if (req->message) {
+                pool_return_obj(req->message);
+            }
+            free_write_req(conn, req);
         }
     }
     CONN_LOG(TRACE, "flushed %d messages", count);
 
-    return !TAILQ_EMPTY(&conn->wreqs);
+    return !TAILQ_EMPTY(&conn->wreqs) && conn->crypt_o_work == NULL && !held;
+}
+
+// data callback is set, and not paused with ziti_conn_read_stop()
+static bool conn_reading(struct ziti_conn *conn) {
+    return conn->data_cb != NULL && !conn->read_paused;
 }
 
 static bool flush_to_client(ziti_connection conn) {
-    while (!TAILQ_EMPTY(&conn->in_q)) {
+    // messages after the one being decrypted on the threadpool have to wait for it
+    while (!TAILQ_EMPTY(&conn->in_q) && conn->crypt_i_work == NULL) {
         message *m = TAILQ_FIRST(&conn->in_q);
         TAILQ_REMOVE(&conn->in_q, m, _next);
         process_edge_message(conn, m);
         pool_return_obj(m);
     }
 
-    if (conn->data_cb == NULL) {
-        CONN_LOG(DEBUG, "no data_cb: can't flush, %zu bytes available", buffer_available(conn->inbound));
+    if (!conn_reading(conn)) {
+        CONN_LOG(DEBUG, "no data_cb or reading paused: can't flush, %zu bytes available",
+                 buffer_available(conn->inbound));
         return false;
     }
 
     CONN_LOG(VERBOSE, "%zu bytes available", buffer_available(conn->inbound));
     int flushes = 128;
-    while (conn->data_cb && buffer_available(conn->inbound) > 0 && (flushes--) > 0) {
+    while (conn_reading(conn) && buffer_available(conn->inbound) > 0 && (flushes--) > 0) {
         uint8_t *chunk;
         ssize_t chunk_len = buffer_get_next(conn->inbound, 16 * 1024, &chunk);
         ssize_t consumed = conn->data_cb(conn, chunk, chunk_len);
@@ -917,46 +1512,86 @@ static bool flush_to_client(ziti_connection conn) {
     if (buffer_available(conn->inbound) > 0) {
         CONN_LOG(VERBOSE, "%zu bytes still available", buffer_available(conn->inbound));
         // no need to schedule flush if client closed or paused receiving
-        return conn->data_cb != NULL;
+        return conn_reading(conn);
     }
 
-    if (conn->fin_recv == 1 && conn->data_cb) { // if fin was received and all data is flushed, signal EOF
+    if (conn->fin_recv == 1 && conn_reading(conn)) { // if fin was received and all data is flushed, signal EOF
         conn->fin_recv = 2;
         conn->data_cb(conn, NULL, ZITI_EOF);
     }
 
     if (conn->state == Disconnected) {
-        if (conn->data_cb) {
+        if (conn_reading(conn)) {
             conn->data_cb(conn, NULL, ZITI_CONN_CLOSED);
         }
     }
     return false;
 }
 
+// in read mode payload goes straight into application buffer, unless there is buffered data to deliver first
+static uint8_t *inbound_buf(struct ziti_conn *conn, int32_t flags, size_t len, uv_buf_t *app_buf) {
+    if (len > 0 && conn->data_cb == conn_read_data && !conn->read_paused &&
+        buffer_available(conn->inbound) == 0 && (flags & EDGE_MULTIPART_MSG) == 0) {
+        conn->alloc_cb(conn, len, app_buf);
+        if (app_buf->base == NULL || app_buf->len == 0) {
+            conn->read_paused = true;
+            conn->read_cb(conn, UV_ENOBUFS, app_buf);
+            *app_buf = uv_buf_init(NULL, 0);
+        } else if (app_buf->len >= len) {
+            return (uint8_t *) app_buf->base;
+        }
+    }
+    return malloc(len);
+}
+
 void conn_inbound_data_msg(ziti_connection conn, message *msg) {
     if (conn->state >= Disconnected || conn->fin_recv) {
         CONN_LOG(WARN, "inbound data on closed connection");
         return;
     }
 
+    uv_buf_t app_buf = uv_buf_init(NULL, 0);
     uint8_t *plain_text = NULL;
     unsigned long long plain_len = 0;
     int32_t flags = 0;
     message_get_int32_header(msg, FlagsHeader, &flags);
 
     if (conn->encrypted) {
-        PREP(crypto);
+        // header/length checks are boolean, sodium returns -1 on failure
+        PREPCF(crypto, non_zero, strerror);
         // first message is expected to be peer crypto header
+        // stream cipher is selected by the sender, and identified by the header size
         if (conn->key_ex.rx != NULL) {
             CONN_LOG(VERBOSE, "processing crypto header(%d bytes)", msg->header.body_len);
-            TRY(crypto, msg->header.body_len != crypto_secretstream_xchacha20poly1305_HEADERBYTES);
-            TRY(crypto, crypto_secretstream_xchacha20poly1305_init_pull(&conn->crypt_i, msg->body, conn->key_ex.rx));
+            if (msg->header.body_len == GCM_STREAM_HEADERBYTES) {
+                TRY(crypto, !gcm_stream_available());
+                TRY(crypto, gcm_stream_init_pull(&conn->gcm_i, msg->body, conn->key_ex.rx));
+                conn->crypt_method_i = CryptoMethodAES256GCM;
+            } else {
+                TRY(crypto, msg->header.body_len != crypto_secretstream_xchacha20poly1305_HEADERBYTES);
+                TRY(crypto, crypto_secretstream_xchacha20poly1305_init_pull(&conn->crypt_i, msg->body, conn->key_ex.rx));
+            }
             CONN_LOG(VERBOSE, "processed crypto header");
             FREE(conn->key_ex.rx);
+        } else if (conn_crypto_offload(conn, msg->header.body_len)) {
+            TRY(crypto, msg->header.body_len < (conn->crypt_method_i == CryptoMethodAES256GCM ?
+                                                GCM_STREAM_ABYTES : crypto_secretstream_xchacha20poly1305_ABYTES));
+            crypto_start_pull(conn, msg, flags);
+            return;
+        } else if (conn->crypt_method_i == CryptoMethodAES256GCM) {
+            if (msg->header.body_len > 0) {
+                TRY(crypto, msg->header.body_len < GCM_STREAM_ABYTES);
+                plain_text = inbound_buf(conn, flags, msg->header.body_len - GCM_STREAM_ABYTES, &app_buf);
+                assert(plain_text != NULL);
+                CONN_LOG(VERBOSE, "decrypting %d bytes", msg->header.body_len);
+                TRY(crypto, gcm_stream_pull(&conn->gcm_i, plain_text, &plain_len, msg->body, msg->header.body_len));
+                CONN_LOG(VERBOSE, "decrypted %lld bytes", plain_len);
+            }
         } else {
             unsigned char tag;
             if (msg->header.body_len > 0) {
-                plain_text = malloc(msg->header.body_len - crypto_secretstream_xchacha20poly1305_ABYTES);
+                plain_text = inbound_buf(conn, flags, msg->header.body_len - crypto_secretstream_xchacha20poly1305_ABYTES,
+                                         &app_buf);
                 assert(plain_text != NULL);
                 CONN_LOG(VERBOSE, "decrypting %d bytes", msg->header.body_len);
                 int crypto_rc = crypto_secretstream_xchacha20poly1305_pull(&conn->crypt_i,
@@ -986,18 +1621,44 @@ void conn_inbound_data_msg(ziti_connection conn, message *msg) {
         }
 
         CATCH(crypto) {
-            FREE(plain_text);
+            if (plain_text != (uint8_t *) app_buf.base) {
+                FREE(plain_text);
+            }
             conn_set_state(conn, Disconnected);
-            conn->data_cb(conn, NULL, ZITI_CRYPTO_FAIL);
+            if (app_buf.base) {
+                // return application buffer
+                conn->read_cb(conn, ZITI_CRYPTO_FAIL, &app_buf);
+            } else {
+                conn->data_cb(conn, NULL, ZITI_CRYPTO_FAIL);
+            }
             return;
         }
     } else if (msg->header.body_len > 0) {
-        plain_text = malloc(msg->header.body_len);
+        plain_text = inbound_buf(conn, flags, msg->header.body_len, &app_buf);
         plain_len = msg->header.body_len;
         memcpy(plain_text, msg->body, msg->header.body_len);
     }
 
-    if (plain_text) {
+    conn_inbound_plain(conn, flags, plain_text, plain_len, &app_buf);
+}
+
+static void conn_inbound_plain(ziti_connection conn, int32_t flags, uint8_t *plain_text, unsigned long long plain_len,
+                               uv_buf_t *app_buf) {
+    if (app_buf && app_buf->base) {
+        // application buffer was too small to decrypt into, fill it and keep the rest
+        size_t n = plain_len;
+        if (plain_text != (uint8_t *) app_buf->base) {
+            n = MIN(app_buf->len, plain_len);
+            memcpy(app_buf->base, plain_text, n);
+            if (plain_len > n) {
+                buffer_append_copy(conn->inbound, plain_text + n, plain_len - n);
+            }
+            free(plain_text);
+        }
+        metrics_rate_update(&conn->ziti_ctx->down_rate, (int64_t) plain_len);
+        conn->received += plain_len;
+        conn->read_cb(conn, (ssize_t) n, app_buf);
+    } else if (plain_text) {
         if (flags & EDGE_MULTIPART_MSG) {
             CONN_LOG(TRACE, "chunking multipart[%llu] message", plain_len);
             uint8_t *end = plain_text + plain_len;
@@ -1031,6 +1692,9 @@ static void restart_connect(struct ziti_conn *conn) {
         return;
     }
 
+    // raced circuit belongs to the attempt being restarted
+    stop_dial_race(conn);
+
     if (++conn->conn_req->retry_count >= MAX_CONNECT_RETRY) {
         CONN_LOG(ERROR, "failed to connect after %d retries", conn->conn_req->retry_count);
         complete_conn_req(conn, ZITI_SERVICE_UNAVAILABLE);
@@ -1043,15 +1707,131 @@ static void restart_connect(struct ziti_conn *conn) {
     process_connect(conn, NULL);
 }
 
+struct abandoned_connect_s {
+    ziti_channel_t *ch;
+    uint32_t conn_id;
+};
+
+static void abandoned_connect_cb(void *ctx, message *msg, int err) {
+    struct abandoned_connect_s *ac = ctx;
+
+    // the other attempt won, close this circuit
+    if (msg && msg->header.content == ContentTypeStateConnected) {
+        ZITI_LOG(DEBUG, "ch[%d] closing abandoned connection[%u]", ac->ch->id, ac->conn_id);
+        int32_t conn_id = htole32(ac->conn_id);
+        int32_t msg_seq = htole32(0);
+        hdr_t headers[] = {
+                {
+                        .header_id = ConnIdHeader,
+                        .length = sizeof(conn_id),
+                        .value = (uint8_t *) &conn_id
+                },
+                {
+                        .header_id = SeqHeader,
+                        .length = sizeof(msg_seq),
+                        .value = (uint8_t *) &msg_seq
+                },
+        };
+        message *m = message_new(NULL, ContentTypeStateClosed, headers, 2, 0);
+        ziti_channel_send_message(ac->ch, m, NULL);
+    }
+    free(ac);
+}
+
+// stop waiting for Connect reply on the channel,
+// circuit is closed if it still gets established
+static void abandon_connect(struct ziti_conn *conn, ziti_channel_t *ch, struct waiter_s *waiter) {
+    ziti_channel_rem_receiver(ch, conn->conn_id);
+    if (waiter) {
+        NEWP(ac, struct abandoned_connect_s);
+        ac->ch = ch;
+        ac->conn_id = conn->conn_id;
+        ziti_channel_redirect_waiter(ch, waiter, abandoned_connect_cb, ac);
+    }
+}
+
+static void stop_dial_race(struct ziti_conn *conn) {
+    struct ziti_conn_req *req = conn->conn_req;
+    if (req->race_timer) {
+        uv_timer_stop(req->race_timer);
+    }
+
+    if (req->race_ch) {
+        abandon_connect(conn, req->race_ch, req->race_waiter);
+        req->race_ch = NULL;
+        req->race_waiter = NULL;
+    }
+}
+
+static void update_dial_time(struct ziti_ctx *ztx, uint64_t sample) {
+    if (ztx->dial_time == 0) {
+        ztx->dial_time = sample;
+        ztx->dial_time_var = sample / 2;
+    } else {
+        uint64_t dev = sample > ztx->dial_time ? sample - ztx->dial_time : ztx->dial_time - sample;
+        ztx->dial_time_var = (3 * ztx->dial_time_var + dev) / 4;
+        ztx->dial_time = (7 * ztx->dial_time + sample) / 8;
+    }
+}
+
+static void race_connect_reply_cb(void *ctx, message *msg, int err) {
+    struct ziti_conn *conn = ctx;
+    struct ziti_conn_req *req = conn->conn_req;
+
+    // first attempt failed, and this one took its place
+    if (req->race_ch == NULL) {
+        connect_reply_cb(conn, msg, err);
+        return;
+    }
+
+    ziti_channel_t *ch = req->race_ch;
+    req->race_ch = NULL;
+    req->race_waiter = NULL;
+
+    if (msg == NULL || msg->header.content != ContentTypeStateConnected) {
+        CONN_LOG(DEBUG, "raced connect on ch[%d] failed", ch->id);
+        ziti_channel_rem_receiver(ch, conn->conn_id);
+        return;
+    }
+
+    CONN_LOG(DEBUG, "raced connect on ch[%d] won over ch[%d]", ch->id, conn->channel->id);
+    abandon_connect(conn, conn->channel, req->waiter);
+    req->waiter = NULL;
+    req->connect_start = req->race_start;
+    conn->channel = ch;
+    connect_reply_cb(conn, msg, err);
+}
+
 void connect_reply_cb(void *ctx, message *msg, int err) {
     struct ziti_conn *conn = ctx;
     struct ziti_conn_req *req = conn->conn_req;
 
+    req->waiter = NULL;
+    if (req->race_ch) {
+        if (msg == NULL || msg->header.content != ContentTypeStateConnected) {
+            CONN_LOG(DEBUG, "connect on ch[%d] failed, waiting for raced connect on ch[%d]",
+                     conn->channel->id, req->race_ch->id);
+            ziti_channel_rem_receiver(conn->channel, conn->conn_id);
+            conn->channel = req->race_ch;
+            req->waiter = req->race_waiter;
+            req->connect_start = req->race_start;
+            req->race_ch = NULL;
+            req->race_waiter = NULL;
+            return;
+        }
+
+        CONN_LOG(DEBUG, "connect on ch[%d] won over ch[%d]", conn->channel->id, req->race_ch->id);
+        stop_dial_race(conn);
+    }
+
+    if (req->race_timer) {
+        uv_timer_stop(req->race_timer);
+    }
+
     if (req->conn_timeout) {
         uv_timer_stop(req->conn_timeout);
     }
 
-    req->waiter = NULL;
     if (err != 0 && msg == NULL) {
         CONN_LOG(ERROR, "failed to %s [%d/%s]", "connect", err, ziti_errorstr(err));
         conn_set_state(conn, Disconnected);
@@ -1079,6 +1859,7 @@ void connect_reply_cb(void *ctx, message *msg, int err) {
         case ContentTypeStateConnected:
             if (conn->state == Connecting) {
                 CONN_LOG(TRACE, "connected");
+                update_dial_time(conn->ziti_ctx, uv_now(conn->ziti_ctx->loop) - req->connect_start);
                 int rc = ZITI_OK;
                 if (conn->encrypted) {
                     rc = establish_crypto(conn, msg);
@@ -1110,10 +1891,8 @@ void connect_reply_cb(void *ctx, message *msg, int err) {
 static int ziti_channel_start_connection(struct ziti_conn *conn, ziti_channel_t *ch, ziti_session *session) {
     struct ziti_conn_req *req = conn->conn_req;
 
-    uint32_t content_type;
     switch (conn->state) {
         case Connecting:
-            content_type = ContentTypeConnect;
             break;
         case Disconnected:
             CONN_LOG(WARN, "channel did not connect in time");
@@ -1123,11 +1902,52 @@ static int ziti_channel_start_connection(struct ziti_conn *conn, ziti_channel_t
             return ZITI_WTF;
     }
 
-    CONN_LOG(TRACE, "ch[%d] => Edge Connect request token[%s]", ch->id, session->token);
     conn->channel = ch;
     ziti_channel_add_receiver(ch, conn->conn_id, conn,
                               (void (*)(void *, message *, int)) queue_edge_message);
+    if (conn->encrypted) {
+        ztx_get_key_pair(conn->ziti_ctx, &conn->key_pair);
+    }
+
+    req->connect_start = uv_now(conn->ziti_ctx->loop);
+    req->waiter = send_connect(conn, ch, session, connect_reply_cb);
+    return ZITI_OK;
+}
 
+static void dial_race_cb(uv_timer_t *t) {
+    struct ziti_conn *conn = t->data;
+    struct ziti_conn_req *req = conn->conn_req;
+    struct ziti_ctx *ztx = conn->ziti_ctx;
+
+    if (conn->state != Connecting || req->waiter == NULL || req->race_ch != NULL) {
+        return;
+    }
+
+    ziti_session *session = model_map_get(&ztx->sessions, req->service_id);
+    if (session == NULL) {
+        return;
+    }
+
+    ziti_channel_t *ch = select_channel(ztx, session, conn->channel, NULL);
+    if (ch == NULL) {
+        CONN_LOG(DEBUG, "no other edge router to race connect");
+        return;
+    }
+
+    CONN_LOG(DEBUG, "no connect reply from ch[%d] in %" PRIu64 "ms, racing connect on ch[%d]",
+             conn->channel->id, uv_now(ztx->loop) - req->connect_start, ch->id);
+    req->race_ch = ch;
+    req->race_start = uv_now(ztx->loop);
+    ziti_channel_add_receiver(ch, conn->conn_id, conn,
+                              (void (*)(void *, message *, int)) queue_edge_message);
+    req->race_waiter = send_connect(conn, ch, session, race_connect_reply_cb);
+}
+
+static struct waiter_s *send_connect(struct ziti_conn *conn, ziti_channel_t *ch, ziti_session *session,
+                                     reply_cb reply_f) {
+    struct ziti_conn_req *req = conn->conn_req;
+
+    CONN_LOG(TRACE, "ch[%d] => Edge Connect request token[%s]", ch->id, session->token);
     int32_t conn_id = htole32(conn->conn_id);
     int32_t msg_seq = htole32(0);
 
@@ -1169,6 +1989,11 @@ static int ziti_channel_start_connection(struct ziti_conn *conn, ziti_channel_t
                     .length = 0,
                     .value = NULL,
             },
+            {
+                    .header_id = -1,
+                    .length = 0,
+                    .value = NULL,
+            },
             {
                     .header_id = -1,
                     .length = 0,
@@ -1177,7 +2002,14 @@ static int ziti_channel_start_connection(struct ziti_conn *conn, ziti_channel_t
     };
     int nheaders = 4;
     if (conn->encrypted) {
-        init_key_pair(&conn->key_pair);
+        nheaders++;
+    }
+
+    int32_t crypto_method = htole32(CryptoMethodAES256GCM);
+    if (ziti_conn_offer_gcm(conn)) {
+        headers[nheaders].header_id = CryptoMethodHeader;
+        headers[nheaders].value = (uint8_t *) &crypto_method;
+        headers[nheaders].length = sizeof(crypto_method);
         nheaders++;
     }
 
@@ -1195,11 +2027,9 @@ static int ziti_channel_start_connection(struct ziti_conn *conn, ziti_channel_t
         nheaders++;
     }
 
-    req->waiter = ziti_channel_send_for_reply(ch, content_type, headers, nheaders,
-                                              session->token, strlen(session->token),
-                                              connect_reply_cb, conn);
-
-    return ZITI_OK;
+    return ziti_channel_send_for_reply(ch, ContentTypeConnect, headers, nheaders,
+                                       session->token, strlen(session->token),
+                                       reply_f, conn);
 }
 
 
@@ -1233,6 +2063,7 @@ int ziti_accept(ziti_connection conn, ziti_conn_cb cb, ziti_data_cb data_cb) {
     int32_t msg_seq = htole32(0);
     int32_t reply_id = htole32(conn->dial_req_seq);
     int32_t clt_conn_id = htole32(conn->conn_id);
+    int32_t crypto_method = htole32(CryptoMethodAES256GCM);
     hdr_t headers[] = {
             {
                     .header_id = ConnIdHeader,
@@ -1249,13 +2080,19 @@ int ziti_accept(ziti_connection conn, ziti_conn_cb cb, ziti_data_cb data_cb) {
                     .length = sizeof(reply_id),
                     .value = (uint8_t *) &reply_id
             },
+            {
+                    .header_id = CryptoMethodHeader,
+                    .length = sizeof(crypto_method),
+                    .value = (uint8_t *) &crypto_method
+            },
     };
+    int nheaders = conn->crypt_method_o == CryptoMethodAES256GCM ? 4 : 3;
     NEWP(req, struct ziti_conn_req);
     req->cb = cb;
     conn->conn_req = req;
 
     req->waiter = ziti_channel_send_for_reply(
-            ch, content_type, headers, 3,
+            ch, content_type, headers, nheaders,
             (const uint8_t *) &clt_conn_id, sizeof(clt_conn_id),
             connect_reply_cb, conn);
 
@@ -1273,8 +2110,7 @@ int ziti_write(ziti_connection conn, uint8_t *data, size_t length, ziti_write_cb
         return ZITI_INVALID_STATE;
     }
 
-    NEWP(req, struct ziti_write_req_s);
-    req->conn = conn;
+    struct ziti_write_req_s *req = new_write_req(conn);
     req->buf = data;
     req->len = length;
     req->cb = write_cb;
@@ -1282,12 +2118,134 @@ int ziti_write(ziti_connection conn, uint8_t *data, size_t length, ziti_write_cb
     CONN_LOG(TRACE, "write %zd bytes", length);
     metrics_rate_update(&conn->ziti_ctx->up_rate, (long)length);
 
-    TAILQ_INSERT_TAIL(&conn->wreqs, req, _next);
-    flush_connection(conn);
+    conn_queue_write(conn, req);
+
+    return 0;
+}
+
+int ziti_writev(ziti_connection conn, const uv_buf_t bufs[], unsigned int nbufs,
+                ziti_write_cb write_cb, void *write_ctx) {
+    if (conn->fin_sent) {
+        CONN_LOG(ERROR, "attempted write after ziti_close_write()");
+        return ZITI_INVALID_STATE;
+    }
+
+    if (conn->state != Connected && conn->state != Connecting) {
+        CONN_LOG(ERROR, "attempted write in invalid state[%s]", ziti_conn_state(conn));
+        return ZITI_INVALID_STATE;
+    }
+
+    // buffer descriptors are kept in the same allocation with the request
+    struct ziti_write_req_s *req = calloc(1, sizeof(struct ziti_write_req_s) + nbufs * sizeof(uv_buf_t));
+    req->conn = conn;
+    req->iov = (uv_buf_t *) (req + 1);
+    req->iovcnt = nbufs;
+    for (unsigned int i = 0; i < nbufs; i++) {
+        req->iov[i] = bufs[i];
+        req->len += bufs[i].len;
+    }
+    req->cb = write_cb;
+    req->ctx = write_ctx;
+    CONN_LOG(TRACE, "write %zd bytes from %u buffers", req->len, nbufs);
+    metrics_rate_update(&conn->ziti_ctx->up_rate, (long)req->len);
+
+    conn_queue_write(conn, req);
 
     return 0;
 }
 
+// ziti_write_alloc() buffer starts after secretstream tag, so that payload is encrypted in place
+static size_t write_buf_offset(struct ziti_conn *conn) {
+    return conn->encrypted && conn->crypt_method_o != CryptoMethodAES256GCM;
+}
+
+static size_t write_buf_overhead(struct ziti_conn *conn) {
+    if (!conn->encrypted) return 0;
+    return conn->crypt_method_o == CryptoMethodAES256GCM ?
+           GCM_STREAM_ABYTES : crypto_secretstream_xchacha20poly1305_abytes();
+}
+
+uint8_t *ziti_write_alloc(ziti_connection conn, size_t len) {
+    if (conn->type != Transport || conn->state != Connected || conn->fin_sent) {
+        CONN_LOG(ERROR, "write buffer requested in invalid state[%s]", ziti_conn_state(conn));
+        return NULL;
+    }
+
+    message *m = alloc_data_message(conn, len + write_buf_overhead(conn));
+    uint8_t *buf = m->body + write_buf_offset(conn);
+    model_map_setl(&conn->write_bufs, (long) buf, m);
+    return buf;
+}
+
+int ziti_write_submit(ziti_connection conn, uint8_t *buf, size_t len, ziti_write_cb write_cb, void *write_ctx) {
+    message *m = model_map_getl(&conn->write_bufs, (long) buf);
+    if (m == NULL) {
+        CONN_LOG(ERROR, "unknown write buffer");
+        return ZITI_INVALID_STATE;
+    }
+
+    size_t overhead = write_buf_overhead(conn);
+    if (len + overhead > m->header.body_len) {
+        CONN_LOG(ERROR, "write[%zd bytes] exceeds allocated buffer[%zd bytes]",
+                 len, (size_t) m->header.body_len - overhead);
+        return ZITI_INVALID_STATE;
+    }
+
+    if (conn->fin_sent) {
+        CONN_LOG(ERROR, "attempted write after ziti_close_write()");
+        return ZITI_INVALID_STATE;
+    }
+
+    if (conn->state != Connected) {
+        CONN_LOG(ERROR, "attempted write in invalid state[%s]", ziti_conn_state(conn));
+        return ZITI_INVALID_STATE;
+    }
+
+    model_map_removel(&conn->write_bufs, (long) buf);
+    // trim unused space at the end of the body
+    size_t unused = m->header.body_len - (len + overhead);
+    m->header.body_len -= unused;
+    m->msgbuflen -= unused;
+
+    struct ziti_write_req_s *req = new_write_req(conn);
+    req->message = m;
+    req->in_place = true;
+    req->len = len;
+    req->cb = write_cb;
+    req->ctx = write_ctx;
+    CONN_LOG(TRACE, "write %zd bytes in place", len);
+    metrics_rate_update(&conn->ziti_ctx->up_rate, (long)len);
+
+    conn_queue_write(conn, req);
+    return ZITI_OK;
+}
+
+void ziti_write_discard(ziti_connection conn, uint8_t *buf) {
+    message *m = model_map_removel(&conn->write_bufs, (long) buf);
+    if (m) {
+        pool_return_obj(m);
+    }
+}
+
+int ziti_conn_cork(ziti_connection conn) {
+    if (conn->type != Transport) {
+        return ZITI_INVALID_STATE;
+    }
+
+    conn->corked = true;
+    return ZITI_OK;
+}
+
+int ziti_conn_uncork(ziti_connection conn) {
+    if (conn->type != Transport) {
+        return ZITI_INVALID_STATE;
+    }
+
+    conn->corked = false;
+    flush_connection(conn);
+    return ZITI_OK;
+}
+
 static int send_fin_message(ziti_connection conn, struct ziti_write_req_s *wr) {
     CONN_LOG(DEBUG, "sending FIN");
     message *m = create_message(conn, ContentTypeData, EDGE_FIN, 0);
@@ -1316,8 +2274,7 @@ int ziti_close_write(ziti_connection conn) {
         return ZITI_OK;
     }
 
-    NEWP(req, struct ziti_write_req_s);
-    req->conn = conn;
+    struct ziti_write_req_s *req = new_write_req(conn);
     req->eof = true;
 
     TAILQ_INSERT_TAIL(&conn->wreqs, req, _next);
@@ -1447,6 +2404,9 @@ static void process_edge_message(struct ziti_conn *conn, message *msg) {
                         retry_connect = true;
                     }
                     if (retry_connect) {
+                        // circuit is gone, connect reply will not come
+                        ziti_channel_remove_waiter(conn->channel, conn->conn_req->waiter);
+                        conn->conn_req->waiter = NULL;
                         ziti_channel_rem_receiver(conn->channel, conn->conn_id);
                         conn->channel = NULL;
                         conn_set_state(conn, Connecting);
@@ -1525,5 +2485,6 @@ void init_transport_conn(struct ziti_conn *c) {
     TAILQ_INIT(&c->in_q);
     TAILQ_INIT(&c->wreqs);
     TAILQ_INIT(&c->pending_wreqs);
+    TAILQ_INIT(&c->wreq_pool);
     c->inbound = new_buffer();
 }
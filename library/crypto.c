@@ -19,6 +19,99 @@ int init_key_pair(struct key_pair *kp) {
     return crypto_kx_keypair(kp->pk, kp->sk);
 }
 
+struct key_pool_work_s {
+    uv_work_t w;
+    ziti_context ztx; // NULL if context was released while work was in flight
+    unsigned int count;
+    struct key_pair keys[];
+};
+
+static unsigned int key_pool_size(ziti_context ztx) {
+    return ztx->opts.key_pool_size > 0 ? ztx->opts.key_pool_size : KEY_POOL_SIZE;
+}
+
+static void key_pool_gen(uv_work_t *w) {
+    struct key_pool_work_s *kw = container_of(w, struct key_pool_work_s, w);
+    for (unsigned int i = 0; i < kw->count; i++) {
+        init_key_pair(&kw->keys[i]);
+    }
+}
+
+static void key_pool_done(uv_work_t *w, int status) {
+    struct key_pool_work_s *kw = container_of(w, struct key_pool_work_s, w);
+    ziti_context ztx = kw->ztx;
+    if (ztx != NULL) {
+        ztx->key_pool_work = NULL;
+        for (unsigned int i = 0; status == 0 && i < kw->count && ztx->key_pool_count < ztx->key_pool_cap; i++) {
+            ztx->key_pool[ztx->key_pool_count++] = kw->keys[i];
+        }
+    }
+    sodium_memzero(kw->keys, kw->count * sizeof(struct key_pair));
+    free(kw);
+}
+
+// (re)allocate pool if size option was changed, extra keys are dropped
+static void key_pool_resize(ziti_context ztx, unsigned int size) {
+    struct key_pair *pool = calloc(size, sizeof(struct key_pair));
+    if (ztx->key_pool_count > size) {
+        ztx->key_pool_count = size;
+    }
+    if (ztx->key_pool) {
+        memcpy(pool, ztx->key_pool, ztx->key_pool_count * sizeof(struct key_pair));
+        sodium_memzero(ztx->key_pool, ztx->key_pool_cap * sizeof(struct key_pair));
+        free(ztx->key_pool);
+    }
+    ztx->key_pool = pool;
+    ztx->key_pool_cap = size;
+}
+
+void ztx_fill_key_pool(ziti_context ztx) {
+    unsigned int size = key_pool_size(ztx);
+    if (ztx->key_pool_cap != size) {
+        key_pool_resize(ztx, size);
+    }
+
+    // refill when half empty, one batch at a time
+    if (ztx->key_pool_work != NULL || ztx->key_pool_count > size / 2) {
+        return;
+    }
+
+    unsigned int count = size - ztx->key_pool_count;
+    struct key_pool_work_s *kw = calloc(1, sizeof(*kw) + count * sizeof(struct key_pair));
+    kw->ztx = ztx;
+    kw->count = count;
+    ztx->key_pool_work = kw;
+    if (uv_queue_work(ztx->loop, &kw->w, key_pool_gen, key_pool_done) != 0) {
+        ztx->key_pool_work = NULL;
+        free(kw);
+    }
+}
+
+void ztx_get_key_pair(ziti_context ztx, struct key_pair *kp) {
+    if (ztx->key_pool_count > 0) {
+        ztx->key_pool_count--;
+        *kp = ztx->key_pool[ztx->key_pool_count];
+        sodium_memzero(&ztx->key_pool[ztx->key_pool_count], sizeof(struct key_pair));
+    } else {
+        init_key_pair(kp);
+    }
+    ztx_fill_key_pool(ztx);
+}
+
+void ztx_free_key_pool(ziti_context ztx) {
+    if (ztx->key_pool_work) {
+        // done callback will release it
+        ztx->key_pool_work->ztx = NULL;
+        ztx->key_pool_work = NULL;
+    }
+    if (ztx->key_pool) {
+        sodium_memzero(ztx->key_pool, ztx->key_pool_cap * sizeof(struct key_pair));
+        FREE(ztx->key_pool);
+    }
+    ztx->key_pool_cap = 0;
+    ztx->key_pool_count = 0;
+}
+
 int init_crypto(struct key_exchange *key_ex, struct key_pair *kp, const uint8_t *peer_key, bool server) {
     free(key_ex->rx);
     free(key_ex->tx);
@@ -35,4 +128,46 @@ int init_crypto(struct key_exchange *key_ex, struct key_pair *kp, const uint8_t
 void free_key_exchange(struct key_exchange *key_ex) {
     FREE(key_ex->rx);
     FREE(key_ex->tx);
+}
+
+bool gcm_stream_available(void) {
+    // sodium_init() detects CPU features
+    return sodium_init() >= 0 && crypto_aead_aes256gcm_is_available();
+}
+
+static void gcm_stream_nonce(struct gcm_stream *s, uint8_t nonce[crypto_aead_aes256gcm_NPUBBYTES]) {
+    memcpy(nonce, s->nonce, crypto_aead_aes256gcm_NPUBBYTES);
+    uint64_t c = s->counter++;
+    for (int i = 0; i < 8; i++) {
+        nonce[crypto_aead_aes256gcm_NPUBBYTES - 1 - i] ^= (uint8_t) (c >> (8 * i));
+    }
+}
+
+int gcm_stream_init_push(struct gcm_stream *s, uint8_t header[GCM_STREAM_HEADERBYTES], const uint8_t *key) {
+    header[0] = CryptoMethodAES256GCM;
+    randombytes_buf(s->nonce, sizeof(s->nonce));
+    memcpy(header + 1, s->nonce, sizeof(s->nonce));
+    s->counter = 0;
+    return crypto_aead_aes256gcm_beforenm(&s->state, key);
+}
+
+int gcm_stream_init_pull(struct gcm_stream *s, const uint8_t header[GCM_STREAM_HEADERBYTES], const uint8_t *key) {
+    if (header[0] != CryptoMethodAES256GCM) {
+        return -1;
+    }
+    memcpy(s->nonce, header + 1, sizeof(s->nonce));
+    s->counter = 0;
+    return crypto_aead_aes256gcm_beforenm(&s->state, key);
+}
+
+int gcm_stream_push(struct gcm_stream *s, uint8_t *c, const uint8_t *m, size_t mlen) {
+    uint8_t nonce[crypto_aead_aes256gcm_NPUBBYTES];
+    gcm_stream_nonce(s, nonce);
+    return crypto_aead_aes256gcm_encrypt_afternm(c, NULL, m, mlen, NULL, 0, NULL, nonce, &s->state);
+}
+
+int gcm_stream_pull(struct gcm_stream *s, uint8_t *m, unsigned long long *mlen, const uint8_t *c, size_t clen) {
+    uint8_t nonce[crypto_aead_aes256gcm_NPUBBYTES];
+    gcm_stream_nonce(s, nonce);
+    return crypto_aead_aes256gcm_decrypt_afternm(m, mlen, NULL, c, clen, NULL, 0, nonce, &s->state);
 }
\ No newline at end of file
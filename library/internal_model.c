@@ -43,13 +43,13 @@ IMPL_ENUM(ziti_ctrl_cap, ZITI_CTRL_CAP_ENUM)
 
 IMPL_ENUM(ziti_posture_query_type, ZITI_POSTURE_QUERY_TYPE_ENUM)
 
-IMPL_MODEL(ziti_posture_query, ZITI_POSTURE_QUERY_MODEL)
+IMPL_MODEL_SPECIALIZED(ziti_posture_query, ZITI_POSTURE_QUERY_MODEL)
 
-IMPL_MODEL(ziti_posture_query_set, ZITI_POSTURE_QUERY_SET_MODEL)
+IMPL_MODEL_SPECIALIZED(ziti_posture_query_set, ZITI_POSTURE_QUERY_SET_MODEL)
 
 IMPL_MODEL(ziti_process, ZITI_PROCESS_MODEL)
 
-IMPL_MODEL(ziti_service, ZITI_SERVICE_MODEL)
+IMPL_MODEL_SPECIALIZED(ziti_service, ZITI_SERVICE_MODEL)
 
 IMPL_MODEL(ziti_client_cfg_v1, ZITI_CLIENT_CFG_V1_MODEL)
 
@@ -75,13 +75,13 @@ IMPL_MODEL(ziti_id_cfg, ZITI_ID_CFG_MODEL)
 
 IMPL_MODEL(ziti_config, ZITI_CONFIG_MODEL)
 
-IMPL_MODEL(ziti_er_protocols, ZITI_ER_PROTOCOLS)
+IMPL_MODEL_SPECIALIZED(ziti_er_protocols, ZITI_ER_PROTOCOLS)
 
-IMPL_MODEL(ziti_edge_router, ZITI_EDGE_ROUTER_MODEL)
+IMPL_MODEL_SPECIALIZED(ziti_edge_router, ZITI_EDGE_ROUTER_MODEL)
 
 IMPL_MODEL(ziti_service_routers, ZITI_SERVICE_EDGE_ROUTERS_MODEL)
 
-IMPL_MODEL(ziti_session, ZITI_SESSION_MODEL)
+IMPL_MODEL_SPECIALIZED(ziti_session, ZITI_SESSION_MODEL)
 
 IMPL_MODEL(api_path, ZITI_API_PATH_MODEL)
 
@@ -111,17 +111,17 @@ IMPL_MODEL(ziti_network_jwt, ZITI_NETWORK_JWT)
 
 IMPL_MODEL(ziti_enrollment_resp, ZITI_ENROLLMENT_RESP)
 
-IMPL_MODEL(ziti_pr_mac_req, ZITI_PR_MAC_REQ)
+IMPL_MODEL_SPECIALIZED(ziti_pr_mac_req, ZITI_PR_MAC_REQ)
 
-IMPL_MODEL(ziti_pr_os_req, ZITI_PR_OS_REQ)
+IMPL_MODEL_SPECIALIZED(ziti_pr_os_req, ZITI_PR_OS_REQ)
 
-IMPL_MODEL(ziti_pr_process, ZITI_PR_PROCESS)
+IMPL_MODEL_SPECIALIZED(ziti_pr_process, ZITI_PR_PROCESS)
 
-IMPL_MODEL(ziti_pr_process_req, ZITI_PR_PROCESS_REQ)
+IMPL_MODEL_SPECIALIZED(ziti_pr_process_req, ZITI_PR_PROCESS_REQ)
 
-IMPL_MODEL(ziti_pr_domain_req, ZITI_PR_DOMAIN_REQ)
+IMPL_MODEL_SPECIALIZED(ziti_pr_domain_req, ZITI_PR_DOMAIN_REQ)
 
-IMPL_MODEL(ziti_pr_endpoint_state_req, ZITI_PR_ENDPOINT_STATE_REQ)
+IMPL_MODEL_SPECIALIZED(ziti_pr_endpoint_state_req, ZITI_PR_ENDPOINT_STATE_REQ)
 
 IMPL_MODEL(ziti_service_timer, ZITI_SERVICE_TIMER)
 
@@ -275,6 +275,27 @@ message *message_new(pool_t *pool, uint32_t content, const hdr_t *hdrs, int nhdr
     return m;
 }
 
+message *message_clone(message *m) {
+    // inbound messages only carry parsed header, serialize it for the copy
+    uint8_t header_buf[HEADER_SIZE];
+    header_to_buffer(&m->header, header_buf);
+
+    message *copy;
+    if (message_new_from_header(NULL, header_buf, &copy) != ZITI_OK) {
+        return NULL;
+    }
+
+    memcpy(copy->msgbufp, header_buf, HEADER_SIZE);
+    memcpy(copy->headers, m->headers, m->header.headers_len + m->header.body_len);
+    int rc = parse_hdrs(copy->headers, copy->header.headers_len, &copy->hdrs);
+    if (rc < 0) {
+        pool_return_obj(copy);
+        return NULL;
+    }
+    copy->nhdrs = rc;
+    return copy;
+}
+
 void message_set_seq(message *m, uint32_t *seq) {
     if (m->header.seq == 0) {
         *seq += 1;
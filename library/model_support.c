@@ -12,6 +12,7 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <ctype.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -21,6 +22,20 @@
 #include <buffer.h>
 #include <utils.h>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define JSON_SCAN_AVX2 1
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define JSON_SCAN_SSE2 1
+#endif
+
+#if _MSC_VER
+#include <intrin.h>
+#endif
+
 #if _WIN32
 #include <time.h>
 #define timegm(v) _mkgmtime(v)
@@ -48,81 +63,87 @@ int model_cmp(const void *lh, const void *rh, const type_meta *meta) {
     int rc = 0;
     for (int i = 0; rc == 0 && i < meta->field_count; i++) {
         field_meta *fm = meta->fields + i;
-        const type_meta *ftm = fm->meta();
+        rc = model_field_cmp((char *) lh + fm->offset, (char *) rh + fm->offset, fm->mod, fm->meta());
+    }
 
-        void **lf_addr = (void **) ((char *) lh + fm->offset);
-        void **rf_addr = (void **) ((char *) rh + fm->offset);
-        void *lf_ptr, *rf_ptr;
+    return rc;
+}
 
-        if (fm->mod == none_mod) {
-            lf_ptr = lf_addr;
-            rf_ptr = rf_addr;
-            rc = ftm->comparer ? ftm->comparer(lf_ptr, rf_ptr) : model_cmp(lf_ptr, rf_ptr, ftm);
-        }
-        else if (fm->mod == ptr_mod) {
-            lf_ptr = (void *) (*lf_addr);
-            rf_ptr = (void *) (*rf_addr);
-            rc = ftm->comparer ? ftm->comparer(lf_ptr, rf_ptr) : model_cmp(lf_ptr, rf_ptr, ftm);
-        }
-        else if (fm->mod == map_mod) {
-            lf_ptr = lf_addr;
-            rf_ptr = rf_addr;
+// NOLINTNEXTLINE(misc-no-recursion)
+int model_field_cmp(const void *lh, const void *rh, enum _field_mod mod, const type_meta *ftm) {
+    int rc = 0;
+    void **lf_addr = (void **) lh;
+    void **rf_addr = (void **) rh;
+    void *lf_ptr, *rf_ptr;
+
+    if (mod == none_mod) {
+        lf_ptr = lf_addr;
+        rf_ptr = rf_addr;
+        rc = ftm->comparer ? ftm->comparer(lf_ptr, rf_ptr) : model_cmp(lf_ptr, rf_ptr, ftm);
+    }
+    else if (mod == ptr_mod) {
+        lf_ptr = (void *) (*lf_addr);
+        rf_ptr = (void *) (*rf_addr);
+        rc = ftm->comparer ? ftm->comparer(lf_ptr, rf_ptr) : model_cmp(lf_ptr, rf_ptr, ftm);
+    }
+    else if (mod == map_mod) {
+        lf_ptr = lf_addr;
+        rf_ptr = rf_addr;
 
-            rc = model_map_compare(lf_ptr, rf_ptr, ftm);
-        } else if (fm->mod == list_mod) {
-            model_list *ll = (model_list *) (lf_addr);
-            model_list *rl = (model_list *) (rf_addr);
+        rc = model_map_compare(lf_ptr, rf_ptr, ftm);
+    } else if (mod == list_mod) {
+        model_list *ll = (model_list *) (lf_addr);
+        model_list *rl = (model_list *) (rf_addr);
 
-            model_list_iter lit = model_list_iterator(ll);
-            model_list_iter rit = model_list_iterator(rl);
+        model_list_iter lit = model_list_iterator(ll);
+        model_list_iter rit = model_list_iterator(rl);
 
-            if (lit == NULL && rit != NULL) { rc = 1; }
-            else {
-                while (rc == 0) {
-                    lf_ptr = model_list_it_element(lit);
-                    lit = model_list_it_next(lit);
-                    rf_ptr = model_list_it_element(rit);
-                    rit = model_list_it_next(rit);
-                    if (rf_ptr == NULL && lf_ptr == NULL) { break; }
-
-                    if (ftm->comparer) {
-                        if (fm->meta() == get_model_string_meta() ||
-                            fm->meta() == get_json_meta() ||
-                            fm->meta() == get_model_number_meta() ||
-                            fm->meta() == get_model_bool_meta()) {
-                            rc = ftm->comparer(&lf_ptr, &rf_ptr);
-                        } else {
-                            rc = ftm->comparer(lf_ptr, rf_ptr);
-                        }
+        if (lit == NULL && rit != NULL) { rc = 1; }
+        else {
+            while (rc == 0) {
+                lf_ptr = model_list_it_element(lit);
+                lit = model_list_it_next(lit);
+                rf_ptr = model_list_it_element(rit);
+                rit = model_list_it_next(rit);
+                if (rf_ptr == NULL && lf_ptr == NULL) { break; }
+
+                if (ftm->comparer) {
+                    if (ftm == get_model_string_meta() ||
+                        ftm == get_json_meta() ||
+                        ftm == get_model_number_meta() ||
+                        ftm == get_model_bool_meta()) {
+                        rc = ftm->comparer(&lf_ptr, &rf_ptr);
                     } else {
-                        rc = model_cmp(lf_ptr, rf_ptr, ftm);
+                        rc = ftm->comparer(lf_ptr, rf_ptr);
                     }
+                } else {
+                    rc = model_cmp(lf_ptr, rf_ptr, ftm);
                 }
             }
+        }
 
-        } else if (fm->mod == array_mod) {
-            void **larr = (void **) (*lf_addr);
-            void **rarr = (void **) (*rf_addr);
+    } else if (mod == array_mod) {
+        void **larr = (void **) (*lf_addr);
+        void **rarr = (void **) (*rf_addr);
 
-            if (larr == rarr) {}
-            else if (larr == NULL) { rc = -1; }
-            else if (rarr == NULL) { rc = 1; }
-            else {
-                for (int idx = 0; rc == 0; idx++) {
-                    lf_ptr = larr[idx];
-                    rf_ptr = rarr[idx];
-                    if (rf_ptr == NULL && lf_ptr == NULL) { break; }
-
-                    if (ftm->comparer) {
-                        if (fm->meta() == get_model_string_meta()) {
-                            rc = ftm->comparer(&lf_ptr, &rf_ptr);
-                        }
-                        else {
-                            rc = ftm->comparer(lf_ptr, rf_ptr);
-                        }
-                    } else {
-                        rc = model_cmp(lf_ptr, rf_ptr, ftm);
+        if (larr == rarr) {}
+        else if (larr == NULL) { rc = -1; }
+        else if (rarr == NULL) { rc = 1; }
+        else {
+            for (int idx = 0; rc == 0; idx++) {
+                lf_ptr = larr[idx];
+                rf_ptr = rarr[idx];
+                if (rf_ptr == NULL && lf_ptr == NULL) { break; }
+
+                if (ftm->comparer) {
+                    if (ftm == get_model_string_meta()) {
+                        rc = ftm->comparer(&lf_ptr, &rf_ptr);
+                    }
+                    else {
+                        rc = ftm->comparer(lf_ptr, rf_ptr);
                     }
+                } else {
+                    rc = model_cmp(lf_ptr, rf_ptr, ftm);
                 }
             }
         }
@@ -259,7 +280,16 @@ if ((flags & MODEL_JSON_COMPACT) == 0) BUF_APPEND_B(b, '\n'); \
 } while(0)
 
 
-#define BUF_APPEND_B(b, s) CHECK_APPEND(string_buf_append_byte(b,s))
+// write directly into the current chunk, only call into string_buf when it is full
+static inline int buf_append_byte(string_buf_t *b, char c) {
+    if (b->wp < b->chunk + b->chunk_size) {
+        *b->wp++ = (uint8_t) c;
+        return 0;
+    }
+    return string_buf_append_byte(b, c);
+}
+
+#define BUF_APPEND_B(b, s) CHECK_APPEND(buf_append_byte(b,s))
 #define BUF_APPEND_S(b, s) CHECK_APPEND(string_buf_append(b,s))
 
 #define CHECK_APPEND(op) do { int res = (op); if (res != 0) return res; } while(0)
@@ -278,124 +308,140 @@ int write_model_to_buf(const void *obj, const type_meta *meta, string_buf_t *buf
         if (fm->path == NULL || fm->path[0] == 0) {
             continue;
         }
-        const type_meta *ftm = fm->meta();
 
-        void **f_addr = (void **) ((char *) obj + fm->offset);
-        void *f_ptr = fm->mod == none_mod ? f_addr : (void *) (*f_addr);
+        CHECK_APPEND(model_field_to_json(buf, fm->path, strlen(fm->path), (char *) obj + fm->offset,
+                                         fm->mod, fm->meta(), &comma, indent, flags));
+    }
+    return model_json_end(buf, indent, flags);
+}
 
-        if (ftm == get_model_string_meta() || ftm == get_json_meta()) {
-            f_ptr = (void *) (*f_addr);
-        }
+int model_json_begin(void *buf) {
+    return string_buf_append_byte(buf, '{');
+}
 
-        if (f_ptr == NULL) {
-            continue;
-        }
+int model_json_end(void *b, int indent, int flags) {
+    string_buf_t *buf = b;
+    PRETTY_NL(buf);
+    PRETTY_INDENT(buf, indent - 1);
+    BUF_APPEND_B(buf, '}');
+    return 0;
+}
 
-        if (comma) {
-            BUF_APPEND_S(buf, ",");
-        }
-        PRETTY_NL(buf);
+int model_field_to_json(void *b, const char *key, size_t key_len, const void *field,
+                        enum _field_mod mod, const type_meta *ftm, bool *comma, int indent, int flags) {
+    string_buf_t *buf = b;
+    void **f_addr = (void **) field;
+    void *f_ptr = mod == none_mod ? f_addr : (void *) (*f_addr);
 
-        PRETTY_INDENT(buf, indent);
+    if (ftm == get_model_string_meta() || ftm == get_json_meta()) {
+        f_ptr = (void *) (*f_addr);
+    }
 
-        BUF_APPEND_B(buf, '\"');
-        BUF_APPEND_S(buf, fm->path);
-        BUF_APPEND_S(buf, "\":");
+    if (f_ptr == NULL) {
+        return 0;
+    }
 
-        if (fm->mod == none_mod || fm->mod == ptr_mod) {
-            if (ftm->jsonifier) {
-                CHECK_APPEND(ftm->jsonifier(f_ptr, buf, indent + 1, flags));
+    if (*comma) {
+        BUF_APPEND_B(buf, ',');
+    }
+    PRETTY_NL(buf);
+
+    PRETTY_INDENT(buf, indent);
+
+    BUF_APPEND_B(buf, '\"');
+    CHECK_APPEND(string_buf_appendn(buf, key, key_len));
+    BUF_APPEND_S(buf, "\":");
+
+    if (mod == none_mod || mod == ptr_mod) {
+        if (ftm->jsonifier) {
+            CHECK_APPEND(ftm->jsonifier(f_ptr, buf, indent + 1, flags));
+        }
+        else {
+            CHECK_APPEND(write_model_to_buf(f_ptr, ftm, buf, indent + 1, flags));
+        }
+    }
+    else if (mod == map_mod) {
+        indent++;
+        model_map *map = (model_map *) f_addr;
+        const char *k;
+        void *v;
+        BUF_APPEND_B(buf, '{');
+        bool need_comma = false;
+        MODEL_MAP_FOREACH(k, v, map) {
+            if (need_comma) {
+                BUF_APPEND_B(buf, ',');
             }
-            else {
-                CHECK_APPEND(write_model_to_buf(f_ptr, ftm, buf, indent + 1, flags));
+            PRETTY_NL(buf);
+            PRETTY_INDENT(buf, indent);
+
+            BUF_APPEND_B(buf, '\"');
+            BUF_APPEND_S(buf, k);
+            BUF_APPEND_S(buf, "\":");
+            if (ftm->jsonifier) {
+                CHECK_APPEND(ftm->jsonifier(v, buf, indent + 1, flags));
+            } else {
+                CHECK_APPEND(write_model_to_buf(v, ftm, buf, indent + 1, flags));
             }
+            need_comma = true;
         }
-        else if (fm->mod == map_mod) {
-            indent++;
-            model_map *map = (model_map *) f_addr;
-            const char *k;
-            void *v;
-            BUF_APPEND_B(buf, '{');
-            bool need_comma = false;
-            MODEL_MAP_FOREACH(k, v, map) {
-                if (need_comma) {
-                    BUF_APPEND_B(buf, ',');
-                }
-                PRETTY_NL(buf);
-                PRETTY_INDENT(buf, indent);
+        BUF_APPEND_B(buf, '}');
+        indent--;
+    } else if (mod == list_mod) {
+        model_list *list = (model_list *) (f_addr);
 
-                BUF_APPEND_B(buf, '\"');
-                BUF_APPEND_S(buf, k);
-                BUF_APPEND_S(buf, "\":");
-                if (ftm->jsonifier) {
-                    CHECK_APPEND(ftm->jsonifier(v, buf, indent + 1, flags));
-                } else {
-                    CHECK_APPEND(write_model_to_buf(v, ftm, buf, indent + 1, flags));
-                }
-                need_comma = true;
+        int idx = 0;
+        BUF_APPEND_B(buf, '[');
+        PRETTY_NL(buf);
+        MODEL_LIST_FOREACH(f_ptr, *list) {
+            if (f_ptr == NULL) { break; }
+            if (idx++ > 0) {
+                BUF_APPEND_B(buf, ',');
+                PRETTY_NL(buf);
             }
-            BUF_APPEND_B(buf, '}');
-            indent--;
-        } else if (fm->mod == list_mod) {
-            model_list *list = (model_list *) (f_addr);
-
-            int idx = 0;
-            BUF_APPEND_B(buf, '[');
-            PRETTY_NL(buf);
-            MODEL_LIST_FOREACH(f_ptr, *list) {
-                if (f_ptr == NULL) { break; }
-                if (idx++ > 0) {
-                    BUF_APPEND_B(buf, ',');
-                    PRETTY_NL(buf);
-                }
 
-                PRETTY_INDENT(buf, indent + 1);
-                if (ftm->jsonifier) {
-                    if (ftm == get_model_number_meta() || ftm == get_model_bool_meta()) {
-                        CHECK_APPEND(ftm->jsonifier(&f_ptr, buf, indent + 1, flags));
-                    } else {
-                        CHECK_APPEND(ftm->jsonifier(f_ptr, buf, indent + 1, flags));
-                    }
+            PRETTY_INDENT(buf, indent + 1);
+            if (ftm->jsonifier) {
+                if (ftm == get_model_number_meta() || ftm == get_model_bool_meta()) {
+                    CHECK_APPEND(ftm->jsonifier(&f_ptr, buf, indent + 1, flags));
                 } else {
-                    CHECK_APPEND(write_model_to_buf(f_ptr, ftm, buf, indent + 1, flags));
+                    CHECK_APPEND(ftm->jsonifier(f_ptr, buf, indent + 1, flags));
                 }
+            } else {
+                CHECK_APPEND(write_model_to_buf(f_ptr, ftm, buf, indent + 1, flags));
             }
-            PRETTY_NL(buf);
-            PRETTY_INDENT(buf, indent);
-            BUF_APPEND_B(buf, ']');
-        } else if (fm->mod == array_mod) {
-            void **arr = (void **) (*f_addr);
+        }
+        PRETTY_NL(buf);
+        PRETTY_INDENT(buf, indent);
+        BUF_APPEND_B(buf, ']');
+    } else if (mod == array_mod) {
+        void **arr = (void **) (*f_addr);
 
-            BUF_APPEND_B(buf, '[');
-            PRETTY_NL(buf);
-            for (int idx = 0; true; idx++) {
-                f_ptr = arr[idx];
-                if (f_ptr == NULL) { break; }
-                if (idx > 0) {
-                    BUF_APPEND_B(buf, ',');
-                    PRETTY_NL(buf);
-                }
+        BUF_APPEND_B(buf, '[');
+        PRETTY_NL(buf);
+        for (int idx = 0; true; idx++) {
+            f_ptr = arr[idx];
+            if (f_ptr == NULL) { break; }
+            if (idx > 0) {
+                BUF_APPEND_B(buf, ',');
+                PRETTY_NL(buf);
+            }
 
-                PRETTY_INDENT(buf, indent + 1);
-                if (ftm->jsonifier) {
-                    CHECK_APPEND(ftm->jsonifier(f_ptr, buf, indent + 1, flags));
-                }
-                else {
-                    CHECK_APPEND(write_model_to_buf(f_ptr, ftm, buf, indent + 1, flags));
-                }
+            PRETTY_INDENT(buf, indent + 1);
+            if (ftm->jsonifier) {
+                CHECK_APPEND(ftm->jsonifier(f_ptr, buf, indent + 1, flags));
+            }
+            else {
+                CHECK_APPEND(write_model_to_buf(f_ptr, ftm, buf, indent + 1, flags));
             }
-            PRETTY_NL(buf);
-            PRETTY_INDENT(buf, indent);
-            BUF_APPEND_B(buf, ']');
-        } else {
-            ZITI_LOG(ERROR, "unsupported mod[%d] for field[%s]", fm->mod, fm->name);
-            return -1;
         }
-        comma = true;
+        PRETTY_NL(buf);
+        PRETTY_INDENT(buf, indent);
+        BUF_APPEND_B(buf, ']');
+    } else {
+        ZITI_LOG(ERROR, "unsupported mod[%d] for field[%.*s]", mod, (int) key_len, key);
+        return -1;
     }
-    PRETTY_NL(buf);
-    PRETTY_INDENT(buf, indent - 1);
-    BUF_APPEND_B(buf, '}');
+    *comma = true;
     return 0;
 }
 
@@ -634,32 +680,7 @@ int model_from_json(void *obj, json_object *json, const type_meta *meta) {
         if (child == NULL || json_object_get_type(child) == json_type_null)
             continue;
 
-        void *field = (char *) obj + fm->offset;
-        void *ch_obj = field;
-        const type_meta *ch_meta = fm->meta();
-        from_json_func parser = ch_meta->from_json;
-        if (parser == NULL) {
-            parser = model_from_json;
-        }
-        
-        switch (fm->mod) {
-            case none_mod:
-                break;
-            case ptr_mod:
-                ch_obj = calloc(1, ch_meta->size);
-                *(char**)field = ch_obj;
-                break;
-            case array_mod:
-                parser = (from_json_func) model_array_from_json;
-                break;
-            case map_mod:
-                parser = (from_json_func) parse_map_from_json;
-                break;
-            case list_mod:
-                parser = (from_json_func) model_list_from_json;
-                break;
-        }
-        rc = parser(ch_obj, child, ch_meta);
+        rc = model_field_from_json((char *) obj + fm->offset, child, fm->mod, fm->meta());
         if (rc != 0) {
             break;
         }
@@ -672,6 +693,154 @@ int model_from_json(void *obj, json_object *json, const type_meta *meta) {
     return rc;
 }
 
+int model_field_from_json(void *field, json_object *child, enum _field_mod mod, const type_meta *ch_meta) {
+    void *ch_obj = field;
+    from_json_func parser = ch_meta->from_json;
+    if (parser == NULL) {
+        parser = model_from_json;
+    }
+
+    switch (mod) {
+        case none_mod:
+            // store primitives directly
+            if (ch_meta == get_model_string_meta()) {
+                if (json_object_get_type(child) != json_type_string) return -1;
+                *(char **) field = strdup(json_object_get_string(child));
+                return 0;
+            }
+            if (ch_meta == get_model_bool_meta()) {
+                if (json_object_get_type(child) != json_type_boolean) return -1;
+                *(bool *) field = json_object_get_boolean(child);
+                return 0;
+            }
+            if (ch_meta == get_model_number_meta()) {
+                if (json_object_get_type(child) != json_type_int) return -1;
+                *(model_number *) field = (model_number) json_object_get_int64(child);
+                return 0;
+            }
+            break;
+        case ptr_mod:
+            ch_obj = calloc(1, ch_meta->size);
+            *(char**)field = ch_obj;
+            break;
+        case array_mod:
+            parser = (from_json_func) model_array_from_json;
+            break;
+        case map_mod:
+            parser = (from_json_func) parse_map_from_json;
+            break;
+        case list_mod:
+            parser = (from_json_func) model_list_from_json;
+            break;
+    }
+    return parser(ch_obj, child, ch_meta);
+}
+
+#define FIELD_HASH_SEED_TRIES 256
+
+static inline uint32_t field_hash(const char *key, uint32_t seed) {
+    // FNV-1a
+    uint32_t h = 2166136261u ^ seed;
+    for (const unsigned char *p = (const unsigned char *) key; *p; p++) {
+        h ^= *p;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static int build_field_index(model_field_index *idx, const type_meta *meta) {
+    int count = 0;
+    for (int i = 0; i < meta->field_count; i++) {
+        const char *path = meta->fields[i].path;
+        if (path != NULL && path[0] != 0) count++;
+    }
+
+    if (meta->field_count >= UINT8_MAX) {
+        return -1;
+    }
+
+    uint32_t size = 8;
+    while (size < 2 * (uint32_t) count) size <<= 1;
+
+    model_field_index tmp = {0};
+    for (; size <= MODEL_INDEX_MAX_SLOTS; size <<= 1) {
+        for (uint32_t seed = 0; seed < FIELD_HASH_SEED_TRIES; seed++) {
+            memset(tmp.slots, 0, sizeof(tmp.slots));
+            bool collision = false;
+            for (int i = 0; !collision && i < meta->field_count; i++) {
+                const char *path = meta->fields[i].path;
+                if (path == NULL || path[0] == 0) continue;
+
+                uint32_t slot = field_hash(path, seed) & (size - 1);
+                collision = tmp.slots[slot] != 0;
+                tmp.slots[slot] = (uint8_t) (i + 1);
+            }
+
+            if (!collision) {
+                memcpy(idx->slots, tmp.slots, sizeof(idx->slots));
+                idx->seed = seed;
+                idx->mask = size - 1;
+                return 0;
+            }
+        }
+    }
+    return -1;
+}
+
+// must be called once before index is used, IMPL_MODEL_SPECIALIZED does it with uv_once()
+void model_build_field_index(model_field_index *idx, const type_meta *meta) {
+    idx->state = build_field_index(idx, meta) == 0 ? 1 : -1;
+    if (idx->state < 0) {
+        ZITI_LOG(WARN, "could not build field index for model[%s]", meta->name);
+    }
+}
+
+int model_from_json_indexed(void *obj, json_object *json, const type_meta *meta,
+                            model_field_index *idx, model_set_field_f set_field) {
+    if (json_object_get_type(json) != json_type_object) {
+        return -1;
+    }
+
+    int rc = 0;
+    if (idx->state <= 0) {
+        for (int fi = 0; rc == 0 && fi < meta->field_count; fi++) {
+            const field_meta *fm = &meta->fields[fi];
+            if (fm->path == NULL || fm->path[0] == 0)
+                continue;
+
+            json_object *child = json_object_object_get(json, fm->path);
+            if (child == NULL || json_object_get_type(child) == json_type_null)
+                continue;
+
+            rc = set_field(obj, fi, child);
+        }
+    } else {
+        struct json_object_iterator it = json_object_iter_begin(json);
+        struct json_object_iterator end = json_object_iter_end(json);
+        for (; rc == 0 && !json_object_iter_equal(&it, &end); json_object_iter_next(&it)) {
+            json_object *child = json_object_iter_peek_value(&it);
+            if (child == NULL || json_object_get_type(child) == json_type_null)
+                continue;
+
+            const char *key = json_object_iter_peek_name(&it);
+            uint8_t slot = idx->slots[field_hash(key, idx->seed) & idx->mask];
+            if (slot == 0)
+                continue;
+
+            int fi = slot - 1;
+            if (strcmp(key, meta->fields[fi].path) != 0)
+                continue;
+
+            rc = set_field(obj, fi, child);
+        }
+    }
+
+    if (rc != 0) {
+        model_free(obj, meta);
+    }
+    return rc;
+}
+
 static int int_from_json(model_number *val, const json_object *j, const type_meta * UNUSED(meta)) {
     if (json_object_get_type(j) == json_type_int) {
         *val = (model_number)json_object_get_int64(j);
@@ -758,20 +927,55 @@ static int tag_from_json(tag *t, json_object *j, type_meta * UNUSED(m)) {
     return rc;
 }
 
+// RFC3339, e.g. "2019-08-05T14:02:52.337619Z", fraction of any precision and zone offset
+int model_timestamp_from_string(timestamp *t, const char *s) {
+    if (s == NULL) return -1;
+
+    struct tm t2 = {0};
+    int n = 0;
+    if (sscanf(s, "%d-%d-%dT%d:%d:%d%n", &t2.tm_year, &t2.tm_mon, &t2.tm_mday,
+               &t2.tm_hour, &t2.tm_min, &t2.tm_sec, &n) != 6) {
+        return -1;
+    }
+    t2.tm_year -= 1900;
+    t2.tm_mon -= 1;
+
+    const char *p = s + n;
+    long usec = 0;
+    int digits = 0;
+    if (*p == '.') {
+        for (p++; isdigit((unsigned char) *p); p++) {
+            // anything below microseconds is ignored
+            if (digits < 6) {
+                usec = usec * 10 + (*p - '0');
+                digits++;
+            }
+        }
+    }
+    for (; digits < 6; digits++) {
+        usec *= 10;
+    }
+
+    long offset = 0;
+    if (*p == '+' || *p == '-') {
+        int oh, om;
+        if (sscanf(p + 1, "%d:%d", &oh, &om) != 2) {
+            return -1;
+        }
+        offset = (oh * 60 + om) * 60;
+        if (*p == '-') offset = -offset;
+    } else if (*p != 'Z' && *p != 'z') {
+        return -1;
+    }
+
+    t->tv_sec = timegm(&t2) - offset;
+    t->tv_usec = usec;
+    return 0;
+}
+
 static int timeval_from_json(timestamp *t, json_object *j, type_meta * UNUSED(meta)) {
     if (json_object_get_type(j) == json_type_string) {
-        struct tm t2 = {0};
-        // "2019-08-05T14:02:52.337619Z"
-        unsigned long usec;
-        sscanf(json_object_get_string(j), "%d-%d-%dT%d:%d:%d.%ldZ",
-               &t2.tm_year, &t2.tm_mon, &t2.tm_mday,
-               &t2.tm_hour, &t2.tm_min, &t2.tm_sec, &usec);
-        t2.tm_year -= 1900;
-        t2.tm_mon -= 1;
-
-        t->tv_sec = timegm(&t2);
-        t->tv_usec = (int)usec;
-        return 0;
+        return model_timestamp_from_string(t, json_object_get_string(j));
     }
     return -1;
 }
@@ -837,13 +1041,78 @@ static int m_int_to_json(const model_number *v, string_buf_t *buf, int UNUSED(in
     return rc;
 }
 
+static inline unsigned first_bit(uint32_t mask) {
+#if _MSC_VER
+    unsigned long idx;
+    _BitScanForward(&idx, mask);
+    return (unsigned) idx;
+#else
+    return (unsigned) __builtin_ctz(mask);
+#endif
+}
+
+#define json_needs_escape(c) ((c) < 0x20 || (c) == '"' || (c) == '\\')
+
+// returns offset of the first byte that has to be escaped, or len if there are none
+static size_t json_escape_scan(const unsigned char *s, size_t len) {
+    size_t i = 0;
+#if JSON_SCAN_AVX2
+    const __m256i quote32 = _mm256_set1_epi8('"');
+    const __m256i bslash32 = _mm256_set1_epi8('\\');
+    const __m256i ctrl32 = _mm256_set1_epi8(0x1f);
+    for (; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *) (s + i));
+        __m256i m = _mm256_or_si256(
+                _mm256_or_si256(_mm256_cmpeq_epi8(v, quote32), _mm256_cmpeq_epi8(v, bslash32)),
+                _mm256_cmpeq_epi8(_mm256_min_epu8(v, ctrl32), v)); // v <= 0x1f
+        uint32_t mask = (uint32_t) _mm256_movemask_epi8(m);
+        if (mask != 0) {
+            return i + first_bit(mask);
+        }
+    }
+#endif
+#if JSON_SCAN_SSE2
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i bslash = _mm_set1_epi8('\\');
+    const __m128i ctrl = _mm_set1_epi8(0x1f);
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *) (s + i));
+        __m128i m = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, bslash)),
+                _mm_cmpeq_epi8(_mm_min_epu8(v, ctrl), v)); // v <= 0x1f
+        uint32_t mask = (uint32_t) _mm_movemask_epi8(m);
+        if (mask != 0) {
+            return i + first_bit(mask);
+        }
+    }
+#endif
+    for (; i < len; i++) {
+        if (json_needs_escape(s[i])) {
+            break;
+        }
+    }
+    return i;
+}
+
 static int m_string_to_json(const char *str, string_buf_t *buf, int UNUSED(indent), int UNUSED(flags)) {
     static char hex[] = "0123456789abcdef";
 
     BUF_APPEND_B(buf, '\"');
     const unsigned char *s = (const unsigned char *) str;
+    size_t len = strlen(str);
+
+    while (len > 0) {
+        // copy clean run in bulk
+        size_t run = json_escape_scan(s, len);
+        if (run > 0) {
+            CHECK_APPEND(string_buf_appendn(buf, (const char *) s, run));
+            s += run;
+            len -= run;
+            if (len == 0) {
+                break;
+            }
+        }
 
-    while (*s != '\0') {
         switch (*s) {
             case '\n':
                 BUF_APPEND_S(buf, "\\n");
@@ -864,16 +1133,13 @@ static int m_string_to_json(const char *str, string_buf_t *buf, int UNUSED(inden
                 BUF_APPEND_S(buf, "\\\"");
                 break;
             default:
-                if (*s < ' ') {
-                    BUF_APPEND_B(buf, '\\');
-                    BUF_APPEND_S(buf, "u00");
-                    BUF_APPEND_B(buf, hex[*s >> 4]);
-                    BUF_APPEND_B(buf, hex[*s & 0xF]);
-                } else {
-                    BUF_APPEND_B(buf, *s);
-                }
+                BUF_APPEND_B(buf, '\\');
+                BUF_APPEND_S(buf, "u00");
+                BUF_APPEND_B(buf, hex[*s >> 4]);
+                BUF_APPEND_B(buf, hex[*s & 0xF]);
         }
         s++;
+        len--;
     }
     BUF_APPEND_B(buf, '"');
     return 0;
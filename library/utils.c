@@ -25,6 +25,7 @@
 #if _WIN32
 #include <time.h>
 #endif
+#include <ctype.h>
 
 
 #if !defined(ZITI_VERSION)
@@ -415,6 +416,8 @@ static const char *get_utc_time() {
 
 int lt_zero(int v) { return v < 0; }
 
+int non_zero(int v) { return v != 0; }
+
 void hexDump (char *desc, void *addr, int len) {
     ZITI_LOG(DEBUG, " ");
     int i;
@@ -687,4 +690,4 @@ uint64_t next_backoff(int *count, int max, uint64_t base) {
 
     *count = c;
     return random % ((1U << backoff) * base);
-}
\ No newline at end of file
+}
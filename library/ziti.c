@@ -19,6 +19,7 @@
 #include "oidc.h"
 #include "utils.h"
 #include "zt_internal.h"
+#include "ztx_cache.h"
 #include <auth_queries.h>
 #include <uv.h>
 #include <assert.h>
@@ -75,6 +76,25 @@ static void on_create_cert(ziti_create_api_cert_resp *resp, const ziti_error *e,
 static int ztx_init_controller(ziti_context ztx);
 static void ztx_config_update(ziti_context ztx);
 
+static void ztx_load_cache(ziti_context ztx);
+static void ztx_save_cache(ziti_context ztx);
+static void ztx_flush_cache(ziti_context ztx);
+
+struct cache_write_s {
+    uv_work_t w;
+    ziti_context ztx; // NULL if context was released while work was in flight
+    char *path;
+    char *data;
+    size_t len;
+};
+
+static void ztx_prefetch_sessions(ziti_context ztx);
+
+static void update_services(ziti_service_array services, const ziti_error *error, void *ctx);
+static void check_service_update(ziti_service_update *update, const ziti_error *err, void *ctx);
+static void initial_service_update_cb(ziti_service_update *update, const ziti_error *err, void *ctx);
+static void initial_services_cb(ziti_service_array services, const ziti_error *error, void *ctx);
+
 static uint32_t ztx_seq;
 
 struct ztx_req_s {
@@ -90,6 +110,7 @@ static ziti_options default_options = {
         .config_types = all_configs,
         .refresh_interval = 0,
         .api_page_size = 25,
+        .api_page_concurrency = 4,
 };
 
 static size_t parse_ref(const char *val, const char **res) {
@@ -373,6 +394,14 @@ void ziti_set_fully_authenticated(ziti_context ztx, const char *session_token) {
             ziti_channel_update_token(ch);
         }
     }
+    // connect to last known edge routers without waiting for the current list
+    ziti_edge_router *er;
+    MODEL_LIST_FOREACH(er, ztx->cached_routers) {
+        ztx_add_edge_router(ztx, er->name, er->protocols.tls);
+    }
+    model_list_clear(&ztx->cached_routers, (void (*)(void *)) free_ziti_edge_router_ptr);
+    ztx_fill_key_pool(ztx);
+
     ziti_ctrl_get_well_known_certs(ctrl, ca_bundle_cb, ztx);
     ziti_ctrl_current_identity(ctrl, update_identity_data, ztx);
 
@@ -402,7 +431,17 @@ void ziti_set_fully_authenticated(ziti_context ztx, const char *session_token) {
         ziti_ctrl_create_api_certificate(ztx_get_controller(ztx), ztx->sessionCsr, on_create_cert, ztx);
     }
 
-    ziti_services_refresh(ztx, true);
+    // everything below only depends on the API session,
+    // issue the requests together rather than waiting for the refresh timer
+    ziti_ctrl_current_edge_routers(ctrl, edge_routers_cb, ztx);
+    if (ztx->last_update == NULL) {
+        // nothing to compare the update check against yet -- fetch services with it
+        ztx->initial_list_pending = true;
+        ziti_ctrl_get_services_update(ctrl, initial_service_update_cb, ztx);
+        ziti_ctrl_get_services(ctrl, initial_services_cb, ztx);
+    } else {
+        ziti_ctrl_get_services_update(ctrl, check_service_update, ztx);
+    }
     ziti_posture_init(ztx, 20);
 }
 
@@ -454,7 +493,10 @@ static void ziti_stop_internal(ziti_context ztx, void *data) {
             ztx->posture_checks = NULL;
         }
 
+        ztx_flush_cache(ztx);
+        model_list_clear(&ztx->prefetch_queue, free);
         model_map_clear(&ztx->sessions, (void (*)(void *)) free_ziti_session_ptr);
+        model_list_clear(&ztx->cached_routers, (void (*)(void *)) free_ziti_edge_router_ptr);
 
         // close all channels
         ziti_close_channels(ztx, ZITI_DISABLED);
@@ -535,6 +577,7 @@ static void ziti_start_internal(ziti_context ztx, void *init_req) {
         uv_prepare_start(ztx->prepper, ztx_prepare);
         ztx->start = uv_now(ztx->loop);
         ziti_set_unauthenticated(ztx, NULL);
+        ztx_load_cache(ztx);
 
         ziti_re_auth(ztx);
     }
@@ -603,6 +646,10 @@ static int ztx_init_controller(ziti_context ztx) {
     if (ztx->opts.api_page_size != 0) {
         ziti_ctrl_set_page_size(ztx_get_controller(ztx), ztx->opts.api_page_size);
     }
+    if (ztx->opts.api_page_concurrency != 0) {
+        ziti_ctrl_set_page_concurrency(ztx_get_controller(ztx), ztx->opts.api_page_concurrency);
+    }
+    ziti_ctrl_set_hedging(ztx_get_controller(ztx), ztx->opts.api_request_hedging);
     return 0;
 }
 
@@ -611,6 +658,8 @@ static void ziti_init_async(ziti_context ztx, void *data) {
     uv_loop_t *loop = ztx->w_async.loop;
     
     ztx->refresh_timer = new_ztx_timer(ztx);
+    ztx->cache_timer = new_ztx_timer(ztx);
+    uv_unref((uv_handle_t *) ztx->cache_timer);
 
     ztx->prepper = calloc(1, sizeof(uv_prepare_t));
     uv_prepare_init(loop, ztx->prepper);
@@ -739,6 +788,13 @@ static void free_ztx(uv_handle_t *h) {
     ziti_posture_checks_free(ztx->posture_checks);
     model_map_clear(&ztx->services, (_free_f) free_ziti_service_ptr);
     model_map_clear(&ztx->sessions, (_free_f) free_ziti_session_ptr);
+    model_list_clear(&ztx->cached_routers, (_free_f) free_ziti_edge_router_ptr);
+    ztx_free_key_pool(ztx);
+    if (ztx->cache_write) {
+        // done callback will release it
+        ztx->cache_write->ztx = NULL;
+        ztx->cache_write = NULL;
+    }
     ziti_set_unauthenticated(ztx, NULL);
     free_ziti_identity_data(ztx->identity_data);
     FREE(ztx->identity_data);
@@ -746,6 +802,8 @@ static void free_ztx(uv_handle_t *h) {
     FREE(ztx->session_token);
 
     ziti_ctrl_close(ztx_get_controller(ztx));
+    ztx_clear_session_requests(ztx);
+    model_list_clear(&ztx->prefetch_queue, free);
     if (ztx->tlsCtx) ztx->tlsCtx->free_ctx(ztx->tlsCtx);
     if (ztx->id_creds.cert) {
         ztx->id_creds.cert->free(ztx->id_creds.cert);
@@ -782,6 +840,7 @@ static void shutdown_and_free(ziti_context ztx) {
     grim_reaper(ztx);
     CLOSE_AND_NULL(ztx->prepper);
     CLOSE_AND_NULL(ztx->refresh_timer);
+    CLOSE_AND_NULL(ztx->cache_timer);
 
     ztx->tlsCtx->free_ctx(ztx->tlsCtx);
     ztx->tlsCtx = NULL;
@@ -917,7 +976,18 @@ void ziti_dump(ziti_context ztx, int (*printer)(void *arg, const char *fmt, ...)
         printer(ctx, "\tconnected[%c] version[%s] address[%s]",
                 ziti_channel_is_connected(ch) ? 'Y' : 'N', ch->version, url);
         if (ziti_channel_is_connected(ch)) {
-            printer(ctx, " latency[%" PRIu64 "]\n", ziti_channel_latency(ch));
+            printer(ctx, " latency[%" PRIu64 "] avg[%" PRIu64 "] jitter[%" PRIu64 "] score[%" PRIu64 "]\n",
+                    ziti_channel_latency(ch), ch->rtt, ch->rtt_var, ziti_channel_score(ch));
+            printer(ctx, "\trtt histogram:");
+            for (int i = 0; i < CH_RTT_BUCKETS; i++) {
+                uint64_t upper = ziti_channel_rtt_bucket(i);
+                if (upper == UINT64_MAX) {
+                    printer(ctx, " [inf]=%u", ch->rtt_hist[i]);
+                } else {
+                    printer(ctx, " [<%" PRIu64 "]=%u", upper, ch->rtt_hist[i]);
+                }
+            }
+            printer(ctx, "\n");
         } else {
             printer(ctx, "\n");
         }
@@ -1173,6 +1243,10 @@ void ziti_force_service_update(ziti_context ztx, const char* service_id) {
     model_map_set(&ztx->service_forced_updates, service_id, (void *) (uintptr_t) true);
 }
 
+static int is_service_posture_updated(ziti_context ztx, ziti_service *new, ziti_service *old);
+
+static bool process_service_updates(ziti_context ztx, model_map *updates, const model_map *listed);
+
 // is_service_updated returns 0 if the direct service properties
 // and configurations have not been altered. Will return non-0
 // values if they have. This ignores posture query alterations.
@@ -1194,6 +1268,18 @@ static int is_service_updated(ziti_context ztx, ziti_service *new, ziti_service
         return 1;
     }
 
+    if (is_service_posture_updated(ztx, new, old) != 0) {
+        return 1;
+    }
+
+    ZTX_LOG(VERBOSE, "service [%s] is not updated, default case", new->name);
+    //no change
+    return 0;
+}
+
+// is_service_posture_updated returns non-0 if the posture policies,
+// their passing state, or timeouts differ between new and old.
+static int is_service_posture_updated(ziti_context ztx, ziti_service *new, ziti_service *old) {
     const char *policy_id;
     const ziti_posture_query_set *new_set;
     MODEL_MAP_FOREACH(policy_id, new_set, &new->posture_query_map) {
@@ -1228,14 +1314,11 @@ static int is_service_updated(ziti_context ztx, ziti_service *new, ziti_service
         }
     }
 
-    ZTX_LOG(VERBOSE, "service [%s] is not updated, default case", new->name);
-    //no change
     return 0;
 }
 
-static void update_services(ziti_service_array services, const ziti_error *error, void *ctx) {
-    ziti_context ztx = ctx;
-
+// handles service refresh error, returns true if there was one
+static bool services_refresh_failed(ziti_context ztx, const ziti_error *error) {
     // schedule next refresh
     ziti_services_refresh(ztx, false);
 
@@ -1247,28 +1330,49 @@ static void update_services(ziti_service_array services, const ziti_error *error
             ziti_re_auth(ztx);
         } else if (error->err == ZITI_PARTIALLY_AUTHENTICATED) {
             ZTX_LOG(VERBOSE, "api session partially authenticated, waiting for api session state change");
-            return;
         } else {
             FREE(ztx->last_update);
             update_ctrl_status(ztx, ZITI_CONTROLLER_UNAVAILABLE, error->message);
         }
-        return;
+        return true;
     }
     update_ctrl_status(ztx, ZITI_OK, NULL);
+    return false;
+}
 
-
-    ZTX_LOG(VERBOSE, "processing service updates");
-
-    model_map updates = {0};
-
-    int idx;
-    for (idx = 0; services[idx] != NULL; idx++) {
+// moves services into map<name,service>, preparing them for comparison
+static void services_to_map(ziti_service_array services, model_map *map) {
+    for (int idx = 0; services[idx] != NULL; idx++) {
         set_service_flags(services[idx]);
         set_posture_query_defaults(services[idx]);
         set_service_posture_policy_map(services[idx]);
-        model_map_set(&updates, services[idx]->name, services[idx]);
+        model_map_set(map, services[idx]->name, services[idx]);
     }
     free(services);
+}
+
+static void update_services(ziti_service_array services, const ziti_error *error, void *ctx) {
+    ziti_context ztx = ctx;
+
+    if (services_refresh_failed(ztx, error)) {
+        return;
+    }
+
+    model_map updates = {0};
+    services_to_map(services, &updates);
+    if (process_service_updates(ztx, &updates, NULL)) {
+        ztx_save_cache(ztx);
+        ztx_prefetch_sessions(ztx);
+    }
+}
+
+// returns true if any services were added, removed, or changed
+// updates: map<name, ziti_service> of received services, consumed by this function
+// listed: if not NULL, map<name, ziti_service> of all currently available services (incremental refresh),
+//         services not in `updates` but present in `listed` are retained as is;
+//         otherwise `updates` is the full list of available services
+static bool process_service_updates(ziti_context ztx, model_map *updates, const model_map *listed) {
+    ZTX_LOG(VERBOSE, "processing service updates");
 
     size_t current_size = model_map_size(&ztx->services);
     size_t chIdx = 0, addIdx = 0, remIdx = 0;
@@ -1277,14 +1381,15 @@ static void update_services(ziti_service_array services, const ziti_error *error
             .service = {
                     .removed = calloc(current_size + 1, sizeof(ziti_service *)),
                     .changed = calloc(current_size + 1, sizeof(ziti_service *)),
-                    .added = calloc(idx + 1, sizeof(ziti_service *)),
+                    .added = calloc(model_map_size(updates) + 1, sizeof(ziti_service *)),
             }
     };
 
+    int idx;
     ziti_service *s;
     model_map_iter it = model_map_iterator(&ztx->services);
     while (it != NULL) {
-        ziti_service *updt = model_map_remove(&updates, model_map_it_key(it));
+        ziti_service *updt = model_map_remove(updates, model_map_it_key(it));
 
         if (updt != NULL) {
             if (is_service_updated(ztx, updt, model_map_it_value(it)) != 0) {
@@ -1295,6 +1400,9 @@ static void update_services(ziti_service_array services, const ziti_error *error
                 free(updt);
             }
 
+            it = model_map_it_next(it);
+        } else if (listed && model_map_get(listed, model_map_it_key(it)) != NULL) {
+            // not modified since last refresh
             it = model_map_it_next(it);
         } else {
             // service was removed
@@ -1312,7 +1420,7 @@ static void update_services(ziti_service_array services, const ziti_error *error
     }
 
     // what's left are new services
-    it = model_map_iterator(&updates);
+    it = model_map_iterator(updates);
     while (it != NULL) {
         s = model_map_it_value(it);
         ev.service.added[addIdx++] = s;
@@ -1353,8 +1461,9 @@ static void update_services(ziti_service_array services, const ziti_error *error
     free(ev.service.added);
     free(ev.service.changed);
 
-    model_map_clear(&updates, NULL);
+    model_map_clear(updates, NULL);
     model_map_clear(&ztx->service_forced_updates, NULL);
+    return (addIdx + remIdx + chIdx) > 0;
 }
 
 // set_service_posture_policy_map checks to see if the controller
@@ -1376,6 +1485,151 @@ static void set_service_posture_policy_map(ziti_service *service) {
     FREE(service->posture_query_set);
 }
 
+// incremental refresh falls back to full service list if more than that many
+// services need to be fetched by id
+#define INCREMENTAL_REFRESH_MAX_IDS 50
+
+// config changes are not reflected in service updatedAt,
+// do full refresh every so often to pick them up
+#define INCREMENTAL_REFRESH_FULL_EVERY 10
+
+struct service_refresh_s {
+    ziti_context ztx;
+    // map<name,ziti_service> -- services without configs
+    model_map listed;
+};
+
+static void free_service_refresh(struct service_refresh_s *req) {
+    model_map_clear(&req->listed, (void (*)(void *)) free_ziti_service_ptr);
+    free(req);
+}
+
+static void incremental_update_cb(ziti_service_array services, const ziti_error *error, void *ctx) {
+    struct service_refresh_s *req = ctx;
+    ziti_context ztx = req->ztx;
+
+    if (!services_refresh_failed(ztx, error)) {
+        model_map updates = {0};
+        services_to_map(services, &updates);
+        ZTX_LOG(DEBUG, "incremental refresh: received %zd modified services", model_map_size(&updates));
+        if (process_service_updates(ztx, &updates, &req->listed)) {
+            ztx_save_cache(ztx);
+            ztx_prefetch_sessions(ztx);
+        }
+    }
+    free_service_refresh(req);
+}
+
+// compare service updatedAt by the time it represents, missing or invalid sorts first
+static int updated_at_cmp(const char *lh, const char *rh) {
+    timestamp l, r;
+    bool l_ok = model_timestamp_from_string(&l, lh) == 0;
+    bool r_ok = model_timestamp_from_string(&r, rh) == 0;
+    if (!l_ok || !r_ok) {
+        return (int) l_ok - (int) r_ok;
+    }
+    return model_cmp(&l, &r, get_timestamp_meta());
+}
+
+static void incremental_list_cb(ziti_service_array services, const ziti_error *error, void *ctx) {
+    ziti_context ztx = ctx;
+
+    if (error) {
+        services_refresh_failed(ztx, error);
+        return;
+    }
+
+    NEWP(req, struct service_refresh_s);
+    req->ztx = ztx;
+    services_to_map(services, &req->listed);
+
+    // anything modified after the newest service we have is picked up by updatedAt filter
+    const char *since = NULL;
+    const char *name;
+    ziti_service *s;
+    MODEL_MAP_FOREACH(name, s, &ztx->services) {
+        if (since == NULL || updated_at_cmp(s->updated_at, since) > 0) {
+            since = s->updated_at;
+        }
+    }
+
+    // the rest (newly accessible, permission or posture changes) are fetched by id
+    size_t modified = 0;
+    model_list ids = {0};
+    MODEL_MAP_FOREACH(name, s, &req->listed) {
+        ziti_service *current = model_map_get(&ztx->services, name);
+        if (current != NULL &&
+            updated_at_cmp(current->updated_at, s->updated_at) == 0 &&
+            current->perm_flags == s->perm_flags &&
+            is_service_posture_updated(ztx, s, current) == 0) {
+            continue;
+        }
+
+        modified++;
+        if (since == NULL || updated_at_cmp(s->updated_at, since) <= 0) {
+            model_list_append(&ids, s->id);
+        }
+    }
+
+    if (modified == 0) {
+        ZTX_LOG(DEBUG, "incremental refresh: no modified services");
+        ziti_services_refresh(ztx, false);
+        update_ctrl_status(ztx, ZITI_OK, NULL);
+
+        model_map updates = {0};
+        if (process_service_updates(ztx, &updates, &req->listed)) {
+            ztx_save_cache(ztx);
+        }
+        free_service_refresh(req);
+        return;
+    }
+
+    if (model_list_size(&ids) > INCREMENTAL_REFRESH_MAX_IDS) {
+        ZTX_LOG(DEBUG, "incremental refresh: %zd services to fetch by id, falling back to full refresh",
+                model_list_size(&ids));
+        model_list_clear(&ids, NULL);
+        free_service_refresh(req);
+        ziti_ctrl_get_services(ztx_get_controller(ztx), update_services, ztx);
+        return;
+    }
+
+    string_buf_t *filter = new_string_buf();
+    if (since) {
+        string_buf_fmt(filter, "updatedAt > datetime(%s)", since);
+    }
+    if (model_list_size(&ids) > 0) {
+        string_buf_append(filter, since ? " or id in [" : "id in [");
+        const char *id;
+        bool first = true;
+        MODEL_LIST_FOREACH(id, ids) {
+            string_buf_fmt(filter, "%s\"%s\"", first ? "" : ",", id);
+            first = false;
+        }
+        string_buf_append_byte(filter, ']');
+    }
+    char *f = string_buf_to_string(filter, NULL);
+    delete_string_buf(filter);
+    model_list_clear(&ids, NULL);
+
+    ZTX_LOG(DEBUG, "incremental refresh: fetching %zd modified services", modified);
+    ZTX_LOG(VERBOSE, "incremental refresh filter: %s", f);
+    ziti_ctrl_get_services_filtered(ztx_get_controller(ztx), f, incremental_update_cb, req);
+    free(f);
+}
+
+static bool use_incremental_refresh(ziti_context ztx) {
+    if (!ztx->opts.incremental_service_refresh || !ztx->services_loaded) {
+        return false;
+    }
+
+    // forced updates need to be compared against full service details
+    if (model_map_size(&ztx->service_forced_updates) > 0) {
+        return false;
+    }
+
+    return ++ztx->service_refresh_count % INCREMENTAL_REFRESH_FULL_EVERY != 0;
+}
+
 static void check_service_update(ziti_service_update *update, const ziti_error *err, void *ctx) {
     ziti_context ztx = ctx;
 
@@ -1386,21 +1640,291 @@ static void check_service_update(ziti_service_update *update, const ziti_error *
         if (err->err != ZITI_DISABLED) {
             ziti_services_refresh(ztx, false);
         }
-    } else if (ztx->last_update == NULL || strcmp(ztx->last_update, update->last_change) != 0) {
-        ZTX_LOG(VERBOSE, "ztx last_update = %s", update->last_change);
-        FREE(ztx->last_update);
-        ztx->last_update = (char*)update->last_change;
-        ziti_ctrl_get_services(ztx_get_controller(ztx), update_services, ztx);
+    } else switch (ztx_service_check(ztx->last_update, update)) {
+        case SERVICES_UNCHANGED:
+            if (update) {
+                ZTX_LOG(VERBOSE, "not updating: last_update is same previous (%s == %s)", update->last_change,
+                        ztx->last_update);
+                free_ziti_service_update(update);
+            } else {
+                ZTX_LOG(VERBOSE, "not updating: service updates not modified");
+            }
+            ziti_services_refresh(ztx, false);
+            break;
 
-    } else {
-        ZTX_LOG(VERBOSE, "not updating: last_update is same previous (%s == %s)", update->last_change,
-                ztx->last_update);
+        case SERVICES_CHECK_AGAIN:
+            // previous service fetch failed (or its marker was not recorded),
+            // 'not modified' does not tell if services we have are current
+            ZTX_LOG(VERBOSE, "service updates not modified, but last_update is unknown: checking again");
+            ziti_ctrl_clear_validators(ztx_get_controller(ztx));
+            ziti_ctrl_get_services_update(ztx_get_controller(ztx), check_service_update, ztx);
+            break;
+
+        case SERVICES_CHANGED:
+            ZTX_LOG(VERBOSE, "ztx last_update = %s", update->last_change);
+            FREE(ztx->last_update);
+            ztx->last_update = (char*)update->last_change;
+            if (use_incremental_refresh(ztx)) {
+                ziti_ctrl_list_services(ztx_get_controller(ztx), incremental_list_cb, ztx);
+            } else {
+                ziti_ctrl_get_services(ztx_get_controller(ztx), update_services, ztx);
+            }
+            break;
+    }
+    FREE(update);
+}
+
+enum service_check ztx_service_check(const char *last_update, const ziti_service_update *update) {
+    if (update == NULL) {
+        return last_update ? SERVICES_UNCHANGED : SERVICES_CHECK_AGAIN;
+    }
+
+    if (last_update == NULL || strcmp(last_update, update->last_change) != 0) {
+        return SERVICES_CHANGED;
+    }
+    return SERVICES_UNCHANGED;
+}
+
+static void initial_services_cb(ziti_service_array services, const ziti_error *error, void *ctx) {
+    ziti_context ztx = ctx;
+    ztx->initial_list_pending = false;
+    update_services(services, error, ctx);
+}
+
+// records the change marker for the initial service list that is requested at the same time,
+// service list response takes care of scheduling the next refresh
+static void initial_service_update_cb(ziti_service_update *update, const ziti_error *err, void *ctx) {
+    ziti_context ztx = ctx;
+
+    if (err) {
+        ZTX_LOG(WARN, "failed to poll service updates: code[%d] err[%d/%s]",
+                (int)err->http_code, (int)err->err, err->message);
+        return;
+    }
+
+    if (update == NULL) {
+        return;
+    }
+
+    // marker may be newer than the service list that already arrived,
+    // leave it unset so that next poll fetches services again
+    if (!ztx->initial_list_pending) {
+        ZTX_LOG(VERBOSE, "service list completed before update check, not recording last_update[%s]",
+                update->last_change);
         free_ziti_service_update(update);
-        ziti_services_refresh(ztx, false);
+        FREE(update);
+        return;
     }
+
+    ZTX_LOG(VERBOSE, "ztx last_update = %s", update->last_change);
+    FREE(ztx->last_update);
+    ztx->last_update = (char*)update->last_change;
     FREE(update);
 }
 
+static char *ztx_cache_key(ziti_context ztx) {
+    string_buf_t *b = new_string_buf();
+    string_buf_fmt(b, "%s|%s",
+                   ztx->config.controller_url ? ztx->config.controller_url : "",
+                   ztx->config.id.cert ? ztx->config.id.cert : "");
+    char *key = string_buf_to_string(b, NULL);
+    delete_string_buf(b);
+    return key;
+}
+
+static void ztx_load_cache(ziti_context ztx) {
+    if (ztx->opts.cache_path == NULL) {
+        return;
+    }
+
+    ztx_cache cache = {0};
+    char *key = ztx_cache_key(ztx);
+    int rc = ztx_cache_read(ztx->opts.cache_path, key, &cache);
+    free(key);
+    if (rc != 0) {
+        return;
+    }
+
+    ZTX_LOG(INFO, "warm start from cache[%s]", ztx->opts.cache_path);
+
+    // channels are connected once authenticated
+    ziti_edge_router *er;
+    MODEL_LIST_FOREACH(er, cache.edge_routers) {
+        if (er->protocols.tls) {
+            model_list_append(&ztx->cached_routers, er);
+        } else {
+            free_ziti_edge_router_ptr(er);
+        }
+    }
+    model_list_clear(&cache.edge_routers, NULL);
+
+    // services are reported right away, and reconciled on the first refresh
+    model_map updates = {0};
+    model_map_iter it = model_map_iterator(&cache.services);
+    while (it != NULL) {
+        ziti_service *s = model_map_it_value(it);
+        set_service_flags(s);
+        model_map_set(&updates, s->name, s);
+        it = model_map_it_remove(it);
+    }
+    process_service_updates(ztx, &updates, NULL);
+
+    ztx_cache_free(&cache);
+}
+
+// delay before writing cache after a change, consecutive changes are written together
+#define CACHE_SAVE_DELAY 5000
+
+static void cache_write_work(uv_work_t *w) {
+    struct cache_write_s *cw = container_of(w, struct cache_write_s, w);
+    ztx_cache_save(cw->path, cw->data, cw->len);
+}
+
+static void cache_write_done(uv_work_t *w, int status) {
+    struct cache_write_s *cw = container_of(w, struct cache_write_s, w);
+    ziti_context ztx = cw->ztx;
+    if (ztx != NULL) {
+        ztx->cache_write = NULL;
+        if (ztx->cache_dirty) {
+            ztx->cache_dirty = false;
+            ztx_save_cache(ztx);
+        }
+    }
+    free(cw->path);
+    free(cw->data);
+    free(cw);
+}
+
+// serialize current state and write it on the threadpool
+static void ztx_write_cache(ziti_context ztx) {
+    if (ztx->cache_write != NULL) {
+        // write again once current one completes
+        ztx->cache_dirty = true;
+        return;
+    }
+
+    ztx_cache cache = {
+            .services = ztx->services,
+    };
+
+    const char *url;
+    ziti_channel_t *ch;
+    MODEL_MAP_FOREACH(url, ch, &ztx->channels) {
+        ziti_edge_router *er = alloc_ziti_edge_router();
+        er->name = (char *) ch->name;
+        er->protocols.tls = (char *) url;
+        model_list_append(&cache.edge_routers, er);
+    }
+
+    NEWP(cw, struct cache_write_s);
+    cw->ztx = ztx;
+    cw->path = strdup(ztx->opts.cache_path);
+    char *key = ztx_cache_key(ztx);
+    cw->data = ztx_cache_encode(key, &cache, &cw->len);
+    free(key);
+
+    // only edge router structs are owned here
+    model_list_clear(&cache.edge_routers, free);
+
+    ztx->cache_write = cw;
+    if (uv_queue_work(ztx->loop, &cw->w, cache_write_work, cache_write_done) != 0) {
+        ztx->cache_write = NULL;
+        free(cw->path);
+        free(cw->data);
+        free(cw);
+    }
+}
+
+static void cache_timer_cb(uv_timer_t *t) {
+    ztx_write_cache(t->data);
+}
+
+static void ztx_save_cache(ziti_context ztx) {
+    if (ztx->opts.cache_path == NULL || !ztx->services_loaded || ztx->cache_timer == NULL) {
+        return;
+    }
+
+    if (!uv_is_active((const uv_handle_t *) ztx->cache_timer)) {
+        uv_timer_start(ztx->cache_timer, cache_timer_cb, CACHE_SAVE_DELAY, 0);
+    }
+}
+
+// write pending changes right away
+static void ztx_flush_cache(ziti_context ztx) {
+    if (ztx->cache_timer && uv_is_active((const uv_handle_t *) ztx->cache_timer)) {
+        uv_timer_stop(ztx->cache_timer);
+        ztx_write_cache(ztx);
+    }
+}
+
+static void prefetch_sessions_cb(ziti_session **sessions, const ziti_error *err, void *ctx) {
+    ziti_context ztx = ctx;
+
+    if (err) {
+        ZTX_LOG(WARN, "failed to get current sessions: code[%d] %s/%s",
+                (int)err->http_code, err->code, err->message);
+        return;
+    }
+
+    int listed = 0;
+    for (int idx = 0; sessions && sessions[idx] != NULL; idx++) {
+        ziti_session *s = sessions[idx];
+        ziti_session *existing = s->service_id ? model_map_get(&ztx->sessions, s->service_id) : NULL;
+        if (s->type != ziti_session_types.Dial ||
+            (existing != NULL && !existing->refresh) ||
+            model_map_get(&ztx->session_requests, s->service_id) != NULL) {
+            free_ziti_session_ptr(s);
+            continue;
+        }
+
+        // listed session may come without edge routers, get the details on first dial
+        s->refresh = model_list_size(&s->edge_routers) == 0;
+        free_ziti_session_ptr(model_map_set(&ztx->sessions, s->service_id, s));
+        listed++;
+    }
+    free(sessions);
+
+    // only services without any session are requested,
+    // sessions that need refresh are refreshed on first dial
+    model_list_clear(&ztx->prefetch_queue, free);
+    const char *name;
+    ziti_service *service;
+    MODEL_MAP_FOREACH(name, service, &ztx->services) {
+        if (ziti_service_has_permission(service, ziti_session_types.Dial) &&
+            model_map_get(&ztx->sessions, service->id) == NULL) {
+            model_list_append(&ztx->prefetch_queue, strdup(service->id));
+        }
+    }
+    ZTX_LOG(DEBUG, "prefetched %d sessions, %zd more to request", listed, model_list_size(&ztx->prefetch_queue));
+    ztx_prefetch_next(ztx);
+}
+
+void ztx_prefetch_next(ziti_context ztx) {
+    if (ztx->auth_state != ZitiAuthStateFullyAuthenticated) {
+        model_list_clear(&ztx->prefetch_queue, free);
+        return;
+    }
+
+    unsigned int max = ztx->opts.api_page_concurrency > 0 ? ztx->opts.api_page_concurrency : 1;
+    while (ztx->prefetch_inflight < max && model_list_size(&ztx->prefetch_queue) > 0) {
+        char *service_id = model_list_pop(&ztx->prefetch_queue);
+        // may have been requested by a dial in the meantime
+        if (model_map_get(&ztx->sessions, service_id) == NULL &&
+            ziti_prefetch_dial_session(ztx, service_id)) {
+            ztx->prefetch_inflight++;
+        }
+        free(service_id);
+    }
+}
+
+static void ztx_prefetch_sessions(ziti_context ztx) {
+    if (!ztx->opts.prefetch_sessions || ztx->auth_state != ZitiAuthStateFullyAuthenticated) {
+        return;
+    }
+
+    ziti_ctrl_get_sessions(ztx_get_controller(ztx), prefetch_sessions_cb, ztx);
+}
+
 static void refresh_cb(uv_timer_t *t) {
     ziti_context ztx = t->data;
 
@@ -1426,6 +1950,28 @@ void ziti_services_refresh(ziti_context ztx, bool now) {
     }
 }
 
+// with max_edge_routers set, channels beyond the limit are created disconnected,
+// and connected on demand if dial session needs them
+void ztx_add_edge_router(ziti_context ztx, const char *name, const char *url) {
+    if (ztx->opts.max_edge_routers > 0) {
+        unsigned int active = 0;
+        const char *u;
+        ziti_channel_t *ch;
+        MODEL_MAP_FOREACH(u, ch, &ztx->channels) {
+            if (!ziti_channel_is_disconnected(ch)) {
+                active++;
+            }
+        }
+
+        if (active >= ztx->opts.max_edge_routers) {
+            ziti_channel_add(ztx, name, url);
+            return;
+        }
+    }
+
+    ziti_channel_connect(ztx, name, url);
+}
+
 static void edge_routers_cb(ziti_edge_router_array ers, const ziti_error *err, void *ctx) {
     ziti_context ztx = ctx;
     bool ers_changed = false;
@@ -1438,8 +1984,9 @@ static void edge_routers_cb(ziti_edge_router_array ers, const ziti_error *err, v
         return;
     }
 
+    // not modified since last request
     if (ers == NULL) {
-        ZTX_LOG(INFO, "no edge routers found");
+        ZTX_LOG(VERBOSE, "no edge router updates");
         return;
     }
 
@@ -1463,8 +2010,8 @@ static void edge_routers_cb(ziti_edge_router_array ers, const ziti_error *err, v
         if (tls) {
             // check if it is already in the list
             if (model_map_remove(&curr_routers, tls) == NULL) {
-                ZTX_LOG(TRACE, "connecting to %s(%s)", er->name, tls);
-                ziti_channel_connect(ztx, er->name, tls);
+                ZTX_LOG(TRACE, "adding %s(%s)", er->name, tls);
+                ztx_add_edge_router(ztx, er->name, tls);
                 ers_changed = true;
             }
         } else {
@@ -1500,6 +2047,7 @@ static void edge_routers_cb(ziti_edge_router_array ers, const ziti_error *err, v
         MODEL_MAP_FOREACH(serv, session, &ztx->sessions) {
             session->refresh = true;
         }
+        ztx_save_cache(ztx);
     }
 }
 
@@ -1508,6 +2056,8 @@ static void update_identity_data(ziti_identity_data *data, const ziti_error *err
 
     if (err) {
         ZTX_LOG(ERROR, "failed to get identity_data: %s[%s]", err->message, err->code);
+    } else if (data == NULL) {
+        ZTX_LOG(VERBOSE, "identity data not modified");
     } else {
         free_ziti_identity_data(ztx->identity_data);
         FREE(ztx->identity_data);
@@ -1572,7 +2122,7 @@ static void ca_bundle_cb(char *pkcs7, const ziti_error *err, void *ctx) {
                 ztx_config_update(ztx);
                 free(old_ca);
                 ztx->tlsCtx = new_tls;
-                tlsuv_http_set_ssl(ztx_get_controller(ztx)->client, ztx->tlsCtx);
+                ziti_ctrl_set_tls(ztx_get_controller(ztx), ztx->tlsCtx);
                 new_pem = NULL; // owned by ztx->config
             } else {
                 ztx->config.id.ca = old_ca;
@@ -1841,8 +2391,18 @@ int ziti_context_set_options(ziti_context ztx, const ziti_options *options) {
         copy_opt(disabled);
         copy_opt(config_types);
         copy_opt(refresh_interval);
+        copy_opt(incremental_service_refresh);
+        copy_opt(prefetch_sessions);
+        copy_opt(dial_racing);
+        copy_opt(max_edge_routers);
+        copy_opt(prefer_aes_gcm);
+        copy_opt(crypto_offload);
+        copy_opt(key_pool_size);
+        copy_opt(cache_path);
         copy_opt(metrics_type);
         copy_opt(api_page_size);
+        copy_opt(api_page_concurrency);
+        copy_opt(api_request_hedging);
         copy_opt(event_cb);
         copy_opt(events);
         copy_opt(app_ctx);
@@ -23,10 +23,14 @@
 
 
 #define DEFAULT_PAGE_SIZE 25
+#define DEFAULT_PAGE_CONCURRENCY 4
 #define ZITI_CTRL_KEEPALIVE 0
 #define ZITI_CTRL_TIMEOUT 15000
 // one minute in millis
 #define ONE_MINUTE (1 * 60 * 1000)
+#define CTRL_PROBE_INTERVAL (5 * ONE_MINUTE)
+#define CTRL_HEDGE_MIN_SAMPLES 8
+#define CTRL_HEDGE_MIN_DELAY 50
 
 const char *const PC_DOMAIN_TYPE = "DOMAIN";
 const char *const PC_OS_TYPE = "OS";
@@ -117,9 +121,45 @@ struct ctrl_resp {
 
     bool paging;
     const char *base_path;
+    char *filter; // url-encoded, owned
     unsigned int limit;
     unsigned int total;
     unsigned int recd;
+    size_t body_len; // received (decoded) body bytes, all pages
+
+    // parallel paging: remaining pages are fetched concurrently after the first
+    // one reveals the total, and merged in order when all of them are in
+    struct ctrl_resp *parent;
+    unsigned int page_idx;
+    unsigned int page_count;
+    unsigned int next_page;
+    unsigned int pending;
+    json_object **pages;
+    ziti_error page_err;
+
+    // single-flight: identical GET requests issued while this one is in flight
+    // get their results parsed from this response instead of sending their own
+    char *inflight_key;
+    model_list followers;
+
+    // hedging: if there is no response in time the same GET is sent to another controller,
+    // whichever request gets response first is used and the other one is cancelled
+    tlsuv_http_t *client;
+    tlsuv_http_req_t *req;
+    char *hedge_path;
+    uv_timer_t *hedge_timer;
+    struct ctrl_resp *hedge;
+    bool cancelled;
+    // only single-page GETs are representative of response latency
+    bool sample_latency;
+
+    // conditional GET: request carries validators of the previous response for the same path,
+    // 304(Not Modified) completes with no data and no error
+    bool conditional;
+    bool not_modified;
+    char *cond_path;
+    char *etag;
+    char *last_modified;
 
     body_parse_fn body_parse_func;
     ctrl_resp_cb_t resp_cb;
@@ -138,12 +178,24 @@ static struct ctrl_resp *prepare_resp(ziti_controller *ctrl, ctrl_resp_cb_t cb,
 
 static void ctrl_paging_req(struct ctrl_resp *resp);
 
+static void ctrl_paging_fanout(struct ctrl_resp *resp, const resp_pagination *pagination);
+
+static void ctrl_page_req(struct ctrl_resp *resp, unsigned int page_idx);
+
 static void ctrl_default_cb(void *s, const ziti_error *e, struct ctrl_resp *resp);
 
 static void ctrl_body_cb(tlsuv_http_req_t *req, char *b, ssize_t len);
 
 static const char* ctrl_next_ep(ziti_controller *ctrl, const char *current);
 
+static void ctrl_switch_ep(ziti_controller *ctrl, const char *url);
+
+static void ctrl_probe_endpoints(ziti_controller *ctrl);
+
+static void ctrl_stop_hedge(struct ctrl_resp *resp);
+
+static void on_http_close(tlsuv_http_t *clt);
+
 static tlsuv_http_req_t *
 start_request(tlsuv_http_t *http, const char *method, const char *path, tlsuv_http_resp_cb cb, struct ctrl_resp *resp) {
     ziti_controller *ctrl = resp->ctrl;
@@ -163,6 +215,162 @@ static const char *find_header(tlsuv_http_resp_t *r, const char *name) {
     return NULL;
 }
 
+struct ctrl_validator {
+    char *etag;
+    char *last_modified;
+};
+
+static void free_validator(struct ctrl_validator *v) {
+    if (v == NULL) return;
+    free(v->etag);
+    free(v->last_modified);
+    free(v);
+}
+
+void ziti_ctrl_clear_validators(ziti_controller *ctrl) {
+    model_map_clear(&ctrl->validators, (void (*)(void *)) free_validator);
+}
+
+// sends validators of the previous response for the path
+static void ctrl_conditional(struct ctrl_resp *resp, tlsuv_http_req_t *req, const char *path) {
+    resp->conditional = true;
+    resp->cond_path = strdup(path);
+
+    struct ctrl_validator *v = model_map_get(&resp->ctrl->validators, path);
+    if (v == NULL) {
+        return;
+    }
+    if (v->etag) {
+        tlsuv_http_req_header(req, "If-None-Match", v->etag);
+    }
+    if (v->last_modified) {
+        tlsuv_http_req_header(req, "If-Modified-Since", v->last_modified);
+    }
+}
+
+static void ctrl_save_validators(struct ctrl_resp *resp) {
+    if (!resp->conditional || resp->cond_path == NULL) {
+        return;
+    }
+
+    struct ctrl_validator *v = NULL;
+    if (resp->etag || resp->last_modified) {
+        v = calloc(1, sizeof(*v));
+        v->etag = resp->etag;
+        v->last_modified = resp->last_modified;
+        resp->etag = NULL;
+        resp->last_modified = NULL;
+        free_validator(model_map_set(&resp->ctrl->validators, resp->cond_path, v));
+    } else {
+        free_validator(model_map_remove(&resp->ctrl->validators, resp->cond_path));
+    }
+}
+
+// returns true if an identical request is already in flight and resp was attached to it,
+// otherwise resp becomes the one other requests can join
+static bool ctrl_join_inflight(struct ctrl_resp *resp, const char *path) {
+    ziti_controller *ctrl = resp->ctrl;
+    if (resp->body_parse_func == NULL || resp->inflight_key != NULL) {
+        return false;
+    }
+
+    string_buf_t *b = new_string_buf();
+    string_buf_fmt(b, "GET %s", path);
+    char *key = string_buf_to_string(b, NULL);
+    delete_string_buf(b);
+
+    struct ctrl_resp *leader = model_map_get(&ctrl->inflight, key);
+    if (leader == NULL) {
+        resp->inflight_key = key;
+        model_map_set(&ctrl->inflight, key, resp);
+        return false;
+    }
+
+    bool joined = leader->body_parse_func == resp->body_parse_func;
+    if (joined) {
+        CTRL_LOG(DEBUG, "joining in-flight request %s", key);
+        model_list_append(&leader->followers, resp);
+    }
+    free(key);
+    return joined;
+}
+
+// stops other requests from joining, moves joined requests into `followers`
+static void ctrl_detach_followers(struct ctrl_resp *resp, model_list *followers) {
+    if (resp->inflight_key == NULL) {
+        return;
+    }
+
+    model_map_remove(&resp->ctrl->inflight, resp->inflight_key);
+    FREE(resp->inflight_key);
+    while (model_list_size(&resp->followers) > 0) {
+        model_list_append(followers, model_list_pop(&resp->followers));
+    }
+}
+
+// completes joined requests with their own copy of the result parsed from `data`
+static void ctrl_complete_followers(model_list *followers, json_object *data, const ziti_error *err) {
+    struct ctrl_resp *f;
+    while ((f = model_list_pop(followers)) != NULL) {
+        void *obj = NULL;
+        if (err != NULL) {
+            f->ctrl_cb(NULL, err, f);
+        } else if (data == NULL || f->body_parse_func(&obj, data) >= 0) {
+            f->ctrl_cb(obj, NULL, f);
+        } else {
+            ziti_error e = {
+                    .err = ZITI_INVALID_STATE,
+                    .code = "INVALID_CONTROLLER_RESPONSE",
+                    .message = "unexpected response JSON",
+            };
+            f->ctrl_cb(NULL, &e, f);
+        }
+    }
+}
+
+// moves joined requests and in-flight registration to the other request of hedged pair
+static void ctrl_move_inflight(struct ctrl_resp *from, struct ctrl_resp *to) {
+    if (from->inflight_key == NULL) {
+        return;
+    }
+
+    to->inflight_key = from->inflight_key;
+    from->inflight_key = NULL;
+    model_map_set(&to->ctrl->inflight, to->inflight_key, to);
+    while (model_list_size(&from->followers) > 0) {
+        model_list_append(&to->followers, model_list_pop(&from->followers));
+    }
+}
+
+// returns true if response should be dropped because the other request of the hedged pair is used instead
+static bool ctrl_hedge_resolve(struct ctrl_resp *resp, int code) {
+    ziti_controller *ctrl = resp->ctrl;
+    ctrl_stop_hedge(resp);
+
+    if (resp->cancelled) {
+        return true;
+    }
+
+    struct ctrl_resp *other = resp->hedge;
+    if (other == NULL) {
+        return false;
+    }
+
+    resp->hedge = NULL;
+    other->hedge = NULL;
+    if (code < 0) {
+        // the other request may still succeed
+        CTRL_LOG(DEBUG, "hedged request failed: %d(%s), waiting for the other one", code, uv_strerror(code));
+        ctrl_move_inflight(resp, other);
+        return true;
+    }
+
+    ctrl_move_inflight(other, resp);
+    other->cancelled = true;
+    tlsuv_http_req_cancel(other->client, other->req);
+    return false;
+}
+
 static void ctrl_resp_cb(tlsuv_http_resp_t *r, void *data) {
     struct ctrl_resp *resp = data;
     ziti_controller *ctrl = resp->ctrl;
@@ -170,6 +378,26 @@ static void ctrl_resp_cb(tlsuv_http_resp_t *r, void *data) {
     assert(ctrl->active_reqs > 0);
         ctrl->active_reqs--;
 
+    if (ctrl_hedge_resolve(resp, r->code)) {
+        resp->resp_cb = NULL;
+        ctrl_default_cb(NULL, NULL, resp);
+        return;
+    }
+
+    bool primary = resp->client == ctrl->client;
+    ziti_controller_detail *ep = primary && ctrl->url ? model_map_get(&ctrl->endpoints, ctrl->url) : NULL;
+    if (ep && r->code >= 0) {
+        if (resp->sample_latency) {
+            uv_timeval64_t now;
+            uv_gettimeofday(&now);
+            uint64_t elapsed = (now.tv_sec * 1000000 + now.tv_usec) - (resp->start.tv_sec * 1000000 + resp->start.tv_usec);
+            ctrl->latency_samples[ctrl->latency_count++ % CTRL_LATENCY_SAMPLES] = elapsed / 1000;
+        }
+        ep->failures = 0;
+    } else if (ep && r->code != UV_ECANCELED) {
+        ep->failures++;
+    }
+
     resp->status = r->code;
     if (r->code < 0) {
         int e = ZITI_CONTROLLER_UNAVAILABLE;
@@ -183,15 +411,11 @@ static void ctrl_resp_cb(tlsuv_http_resp_t *r, void *data) {
         } else {
             CTRL_LOG(WARN, "request failed: %d(%s)", r->code, uv_strerror(r->code));
 
-            if (ctrl->active_reqs == 0) {
+            if (ctrl->active_reqs == 0 && primary) {
                 CTRL_LOG(INFO, "attempting to switch endpoint");
                 const char *next_ep = ctrl_next_ep(ctrl, ctrl->url);
                 if (next_ep != NULL) {
-                    FREE(ctrl->url);
-                    ctrl->url = strdup(next_ep);
-                    CTRL_LOG(INFO, "switching to endpoint[%s]", ctrl->url);
-                    tlsuv_http_set_url(ctrl->client, next_ep);
-                    internal_get_version(ctrl);
+                    ctrl_switch_ep(ctrl, next_ep);
                 }
             }
         }
@@ -202,9 +426,15 @@ static void ctrl_resp_cb(tlsuv_http_resp_t *r, void *data) {
                 .message = (char *) uv_strerror(r->code),
         };
 
+        model_list followers = {0};
+        ctrl_detach_followers(resp, &followers);
         (resp->ctrl_cb ? resp->ctrl_cb : ctrl_default_cb)(NULL, &err, resp);
+        ctrl_complete_followers(&followers, NULL, &err);
     } else {
-        CTRL_LOG(VERBOSE, "received headers %s[%s]", r->req->method, r->req->path);
+        // transport negotiates compression (Accept-Encoding) and inflates body before it gets here
+        const char *encoding = find_header(r, "content-encoding");
+        CTRL_LOG(VERBOSE, "received headers %s[%s] content-encoding[%s]", r->req->method, r->req->path,
+                 encoding ? encoding : "identity");
         r->body_cb = ctrl_body_cb;
 
         const char *hv;
@@ -220,6 +450,21 @@ static void ctrl_resp_cb(tlsuv_http_resp_t *r, void *data) {
             }
         }
 
+        if (resp->conditional) {
+            resp->not_modified = r->code == 304;
+            const char *etag = find_header(r, "etag");
+            const char *last_modified = find_header(r, "last-modified");
+            FREE(resp->etag);
+            FREE(resp->last_modified);
+            resp->etag = etag ? strdup(etag) : NULL;
+            resp->last_modified = last_modified ? strdup(last_modified) : NULL;
+        }
+
+        // hedged response came from different controller
+        if (!primary) {
+            return;
+        }
+
         const char *new_addr = find_header(r, "ziti-ctrl-address");
         if (new_addr) {
             FREE(resp->new_address);
@@ -270,7 +515,17 @@ static void ctrl_default_cb(void *s, const ziti_error *e, struct ctrl_resp *resp
         resp->resp_cb(s, e, resp->ctx);
     }
 
+    ctrl_stop_hedge(resp);
+    FREE(resp->cond_path);
+    FREE(resp->etag);
+    FREE(resp->last_modified);
+    if (resp->client != NULL && resp->client == ctrl->hedge_client) {
+        assert(ctrl->hedge_reqs > 0);
+        ctrl->hedge_reqs--;
+    }
+    FREE(resp->hedge_path);
     FREE(resp->new_address);
+    FREE(resp->filter);
     if (resp->resp_json != NULL) {
         json_object_put(resp->resp_json);
     }
@@ -314,6 +569,8 @@ static void internal_ctrl_list_cb(ziti_controller_detail_array arr, const ziti_e
                 change = true;
             } else {
                 change = change || (old_detail->is_online != d->is_online);
+                d->latency = old_detail->latency;
+                d->failures = old_detail->failures;
             }
         } else {
             free_ziti_controller_detail_ptr(d);
@@ -334,6 +591,10 @@ static void internal_ctrl_list_cb(ziti_controller_detail_array arr, const ziti_e
         model_map_clear(&new_eps, (void (*)(void *)) free_ziti_controller_detail_ptr);
     }
     free(arr);
+
+    if (ctrl->is_ha) {
+        ctrl_probe_endpoints(ctrl);
+    }
 }
 
 static void internal_version_cb(ziti_version *v, ziti_error *e, struct ctrl_resp *resp) {
@@ -380,11 +641,22 @@ static void internal_version_cb(ziti_version *v, ziti_error *e, struct ctrl_resp
     ctrl_default_cb(NULL, e, resp);
 }
 
+// legacy api session header, hedge client needs it as well
+static void ctrl_set_session_header(ziti_controller *ctrl, const char *token) {
+    FREE(ctrl->session_token);
+    ctrl->session_token = token ? strdup(token) : NULL;
+    tlsuv_http_header(ctrl->client, "zt-session", token);
+    if (ctrl->hedge_client) {
+        tlsuv_http_header(ctrl->hedge_client, "zt-session", token);
+    }
+}
+
 void ziti_ctrl_clear_api_session(ziti_controller *ctrl) {
     ctrl->has_token = false;
+    ziti_ctrl_clear_validators(ctrl);
     if (ctrl->client) {
         CTRL_LOG(DEBUG, "clearing api session token for ziti_controller");
-        tlsuv_http_header(ctrl->client, "zt-session", NULL);
+        ctrl_set_session_header(ctrl, NULL);
         ziti_ctrl_set_token(ctrl, NULL);
     }
 }
@@ -399,7 +671,8 @@ static void ctrl_login_cb(ziti_api_session *s, ziti_error *e, struct ctrl_resp *
     if (s) {
         CTRL_LOG(DEBUG, "authenticated successfully session[%s]", s->id);
         ctrl->has_token = true;
-        tlsuv_http_header(ctrl->client, "zt-session", s->token);
+        ziti_ctrl_clear_validators(ctrl);
+        ctrl_set_session_header(ctrl, s->token);
     }
     ctrl_default_cb(s, e, resp);
 }
@@ -409,7 +682,7 @@ static void ctrl_logout_cb(void *s, ziti_error *e, struct ctrl_resp *resp) {
     CTRL_LOG(DEBUG, "logged out");
 
     ctrl->has_token = false;
-    tlsuv_http_header(ctrl->client, "zt-session", NULL);
+    ctrl_set_session_header(ctrl, NULL);
     ctrl_default_cb(s, e, resp);
 }
 
@@ -428,6 +701,7 @@ static void ctrl_body_cb(tlsuv_http_req_t *req, char *b, ssize_t len) {
     ziti_controller *ctrl = resp->ctrl;
 
     if (len > 0) {
+        resp->body_len += len;
         if (resp->resp_content == ctrl_content_json) {
             if (resp->content == NULL) {
                 resp->content = json_tokener_parse_ex(resp->content_proc, b, (int) len);
@@ -442,8 +716,25 @@ static void ctrl_body_cb(tlsuv_http_req_t *req, char *b, ssize_t len) {
         } else {
             string_buf_appendn(resp->content_proc, b, len);
         }
+    } else if (len == UV_EOF && resp->not_modified) {
+        CTRL_LOG(DEBUG, "not modified %s[%s]", req->method, req->path);
+        if (resp->resp_content == ctrl_content_json) {
+            json_tokener_free(resp->content_proc);
+            json_object_put(resp->content);
+            resp->content = NULL;
+        } else {
+            string_buf_free(resp->content_proc);
+            FREE(resp->content_proc);
+        }
+        resp->content_proc = NULL;
+
+        model_list followers = {0};
+        ctrl_detach_followers(resp, &followers);
+        resp->ctrl_cb(NULL, NULL, resp);
+        ctrl_complete_followers(&followers, NULL, NULL);
     } else if (len == UV_EOF) {
         void *resp_obj = NULL;
+        json_object *shared = NULL;
         uv_timeval64_t now;
         uv_gettimeofday(&now);
 
@@ -491,19 +782,25 @@ static void ctrl_body_cb(tlsuv_http_req_t *req, char *b, ssize_t len) {
                              resp->recd, (int)meta.pagination.total, resp->base_path);
                 }
                 if (!last_page) {
+                    // validators are only kept for single page results
+                    resp->conditional = false;
                     json_tokener_free(resp->content_proc);
                     resp->content_proc = NULL;
-                    ctrl_paging_req(resp);
+                    if (ctrl->page_concurrency > 1 && meta.pagination.offset == 0 && resp->resp_json != NULL) {
+                        ctrl_paging_fanout(resp, &meta.pagination);
+                    } else {
+                        ctrl_paging_req(resp);
+                    }
                     return;
                 }
                 uint64_t elapsed = (now.tv_sec * 1000000 + now.tv_usec) - (resp->all_start.tv_sec * 1000000 + resp->all_start.tv_usec);
-                CTRL_LOG(DEBUG, "completed paging request GET[%s] in %" PRIu64 ".%03" PRIu64 " s",
-                         resp->base_path, elapsed / 1000000, (elapsed / 1000) % 1000);
+                CTRL_LOG(DEBUG, "completed paging request GET[%s] in %" PRIu64 ".%03" PRIu64 " s, %zu bytes",
+                         resp->base_path, elapsed / 1000000, (elapsed / 1000) % 1000, resp->body_len);
 
             } else {
                 uint64_t elapsed = (now.tv_sec * 1000000 + now.tv_usec) - (resp->start.tv_sec * 1000000 + resp->start.tv_usec);
-                CTRL_LOG(DEBUG, "completed %s[%s] in %" PRIu64 ".%03" PRIu64 " s",
-                         req->method, req->path, elapsed / 1000000, (elapsed / 1000) % 1000);
+                CTRL_LOG(DEBUG, "completed %s[%s] in %" PRIu64 ".%03" PRIu64 " s, %zu bytes",
+                         req->method, req->path, elapsed / 1000000, (elapsed / 1000) % 1000, resp->body_len);
                 resp->resp_json = data;
             }
             
@@ -513,7 +810,12 @@ static void ctrl_body_cb(tlsuv_http_req_t *req, char *b, ssize_t len) {
                     error.code = strdup("INVALID_CONTROLLER_RESPONSE");
                     error.message = strdup("unexpected response JSON");
                 }
-                json_object_put(resp->resp_json);
+                // joined requests parse their own copies
+                if (model_list_size(&resp->followers) > 0) {
+                    shared = resp->resp_json;
+                } else {
+                    json_object_put(resp->resp_json);
+                }
                 resp->resp_json = NULL;
                 json_tokener_free(resp->content_proc);
                 resp->content_proc = NULL;
@@ -527,11 +829,17 @@ static void ctrl_body_cb(tlsuv_http_req_t *req, char *b, ssize_t len) {
             CTRL_LOG(ERROR, "API request[%s] failed code[%s] message[%s]",
                      req->path, error.code, error.message);
         }
+        model_list followers = {0};
+        ctrl_detach_followers(resp, &followers);
         if (error.err != ZITI_OK) {
             resp->ctrl_cb(NULL, &error, resp);
+            ctrl_complete_followers(&followers, NULL, &error);
         } else {
+            ctrl_save_validators(resp);
             resp->ctrl_cb(resp_obj, NULL, resp);
+            ctrl_complete_followers(&followers, shared, NULL);
         }
+        json_object_put(shared);
         free_ziti_error(&error);
     } else {
         CTRL_LOG(WARN, "failed to read response body: %zd[%s]", len, uv_strerror(len));
@@ -554,11 +862,266 @@ static void ctrl_body_cb(tlsuv_http_req_t *req, char *b, ssize_t len) {
             err.err = ZITI_DISABLED;
             err.code = "CONTEXT_DISABLED";
         }
-        resp->resp_cb(NULL, &err, resp);
+        model_list followers = {0};
+        ctrl_detach_followers(resp, &followers);
+        resp->ctrl_cb(NULL, &err, resp);
+        ctrl_complete_followers(&followers, NULL, &err);
+    }
+}
+
+// fastest endpoint that responded to the last latency probe, other than `exclude`
+static ziti_controller_detail *ctrl_fastest_ep(ziti_controller *ctrl, const char *exclude, const char **url_out) {
+    ziti_controller_detail *best = NULL;
+    const char *url;
+    ziti_controller_detail *d;
+    MODEL_MAP_FOREACH(url, d, &ctrl->endpoints) {
+        if (d == NULL || d->latency <= 0 || d->failures > 0) continue;
+        if (exclude && strcasecmp(url, exclude) == 0) continue;
+
+        if (best == NULL || d->latency < best->latency) {
+            best = d;
+            *url_out = url;
+        }
+    }
+    return best;
+}
+
+static void ctrl_switch_ep(ziti_controller *ctrl, const char *url) {
+    char *new_url = strdup(url);
+    FREE(ctrl->url);
+    ctrl->url = new_url;
+    CTRL_LOG(INFO, "switching to endpoint[%s]", ctrl->url);
+    tlsuv_http_set_url(ctrl->client, ctrl->url);
+    // latency samples are for the previous endpoint
+    ctrl->latency_count = 0;
+    internal_get_version(ctrl);
+}
+
+// switch to the fastest endpoint if it is significantly faster than the current one
+void ziti_ctrl_select_ep(ziti_controller *ctrl) {
+    if (ctrl->active_reqs > 0 || ctrl->url == NULL) {
+        return;
+    }
+
+    const char *url = NULL;
+    ziti_controller_detail *best = ctrl_fastest_ep(ctrl, ctrl->url, &url);
+    if (best == NULL) {
+        return;
+    }
+
+    ziti_controller_detail *curr = model_map_get(&ctrl->endpoints, ctrl->url);
+    if (curr != NULL && curr->failures == 0 && curr->latency > 0 &&
+        best->latency * 10 > curr->latency * 7) {
+        return;
+    }
+
+    CTRL_LOG(INFO, "endpoint[%s] latency[%" PRId64 "ms] is better than current[%" PRId64 "ms]",
+             url, best->latency, curr ? curr->latency : -1);
+    ctrl_switch_ep(ctrl, url);
+}
+
+struct ctrl_probe_s {
+    ziti_controller *ctrl;
+    char *url;
+    uint64_t start;
+    tlsuv_http_t http;
+};
+
+static void probe_close_cb(tlsuv_http_t *http) {
+    struct ctrl_probe_s *probe = container_of(http, struct ctrl_probe_s, http);
+    free(probe->url);
+    free(probe);
+}
+
+static void probe_resp_cb(tlsuv_http_resp_t *r, void *data) {
+    struct ctrl_probe_s *probe = data;
+    ziti_controller *ctrl = probe->ctrl;
+
+    // controller client is closing, probe is already being closed
+    if (ctrl == NULL) {
+        return;
+    }
+
+    model_list_iter it = model_list_iterator(&ctrl->probes);
+    while (it != NULL) {
+        if (model_list_it_element(it) == probe) {
+            model_list_it_remove(it);
+            break;
+        }
+        it = model_list_it_next(it);
+    }
+
+    ziti_controller_detail *d = model_map_get(&ctrl->endpoints, probe->url);
+    if (d != NULL) {
+        if (r->code >= 0) {
+            int64_t rtt = (int64_t) (uv_now(ctrl->loop) - probe->start);
+            rtt = rtt > 0 ? rtt : 1;
+            d->latency = d->latency > 0 ? (7 * d->latency + rtt) / 8 : rtt;
+            d->failures = 0;
+            CTRL_LOG(DEBUG, "endpoint[%s] latency[%" PRId64 "ms] avg[%" PRId64 "ms]", probe->url, rtt, d->latency);
+        } else {
+            d->failures++;
+            CTRL_LOG(DEBUG, "endpoint[%s] probe failed: %d(%s)", probe->url, r->code, uv_strerror(r->code));
+        }
+    }
+
+    probe->ctrl = NULL;
+    tlsuv_http_close(&probe->http, probe_close_cb);
+
+    if (model_list_size(&ctrl->probes) == 0) {
+        ziti_ctrl_select_ep(ctrl);
     }
 }
 
-// pick next random endpoint
+// measures latency of all HA endpoints with a GET /version on a new connection,
+// so that all endpoints are measured the same way
+static void ctrl_probe_endpoints(ziti_controller *ctrl) {
+    if (model_list_size(&ctrl->probes) > 0 || model_map_size(&ctrl->endpoints) < 2) {
+        return;
+    }
+
+    uint64_t now = uv_now(ctrl->loop);
+    if (ctrl->last_probe != 0 && now - ctrl->last_probe < CTRL_PROBE_INTERVAL) {
+        ziti_ctrl_select_ep(ctrl);
+        return;
+    }
+    ctrl->last_probe = now;
+
+    const char *url;
+    ziti_controller_detail *d;
+    MODEL_MAP_FOREACH(url, d, &ctrl->endpoints) {
+        NEWP(probe, struct ctrl_probe_s);
+        if (tlsuv_http_init(ctrl->loop, &probe->http, url) != 0) {
+            CTRL_LOG(WARN, "failed to probe endpoint[%s]", url);
+            free(probe);
+            continue;
+        }
+        probe->ctrl = ctrl;
+        probe->url = strdup(url);
+        probe->start = now;
+        tlsuv_http_set_ssl(&probe->http, ctrl->tls);
+        tlsuv_http_connect_timeout(&probe->http, ZITI_CTRL_TIMEOUT);
+        tlsuv_http_header(&probe->http, "Accept", "application/json");
+        tlsuv_http_req(&probe->http, "GET", "/version", probe_resp_cb, probe);
+        model_list_append(&ctrl->probes, probe);
+    }
+}
+
+static const char *ctrl_api_path(ziti_controller *ctrl) {
+    api_path *path = NULL;
+    if (ctrl->version.api_versions) {
+        path = model_map_get(&ctrl->version.api_versions->edge, "v1");
+    }
+    return path ? path->path : "";
+}
+
+// client connected to the next fastest endpoint
+static tlsuv_http_t *ctrl_hedge_client(ziti_controller *ctrl) {
+    const char *url = NULL;
+    if (ctrl_fastest_ep(ctrl, ctrl->url, &url) == NULL) {
+        return NULL;
+    }
+
+    // keep current client until its requests are done
+    if (ctrl->hedge_client && ctrl->hedge_reqs == 0 && strcasecmp(ctrl->hedge_url, url) != 0) {
+        tlsuv_http_close(ctrl->hedge_client, on_http_close);
+        ctrl->hedge_client = NULL;
+        FREE(ctrl->hedge_url);
+    }
+
+    if (ctrl->hedge_client == NULL) {
+        tlsuv_http_t *clt = calloc(1, sizeof(tlsuv_http_t));
+        if (tlsuv_http_init(ctrl->loop, clt, url) != 0) {
+            free(clt);
+            return NULL;
+        }
+        clt->data = ctrl;
+        tlsuv_http_set_ssl(clt, ctrl->tls);
+        tlsuv_http_set_path_prefix(clt, ctrl_api_path(ctrl));
+        tlsuv_http_idle_keepalive(clt, ZITI_CTRL_KEEPALIVE);
+        tlsuv_http_connect_timeout(clt, ZITI_CTRL_TIMEOUT);
+        tlsuv_http_header(clt, "Accept", "application/json");
+        tlsuv_http_header(clt, "Authorization", ctrl->auth_header);
+        tlsuv_http_header(clt, "zt-session", ctrl->session_token);
+        ctrl->hedge_client = clt;
+        ctrl->hedge_url = strdup(url);
+    }
+    return ctrl->hedge_client;
+}
+
+static void ctrl_free_handle(uv_handle_t *h) {
+    free(h);
+}
+
+static void ctrl_stop_hedge(struct ctrl_resp *resp) {
+    if (resp->hedge_timer) {
+        uv_close((uv_handle_t *) resp->hedge_timer, ctrl_free_handle);
+        resp->hedge_timer = NULL;
+    }
+}
+
+static int cmp_latency(const void *a, const void *b) {
+    uint64_t l = *(const uint64_t *) a;
+    uint64_t r = *(const uint64_t *) b;
+    return l < r ? -1 : (l > r ? 1 : 0);
+}
+
+// p95 of recent response latency, 0 if not known yet
+uint64_t ziti_ctrl_hedge_delay(ziti_controller *ctrl) {
+    unsigned int count = MIN(ctrl->latency_count, CTRL_LATENCY_SAMPLES);
+    if (count < CTRL_HEDGE_MIN_SAMPLES) {
+        return 0;
+    }
+
+    uint64_t sorted[CTRL_LATENCY_SAMPLES];
+    memcpy(sorted, ctrl->latency_samples, count * sizeof(sorted[0]));
+    qsort(sorted, count, sizeof(sorted[0]), cmp_latency);
+    return MAX(sorted[count * 95 / 100], CTRL_HEDGE_MIN_DELAY);
+}
+
+static void hedge_timer_cb(uv_timer_t *t) {
+    struct ctrl_resp *resp = t->data;
+    ziti_controller *ctrl = resp->ctrl;
+    ctrl_stop_hedge(resp);
+
+    tlsuv_http_t *clt = ctrl_hedge_client(ctrl);
+    if (clt == NULL) {
+        return;
+    }
+
+    struct ctrl_resp *hedge = prepare_resp(ctrl, resp->resp_cb, resp->body_parse_func, resp->ctx);
+    hedge->ctrl_cb = resp->ctrl_cb;
+    hedge->client = clt;
+    hedge->hedge = resp;
+    resp->hedge = hedge;
+    ctrl->hedge_reqs++;
+
+    CTRL_LOG(DEBUG, "no response for GET[%s], sending it to endpoint[%s]", resp->hedge_path, ctrl->hedge_url);
+    hedge->req = start_request(clt, "GET", resp->hedge_path, ctrl_resp_cb, hedge);
+}
+
+// starts GET request, that could be hedged
+static tlsuv_http_req_t *ctrl_get(struct ctrl_resp *resp, const char *path) {
+    ziti_controller *ctrl = resp->ctrl;
+    resp->sample_latency = true;
+    resp->req = start_request(ctrl->client, "GET", path, ctrl_resp_cb, resp);
+
+    uint64_t delay = 0;
+    if (ctrl->hedging && ctrl->is_ha && (ctrl->auth_header != NULL || ctrl->session_token != NULL)) {
+        delay = ziti_ctrl_hedge_delay(ctrl);
+    }
+
+    if (delay > 0) {
+        resp->hedge_path = strdup(path);
+        resp->hedge_timer = calloc(1, sizeof(uv_timer_t));
+        uv_timer_init(ctrl->loop, resp->hedge_timer);
+        resp->hedge_timer->data = resp;
+        uv_timer_start(resp->hedge_timer, hedge_timer_cb, delay, 0);
+    }
+    return resp->req;
+}
+
+// pick next endpoint: fastest known, or random
 static const char* ctrl_next_ep(ziti_controller *ctrl, const char *current) {
     if(model_map_size(&ctrl->endpoints) == 0) {
         CTRL_LOG(WARN, "empty endpoints map");
@@ -585,7 +1148,9 @@ static const char* ctrl_next_ep(ziti_controller *ctrl, const char *current) {
         }
     }
     const char *next = NULL;
-    if (model_list_size(&online) > 0) {
+    if (ctrl_fastest_ep(ctrl, current, &next) != NULL) {
+        CTRL_LOG(DEBUG, "selected fastest endpoint[%s]", next);
+    } else if (model_list_size(&online) > 0) {
         int rand = (int) (uv_now(ctrl->loop) % model_list_size(&online));
         model_list_iter it = model_list_iterator(&online);
         for (int i = 0; i < rand; i++) {
@@ -616,7 +1181,9 @@ int ziti_ctrl_init(uv_loop_t *loop, ziti_controller *ctrl, model_list *urls, tls
         return ZITI_INVALID_CONFIG;
     }
     ctrl->page_size = DEFAULT_PAGE_SIZE;
+    ctrl->page_concurrency = DEFAULT_PAGE_CONCURRENCY;
     ctrl->loop = loop;
+    ctrl->tls = tls;
     memset(&ctrl->version, 0, sizeof(ctrl->version));
     ctrl->client = calloc(1, sizeof(tlsuv_http_t));
 
@@ -649,8 +1216,13 @@ int ziti_ctrl_init(uv_loop_t *loop, ziti_controller *ctrl, model_list *urls, tls
 }
 
 int ziti_ctrl_set_token(ziti_controller *ctrl, const char *token) {
+    FREE(ctrl->auth_header);
+    ziti_ctrl_clear_validators(ctrl);
     if (token == NULL) {
         tlsuv_http_header(ctrl->client, "Authorization", NULL);
+        if (ctrl->hedge_client) {
+            tlsuv_http_header(ctrl->hedge_client, "Authorization", NULL);
+        }
         ctrl->has_token = false;
         return 0;
     }
@@ -661,8 +1233,11 @@ int ziti_ctrl_set_token(ziti_controller *ctrl, const char *token) {
 
     ctrl->has_token = true;
     tlsuv_http_header(ctrl->client, "Authorization", header);
+    if (ctrl->hedge_client) {
+        tlsuv_http_header(ctrl->hedge_client, "Authorization", header);
+    }
 
-    free(header);
+    ctrl->auth_header = header;
     delete_string_buf(b);
 
     if (ctrl->is_ha) {
@@ -676,6 +1251,22 @@ void ziti_ctrl_set_page_size(ziti_controller *ctrl, unsigned int size) {
     ctrl->page_size = size;
 }
 
+void ziti_ctrl_set_page_concurrency(ziti_controller *ctrl, unsigned int concurrency) {
+    ctrl->page_concurrency = concurrency;
+}
+
+void ziti_ctrl_set_hedging(ziti_controller *ctrl, bool enabled) {
+    ctrl->hedging = enabled;
+}
+
+void ziti_ctrl_set_tls(ziti_controller *ctrl, tls_context *tls) {
+    ctrl->tls = tls;
+    tlsuv_http_set_ssl(ctrl->client, tls);
+    if (ctrl->hedge_client) {
+        tlsuv_http_set_ssl(ctrl->hedge_client, tls);
+    }
+}
+
 void ziti_ctrl_set_callbacks(ziti_controller *ctrl, void *ctx,
                              ziti_ctrl_redirect_cb redirect_cb,
                              ziti_ctrl_change_cb change_cb) {
@@ -695,8 +1286,26 @@ int ziti_ctrl_cancel(ziti_controller *ctrl) {
 int ziti_ctrl_close(ziti_controller *ctrl) {
     free_ziti_version(&ctrl->version);
     model_map_clear(&ctrl->endpoints, (void (*)(void *)) free_ziti_controller_detail_ptr);
+    model_map_clear(&ctrl->inflight, NULL);
+    ziti_ctrl_clear_validators(ctrl);
     FREE(ctrl->url);
     FREE(ctrl->instance_id);
+    FREE(ctrl->auth_header);
+    FREE(ctrl->session_token);
+
+    struct ctrl_probe_s *probe;
+    MODEL_LIST_FOREACH(probe, ctrl->probes) {
+        probe->ctrl = NULL;
+        tlsuv_http_close(&probe->http, probe_close_cb);
+    }
+    model_list_clear(&ctrl->probes, NULL);
+
+    if (ctrl->hedge_client) {
+        tlsuv_http_close(ctrl->hedge_client, on_http_close);
+        ctrl->hedge_client = NULL;
+    }
+    FREE(ctrl->hedge_url);
+
     if (ctrl->client) {
         tlsuv_http_close(ctrl->client, on_http_close);
     }
@@ -824,7 +1433,9 @@ void ziti_ctrl_current_identity(ziti_controller *ctrl, void(*cb)(ziti_identity_d
     if(!verify_api_session(ctrl, (void (*)(void *, const ziti_error *, void *)) cb, ctx)) return;
 
     struct ctrl_resp *resp = MAKE_RESP(ctrl, cb, ziti_identity_data_ptr_from_json, ctx);
-    start_request(ctrl->client, "GET", "/current-identity", ctrl_resp_cb, resp);
+    if (ctrl_join_inflight(resp, "/current-identity")) return;
+    tlsuv_http_req_t *req = ctrl_get(resp, "/current-identity");
+    ctrl_conditional(resp, req, "/current-identity");
 }
 
 void ziti_ctrl_current_api_session(ziti_controller *ctrl, void(*cb)(ziti_api_session *, const ziti_error *, void *), void *ctx) {
@@ -875,7 +1486,9 @@ void ziti_ctrl_get_services_update(ziti_controller *ctrl, void (*cb)(ziti_servic
     if(!verify_api_session(ctrl, (void (*)(void *, const ziti_error *, void *)) cb, ctx)) return;
 
     struct ctrl_resp *resp = MAKE_RESP(ctrl, cb, ziti_service_update_ptr_from_json, ctx);
-    start_request(ctrl->client, "GET", "/current-api-session/service-updates", ctrl_resp_cb, resp);
+    if (ctrl_join_inflight(resp, "/current-api-session/service-updates")) return;
+    tlsuv_http_req_t *req = ctrl_get(resp, "/current-api-session/service-updates");
+    ctrl_conditional(resp, req, "/current-api-session/service-updates");
 }
 
 void ziti_ctrl_get_services(ziti_controller *ctrl, void (*cb)(ziti_service_array, const ziti_error *, void *), void *ctx) {
@@ -888,12 +1501,38 @@ void ziti_ctrl_get_services(ziti_controller *ctrl, void (*cb)(ziti_service_array
     ctrl_paging_req(resp);
 }
 
+void ziti_ctrl_list_services(ziti_controller *ctrl, void (*cb)(ziti_service_array, const ziti_error *, void *), void *ctx) {
+    if(!verify_api_session(ctrl, (void (*)(void *, const ziti_error *, void *)) cb, ctx)) return;
+
+    // no configTypes -- controller leaves out service configs
+    struct ctrl_resp *resp = MAKE_RESP(ctrl, cb, ziti_service_array_from_json, ctx);
+    resp->paging = true;
+    resp->base_path = "/services";
+    ctrl_paging_req(resp);
+}
+
+void ziti_ctrl_get_services_filtered(ziti_controller *ctrl, const char *filter,
+                                     void (*cb)(ziti_service_array, const ziti_error *, void *), void *ctx) {
+    if(!verify_api_session(ctrl, (void (*)(void *, const ziti_error *, void *)) cb, ctx)) return;
+
+    string_buf_t *f = new_string_buf();
+    string_buf_append_urlsafe(f, filter);
+
+    struct ctrl_resp *resp = MAKE_RESP(ctrl, cb, ziti_service_array_from_json, ctx);
+    resp->paging = true;
+    resp->base_path = "/services?configTypes=all";
+    resp->filter = string_buf_to_string(f, NULL);
+    delete_string_buf(f);
+    ctrl_paging_req(resp);
+}
+
 void ziti_ctrl_current_edge_routers(ziti_controller *ctrl, void (*cb)(ziti_edge_router_array, const ziti_error *, void *),
                                     void *ctx) {
     if(!verify_api_session(ctrl, (void (*)(void *, const ziti_error *, void *)) cb, ctx)) return;
 
     struct ctrl_resp *resp = MAKE_RESP(ctrl, cb, ziti_edge_router_array_from_json, ctx);
     resp->paging = true;
+    resp->conditional = true;
     resp->base_path = "/current-identity/edge-routers";
     ctrl_paging_req(resp);
 
@@ -914,6 +1553,10 @@ ziti_ctrl_get_service(ziti_controller *ctrl, const char *service_name, void (*cb
     struct ctrl_resp *resp = MAKE_RESP(ctrl, cb, ziti_service_array_from_json, ctx);
     resp->ctrl_cb = (ctrl_cb_t) ctrl_service_cb;
 
+    char key[1100];
+    snprintf(key, sizeof(key), "/services?filter=%s", name_clause);
+    if (ctrl_join_inflight(resp, key)) return;
+
     tlsuv_http_req_t *req = start_request(ctrl->client, "GET", "/services", ctrl_resp_cb, resp);
     tlsuv_http_req_query(req, 1, &(tlsuv_http_pair){
         "filter", name_clause
@@ -945,7 +1588,8 @@ void ziti_ctrl_get_session(
     snprintf(req_path, sizeof(req_path), "/sessions/%s", session_id);
 
     struct ctrl_resp *resp = MAKE_RESP(ctrl, cb, ziti_session_ptr_from_json, ctx);
-    tlsuv_http_req_t *req = start_request(ctrl->client, "GET", req_path, ctrl_resp_cb, resp);
+    if (ctrl_join_inflight(resp, req_path)) return;
+    tlsuv_http_req_t *req = ctrl_get(resp, req_path);
     tlsuv_http_req_header(req, "Content-Type", "application/json");
 }
 
@@ -1061,20 +1705,169 @@ void ziti_pr_post_bulk(ziti_controller *ctrl, char *body, size_t body_len,
     tlsuv_http_req_data(req, body, body_len, free_body_cb);
 }
 
+static char *ctrl_page_path(struct ctrl_resp *resp, unsigned int offset) {
+    string_buf_t *b = new_string_buf();
+    char query = strchr(resp->base_path, '?') ? '&' : '?';
+    string_buf_fmt(b, "%s%climit=%d&offset=%d", resp->base_path, query, resp->limit, offset);
+    if (resp->filter) {
+        string_buf_append(b, "&filter=");
+        string_buf_append(b, resp->filter);
+    }
+    char *path = string_buf_to_string(b, NULL);
+    delete_string_buf(b);
+    return path;
+}
+
 static void ctrl_paging_req(struct ctrl_resp *resp) {
     ziti_controller *ctrl = resp->ctrl;
     if (resp->limit == 0) {
         resp->limit = ctrl->page_size;
     }
+    char *path = ctrl_page_path(resp, resp->recd);
     if (resp->recd == 0) {
+        if (ctrl_join_inflight(resp, path)) {
+            free(path);
+            return;
+        }
         uv_gettimeofday(&resp->all_start);
         CTRL_LOG(DEBUG, "starting paging request GET[%s]", resp->base_path);
     }
-    char query = strchr(resp->base_path, '?') ? '&' : '?';
-    char path[128];
-    snprintf(path, sizeof(path), "%s%climit=%d&offset=%d", resp->base_path, query, resp->limit, resp->recd);
     CTRL_LOG(VERBOSE, "requesting %s", path);
-    start_request(resp->ctrl->client, "GET", path, ctrl_resp_cb, resp);
+    tlsuv_http_req_t *req = start_request(resp->ctrl->client, "GET", path, ctrl_resp_cb, resp);
+    if (resp->conditional && resp->recd == 0) {
+        ctrl_conditional(resp, req, path);
+    }
+    free(path);
+}
+
+static void ctrl_paging_complete(struct ctrl_resp *resp) {
+    ziti_controller *ctrl = resp->ctrl;
+    void *resp_obj = NULL;
+    json_object *shared = NULL;
+    ziti_error error = resp->page_err;
+    memset(&resp->page_err, 0, sizeof(resp->page_err));
+
+    if (error.err == ZITI_OK) {
+        // pages[0] is the first page already held in resp_json
+        for (unsigned int i = 1; i < resp->page_count; i++) {
+            json_object *page = resp->pages[i];
+            if (page == NULL) continue;
+
+            for (int idx = 0; idx < json_object_array_length(page); idx++) {
+                json_object *o = json_object_array_get_idx(page, idx);
+                json_object_array_add(resp->resp_json, json_object_get(o));
+            }
+        }
+
+        uv_timeval64_t now;
+        uv_gettimeofday(&now);
+        uint64_t elapsed = (now.tv_sec * 1000000 + now.tv_usec) - (resp->all_start.tv_sec * 1000000 + resp->all_start.tv_usec);
+        CTRL_LOG(DEBUG, "completed paging request GET[%s] (%u pages) in %" PRIu64 ".%03" PRIu64 " s, %zu bytes",
+                 resp->base_path, resp->page_count, elapsed / 1000000, (elapsed / 1000) % 1000, resp->body_len);
+
+        if (resp->body_parse_func && resp->resp_json != NULL) {
+            if (resp->body_parse_func(&resp_obj, resp->resp_json) < 0) {
+                CTRL_LOG(ERROR, "error parsing response data for req[%s]", resp->base_path);
+                error.code = strdup("INVALID_CONTROLLER_RESPONSE");
+                error.message = strdup("unexpected response JSON");
+                error.err = code_to_error(error.code);
+            }
+            if (model_list_size(&resp->followers) > 0) {
+                shared = resp->resp_json;
+            } else {
+                json_object_put(resp->resp_json);
+            }
+            resp->resp_json = NULL;
+        }
+    } else {
+        CTRL_LOG(ERROR, "paging request GET[%s] failed code[%s] message[%s]",
+                 resp->base_path, error.code, error.message);
+    }
+
+    for (unsigned int i = 0; i < resp->page_count; i++) {
+        json_object_put(resp->pages[i]);
+    }
+    FREE(resp->pages);
+
+    model_list followers = {0};
+    ctrl_detach_followers(resp, &followers);
+    if (error.err != ZITI_OK) {
+        resp->ctrl_cb(NULL, &error, resp);
+        ctrl_complete_followers(&followers, NULL, &error);
+    } else {
+        resp->ctrl_cb(resp_obj, NULL, resp);
+        ctrl_complete_followers(&followers, shared, NULL);
+    }
+    json_object_put(shared);
+    free_ziti_error(&error);
+}
+
+static void ctrl_page_cb(void *UNUSED(data), const ziti_error *err, struct ctrl_resp *page) {
+    struct ctrl_resp *resp = page->parent;
+    ziti_controller *ctrl = resp->ctrl;
+
+    assert(resp->pending > 0);
+    resp->pending--;
+
+    if (err) {
+        // keep the first error, the rest of the pages are drained and dropped
+        if (resp->page_err.err == ZITI_OK) {
+            resp->page_err.err = err->err != ZITI_OK ? err->err : code_to_error(err->code);
+            resp->page_err.http_code = err->http_code;
+            resp->page_err.code = err->code ? strdup(err->code) : NULL;
+            resp->page_err.message = err->message ? strdup(err->message) : NULL;
+        }
+    } else if (json_object_get_type(page->resp_json) == json_type_array) {
+        resp->recd += json_object_array_length(page->resp_json);
+        resp->pages[page->page_idx] = page->resp_json;
+        page->resp_json = NULL;
+        CTRL_LOG(DEBUG, "received %d/%d for paging request GET[%s]",
+                 resp->recd, resp->total, resp->base_path);
+    }
+
+    resp->body_len += page->body_len;
+    ctrl_default_cb(NULL, NULL, page);
+
+    if (resp->page_err.err == ZITI_OK && resp->next_page < resp->page_count) {
+        ctrl_page_req(resp, resp->next_page++);
+    }
+
+    if (resp->pending == 0) {
+        ctrl_paging_complete(resp);
+    }
+}
+
+static void ctrl_page_req(struct ctrl_resp *resp, unsigned int page_idx) {
+    ziti_controller *ctrl = resp->ctrl;
+    // page results and errors are passed to the parent by ctrl_page_cb, never to a user callback
+    struct ctrl_resp *page = MAKE_RESP(ctrl, NULL, NULL, NULL);
+    page->ctrl_cb = ctrl_page_cb;
+    page->parent = resp;
+    page->page_idx = page_idx;
+    resp->pending++;
+
+    char *path = ctrl_page_path(resp, page_idx * resp->limit);
+    CTRL_LOG(VERBOSE, "requesting %s", path);
+    start_request(ctrl->client, "GET", path, ctrl_resp_cb, page);
+    free(path);
+}
+
+static void ctrl_paging_fanout(struct ctrl_resp *resp, const resp_pagination *pagination) {
+    ziti_controller *ctrl = resp->ctrl;
+    // controller may cap the page size below what was requested
+    if (pagination->limit > 0) {
+        resp->limit = (unsigned int) pagination->limit;
+    }
+    resp->total = (unsigned int) pagination->total;
+    resp->page_count = (resp->total + resp->limit - 1) / resp->limit;
+    resp->pages = calloc(resp->page_count, sizeof(json_object *));
+    resp->next_page = 1;
+
+    CTRL_LOG(DEBUG, "fetching %u remaining pages for GET[%s] (concurrency %u)",
+             resp->page_count - 1, resp->base_path, ctrl->page_concurrency);
+    while (resp->next_page < resp->page_count && resp->pending < ctrl->page_concurrency) {
+        ctrl_page_req(resp, resp->next_page++);
+    }
 }
 
 
@@ -1210,6 +2003,7 @@ static struct ctrl_resp *prepare_resp(ziti_controller *ctrl, ctrl_resp_cb_t cb,
     resp->resp_cb = cb;
     resp->ctx = ctx;
     resp->ctrl = ctrl;
+    resp->client = ctrl->client;
     resp->ctrl_cb = ctrl_default_cb;
     return resp;
 }
\ No newline at end of file
@@ -0,0 +1,245 @@
+// Copyright (c) 2024.  NetFoundry Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdlib.h>
+#include <string.h>
+#include <uv.h>
+
+#include "ztx_cache.h"
+#include "internal_model.h"
+#include "buffer.h"
+#include "utils.h"
+#include "endian_internal.h"
+
+#ifndef MAXPATHLEN
+#ifdef _MAX_PATH
+#define MAXPATHLEN _MAX_PATH
+#elif _WIN32
+#define MAXPATHLEN 260
+#else
+#define MAXPATHLEN 4096
+#endif
+#endif
+
+#define CACHE_MAGIC "ZTXC"
+#define CACHE_VERSION 2
+
+enum cache_section {
+    cache_services = 1,
+    cache_edge_routers,
+};
+
+static void put_u32(string_buf_t *b, uint32_t v) {
+    v = htole32(v);
+    string_buf_appendn(b, (const char *) &v, sizeof(v));
+}
+
+static void put_record(string_buf_t *b, char *json, size_t len) {
+    put_u32(b, (uint32_t) len);
+    string_buf_appendn(b, json, len);
+    free(json);
+}
+
+static int write_file(const char *path, const char *data, size_t len) {
+    char tmp[MAXPATHLEN];
+    if (snprintf(tmp, sizeof(tmp), "%s.tmp", path) >= sizeof(tmp)) {
+        return UV_ENAMETOOLONG;
+    }
+
+    // owner only: the cache lists the identity's services and edge router addresses
+    uv_fs_t req;
+    int rc = uv_fs_open(NULL, &req, tmp, UV_FS_O_WRONLY | UV_FS_O_CREAT | UV_FS_O_TRUNC, 0600, NULL);
+    uv_fs_req_cleanup(&req);
+    if (rc < 0) {
+        return rc;
+    }
+
+    uv_file f = rc;
+    size_t written = 0;
+    while (written < len) {
+        uv_buf_t buf = uv_buf_init((char *) data + written, len - written);
+        rc = uv_fs_write(NULL, &req, f, &buf, 1, -1, NULL);
+        uv_fs_req_cleanup(&req);
+        if (rc < 0) break;
+        written += rc;
+    }
+    uv_fs_close(NULL, &req, f, NULL);
+    uv_fs_req_cleanup(&req);
+
+    if (rc >= 0) {
+        rc = uv_fs_rename(NULL, &req, tmp, path, NULL);
+        uv_fs_req_cleanup(&req);
+    }
+
+    if (rc < 0) {
+        uv_fs_unlink(NULL, &req, tmp, NULL);
+        uv_fs_req_cleanup(&req);
+    }
+    return rc < 0 ? rc : 0;
+}
+
+char *ztx_cache_encode(const char *key, const ztx_cache *cache, size_t *len) {
+    string_buf_t *b = new_string_buf();
+    size_t rec_len;
+
+    string_buf_appendn(b, CACHE_MAGIC, strlen(CACHE_MAGIC));
+    put_u32(b, CACHE_VERSION);
+    put_u32(b, (uint32_t) strlen(key));
+    string_buf_append(b, key);
+
+    const char *k;
+    ziti_service *s;
+    put_u32(b, cache_services);
+    put_u32(b, (uint32_t) model_map_size(&cache->services));
+    MODEL_MAP_FOREACH(k, s, &cache->services) {
+        char *json = ziti_service_to_json(s, MODEL_JSON_COMPACT, &rec_len);
+        put_record(b, json, rec_len);
+    }
+
+    ziti_edge_router *er;
+    put_u32(b, cache_edge_routers);
+    put_u32(b, (uint32_t) model_list_size(&cache->edge_routers));
+    MODEL_LIST_FOREACH(er, cache->edge_routers) {
+        char *json = ziti_edge_router_to_json(er, MODEL_JSON_COMPACT, &rec_len);
+        put_record(b, json, rec_len);
+    }
+
+    char *data = string_buf_to_string(b, len);
+    delete_string_buf(b);
+    return data;
+}
+
+int ztx_cache_save(const char *path, const char *data, size_t len) {
+    int rc = write_file(path, data, len);
+    if (rc != 0) {
+        ZITI_LOG(WARN, "failed to write cache[%s]: %d/%s", path, rc, uv_strerror(rc));
+    } else {
+        ZITI_LOG(DEBUG, "saved cache[%s] %zd bytes", path, len);
+    }
+    return rc;
+}
+
+int ztx_cache_write(const char *path, const char *key, const ztx_cache *cache) {
+    size_t len;
+    char *data = ztx_cache_encode(key, cache, &len);
+    int rc = ztx_cache_save(path, data, len);
+    free(data);
+    return rc;
+}
+
+struct reader {
+    const char *p;
+    const char *end;
+};
+
+static bool get_u32(struct reader *r, uint32_t *v) {
+    if (r->end - r->p < (ptrdiff_t) sizeof(*v)) {
+        return false;
+    }
+    memcpy(v, r->p, sizeof(*v));
+    *v = le32toh(*v);
+    r->p += sizeof(*v);
+    return true;
+}
+
+static bool get_bytes(struct reader *r, uint32_t len, const char **bytes) {
+    if (r->end - r->p < (ptrdiff_t) len) {
+        return false;
+    }
+    *bytes = r->p;
+    r->p += len;
+    return true;
+}
+
+static int read_section(struct reader *r, ztx_cache *cache) {
+    uint32_t type, count, len;
+    const char *json;
+    if (!get_u32(r, &type) || !get_u32(r, &count)) {
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (!get_u32(r, &len) || !get_bytes(r, len, &json)) {
+            return -1;
+        }
+
+        switch (type) {
+            case cache_services: {
+                ziti_service *s = NULL;
+                if (parse_ziti_service_ptr(&s, json, len) < 0) return -1;
+                free_ziti_service_ptr(model_map_set(&cache->services, s->name, s));
+                break;
+            }
+            case cache_edge_routers: {
+                ziti_edge_router *er = NULL;
+                if (parse_ziti_edge_router_ptr(&er, json, len) < 0) return -1;
+                model_list_append(&cache->edge_routers, er);
+                break;
+            }
+            default:
+                // unknown section, skip
+                break;
+        }
+    }
+    return 0;
+}
+
+int ztx_cache_read(const char *path, const char *key, ztx_cache *cache) {
+    char *content = NULL;
+    size_t len = 0;
+    int rc = load_file(path, 0, &content, &len);
+    if (rc != 0) {
+        ZITI_LOG(DEBUG, "cache[%s] not loaded: %d/%s", path, rc, uv_strerror(rc));
+        return rc;
+    }
+
+    struct reader r = {
+            .p = content,
+            .end = content + len,
+    };
+
+    uint32_t version, key_len;
+    const char *magic, *cached_key;
+    if (!get_bytes(&r, strlen(CACHE_MAGIC), &magic) || memcmp(magic, CACHE_MAGIC, strlen(CACHE_MAGIC)) != 0 ||
+        !get_u32(&r, &version) || version != CACHE_VERSION) {
+        ZITI_LOG(WARN, "cache[%s] has invalid format or version", path);
+        rc = UV_EINVAL;
+    } else if (!get_u32(&r, &key_len) || !get_bytes(&r, key_len, &cached_key) ||
+               key_len != strlen(key) || memcmp(cached_key, key, key_len) != 0) {
+        ZITI_LOG(INFO, "cache[%s] belongs to a different identity, ignoring", path);
+        rc = UV_EINVAL;
+    } else {
+        while (rc == 0 && r.p < r.end) {
+            rc = read_section(&r, cache);
+        }
+        if (rc != 0) {
+            ZITI_LOG(WARN, "cache[%s] is corrupt", path);
+            rc = UV_EINVAL;
+        }
+    }
+
+    free(content);
+    if (rc != 0) {
+        ztx_cache_free(cache);
+    } else {
+        ZITI_LOG(DEBUG, "loaded cache[%s]: %zd services, %zd edge routers", path,
+                 model_map_size(&cache->services), model_list_size(&cache->edge_routers));
+    }
+    return rc;
+}
+
+void ztx_cache_free(ztx_cache *cache) {
+    model_map_clear(&cache->services, (void (*)(void *)) free_ziti_service_ptr);
+    model_list_clear(&cache->edge_routers, (void (*)(void *)) free_ziti_edge_router_ptr);
+}
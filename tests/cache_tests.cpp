@@ -0,0 +1,126 @@
+// Copyright (c) 2024.  NetFoundry Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "catch2/catch_test_macros.hpp"
+#include "ztx_cache.h"
+#include "internal_model.h"
+
+#include <cstdio>
+#include <cstring>
+
+static const char *CACHE_FILE = "ztx-cache-test.bin";
+
+static void fill_cache(ztx_cache *cache) {
+    const char *svc_json = R"({
+        "id": "svc-id",
+        "name": "svc",
+        "permissions": ["Dial"],
+        "encryptionRequired": true,
+        "updatedAt": "2024-01-01T00:00:00.000Z",
+        "config": {"intercept.v1": {"protocols": ["tcp"], "addresses": ["svc.ziti"], "portRanges": [{"low": 80, "high": 80}]}}
+    })";
+    ziti_service *s = nullptr;
+    REQUIRE(parse_ziti_service_ptr(&s, svc_json, strlen(svc_json)) > 0);
+    model_map_set(&cache->services, s->name, s);
+
+    auto er = alloc_ziti_edge_router();
+    er->name = strdup("er1");
+    er->protocols.tls = strdup("tls://er1:3022");
+    model_list_append(&cache->edge_routers, er);
+}
+
+TEST_CASE("ztx cache round trip", "[util]") {
+    ztx_cache cache = {};
+    fill_cache(&cache);
+    REQUIRE(ztx_cache_write(CACHE_FILE, "my-identity", &cache) == 0);
+
+    ztx_cache loaded = {};
+    REQUIRE(ztx_cache_read(CACHE_FILE, "my-identity", &loaded) == 0);
+
+    CHECK(model_map_size(&loaded.services) == 1);
+    auto s = (ziti_service *) model_map_get(&loaded.services, "svc");
+    REQUIRE(s != nullptr);
+    CHECK(cmp_ziti_service(s, (ziti_service *) model_map_get(&cache.services, "svc")) == 0);
+    CHECK(model_map_get(&s->config, "intercept.v1") != nullptr);
+
+    REQUIRE(model_list_size(&loaded.edge_routers) == 1);
+    auto er = (ziti_edge_router *) model_list_head(&loaded.edge_routers);
+    CHECK(strcmp(er->name, "er1") == 0);
+    CHECK(strcmp(er->protocols.tls, "tls://er1:3022") == 0);
+
+    ztx_cache_free(&loaded);
+    ztx_cache_free(&cache);
+    remove(CACHE_FILE);
+}
+
+TEST_CASE("ztx cache rejects other identity", "[util]") {
+    ztx_cache cache = {};
+    fill_cache(&cache);
+    REQUIRE(ztx_cache_write(CACHE_FILE, "my-identity", &cache) == 0);
+    ztx_cache_free(&cache);
+
+    ztx_cache loaded = {};
+    CHECK(ztx_cache_read(CACHE_FILE, "other-identity", &loaded) != 0);
+    CHECK(model_map_size(&loaded.services) == 0);
+    CHECK(model_list_size(&loaded.edge_routers) == 0);
+    remove(CACHE_FILE);
+}
+
+TEST_CASE("ztx cache rejects truncated file", "[util]") {
+    ztx_cache cache = {};
+    fill_cache(&cache);
+    REQUIRE(ztx_cache_write(CACHE_FILE, "my-identity", &cache) == 0);
+    ztx_cache_free(&cache);
+
+    FILE *f = fopen(CACHE_FILE, "rb");
+    REQUIRE(f != nullptr);
+    char buf[4096];
+    size_t len = fread(buf, 1, sizeof(buf), f);
+    fclose(f);
+
+    f = fopen(CACHE_FILE, "wb");
+    fwrite(buf, 1, len - 10, f);
+    fclose(f);
+
+    ztx_cache loaded = {};
+    CHECK(ztx_cache_read(CACHE_FILE, "my-identity", &loaded) != 0);
+    CHECK(model_map_size(&loaded.services) == 0);
+    CHECK(model_list_size(&loaded.edge_routers) == 0);
+    remove(CACHE_FILE);
+}
+
+TEST_CASE("ztx cache encode and save", "[util]") {
+    ztx_cache cache = {};
+    fill_cache(&cache);
+
+    size_t len;
+    char *data = ztx_cache_encode("my-identity", &cache, &len);
+    REQUIRE(data != nullptr);
+    CHECK(memcmp(data, "ZTXC", 4) == 0);
+    REQUIRE(ztx_cache_save(CACHE_FILE, data, len) == 0);
+    free(data);
+    ztx_cache_free(&cache);
+
+    ztx_cache loaded = {};
+    REQUIRE(ztx_cache_read(CACHE_FILE, "my-identity", &loaded) == 0);
+    CHECK(model_map_get(&loaded.services, "svc") != nullptr);
+    CHECK(model_list_size(&loaded.edge_routers) == 1);
+    ztx_cache_free(&loaded);
+    remove(CACHE_FILE);
+}
+
+TEST_CASE("ztx cache missing file", "[util]") {
+    ztx_cache loaded = {};
+    CHECK(ztx_cache_read("no-such-ztx-cache.bin", "my-identity", &loaded) != 0);
+}
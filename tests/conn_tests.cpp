@@ -0,0 +1,1473 @@
+// Copyright (c) 2024.  NetFoundry Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "catch2/catch_test_macros.hpp"
+#include "fake_ctrl.h"
+#include "zt_internal.h"
+#include "edge_protocol.h"
+
+// channel states are private to channel.c
+static const ch_state CH_INITIAL = 0;
+static const ch_state CH_CONNECTING = 1;
+static const ch_state CH_CONNECTED = 2;
+static const ch_state CH_DISCONNECTED = 3;
+
+// edge router side of end-to-end encryption
+struct crypto_peer {
+    crypto_peer() {
+        crypto_kx_keypair(pk, sk);
+    }
+
+    void init(const uint8_t *client_pk) {
+        REQUIRE(crypto_kx_server_session_keys(rx, tx, pk, sk, client_pk) == 0);
+    }
+
+    // SDK crypto header
+    void init_pull(const std::string &header) {
+        REQUIRE(header.size() == crypto_secretstream_xchacha20poly1305_HEADERBYTES);
+        REQUIRE(crypto_secretstream_xchacha20poly1305_init_pull(&in, (const uint8_t *) header.data(), rx) == 0);
+    }
+
+    // decrypt data sent by SDK
+    std::string open(const std::string &ct) {
+        REQUIRE(ct.size() >= crypto_secretstream_xchacha20poly1305_ABYTES);
+        std::string m(ct.size() - crypto_secretstream_xchacha20poly1305_ABYTES, 0);
+        unsigned long long len = 0;
+        uint8_t tag;
+        REQUIRE(crypto_secretstream_xchacha20poly1305_pull(&in, (uint8_t *) &m[0], &len, &tag,
+                                                           (const uint8_t *) ct.data(), ct.size(),
+                                                           nullptr, 0) == 0);
+        m.resize(len);
+        return m;
+    }
+
+    uint8_t pk[crypto_kx_PUBLICKEYBYTES];
+    uint8_t sk[crypto_kx_SECRETKEYBYTES];
+    uint8_t rx[crypto_kx_SESSIONKEYBYTES];
+    uint8_t tx[crypto_kx_SESSIONKEYBYTES];
+    crypto_secretstream_xchacha20poly1305_state in;
+};
+
+// context with a dial-able service and two edge router channels,
+// channels are kept corked so that everything sent to them can be inspected,
+// and edge router side is played by injecting messages into channel input
+class conn_fixture {
+public:
+    conn_fixture() {
+        loop = uv_loop_new();
+        ztx = (ziti_context) calloc(1, sizeof(*ztx));
+        ztx->loop = loop;
+        ztx->enabled = true;
+        ztx->auth_state = ZitiAuthStateFullyAuthenticated;
+        ztx->identity_data = alloc_ziti_identity_data();
+        ztx->identity_data->name = strdup("test-identity");
+
+        ziti_service *s = alloc_ziti_service();
+        s->name = strdup("test-service");
+        s->id = strdup("test-service-id");
+        s->perm_flags = ZITI_CAN_DIAL;
+        model_map_set(&ztx->services, s->name, s);
+
+        ziti_session *session = alloc_ziti_session();
+        session->id = strdup("test-session-id");
+        session->token = strdup("test-session-token");
+        session->service_id = strdup(s->id);
+
+        for (int i = 0; i < 2; i++) {
+            std::string name = "er" + std::to_string(i);
+            std::string url = "tls://" + name + ".test:3022";
+
+            ziti_edge_router *er = alloc_ziti_edge_router();
+            er->name = strdup(name.c_str());
+            er->protocols.tls = strdup(url.c_str());
+            model_list_append(&session->edge_routers, er);
+
+            ch[i] = ziti_channel_add(ztx, name.c_str(), url.c_str());
+            ch[i]->connection = (tlsuv_stream_t *) calloc(1, sizeof(tlsuv_stream_t));
+            tlsuv_stream_init(loop, ch[i]->connection, nullptr);
+            ch[i]->connection->data = ch[i];
+            ch[i]->state = CH_CONNECTED;
+            REQUIRE(ziti_channel_is_connected(ch[i]));
+            ziti_channel_cork(ch[i]);
+        }
+        model_map_set(&ztx->sessions, s->id, session);
+    }
+
+    ~conn_fixture() {
+        reap();
+        for (auto c: ch) {
+            if (c) {
+                ziti_channel_close(c, ZITI_DISABLED);
+            }
+        }
+        reap();
+        CHECK(model_map_size(&ztx->connections) == 0);
+
+        model_map_clear(&ztx->services, (_free_f) free_ziti_service_ptr);
+        model_map_clear(&ztx->sessions, (_free_f) free_ziti_session_ptr);
+        model_map_clear(&ztx->waiting_connections, nullptr);
+        free_ziti_identity_data_ptr(ztx->identity_data);
+        ztx_free_key_pool(ztx);
+        uv_run(loop, UV_RUN_DEFAULT);
+        free(ztx);
+        CHECK(uv_loop_close(loop) == 0);
+        free(loop);
+    }
+
+    // free closed connections, same as context does on every loop iteration
+    void reap() {
+        model_map_iter it = model_map_iterator(&ztx->connections);
+        while (it != nullptr) {
+            ziti_connection c = (ziti_connection) model_map_it_value(it);
+            int closed = c->close ? c->disposer(c) : 0;
+            it = closed ? model_map_it_remove(it) : model_map_it_next(it);
+        }
+    }
+
+    void run_for(uint64_t ms) {
+        uv_timer_t t;
+        bool done = false;
+        uv_timer_init(loop, &t);
+        t.data = &done;
+        uv_timer_start(&t, [](uv_timer_t *t) { *(bool *) t->data = true; }, ms, 0);
+        while (!done) {
+            uv_run(loop, UV_RUN_ONCE);
+        }
+        uv_close((uv_handle_t *) &t, nullptr);
+        uv_run(loop, UV_RUN_NOWAIT);
+    }
+
+    struct sent_msg {
+        uint32_t seq;
+        int32_t conn_id;
+        std::string body;
+        int32_t flags;
+    };
+
+    // messages sent to the channel and not yet written
+    static std::vector<sent_msg> sent(ziti_channel_t *c, uint32_t content) {
+        std::vector<sent_msg> result;
+        struct ziti_write_req_s *req;
+        MODEL_LIST_FOREACH(req, c->corked_reqs) {
+            message *m = req->message;
+            if (m->header.content == content) {
+                sent_msg sm = {m->header.seq, -1, std::string((char *) m->body, m->header.body_len), 0};
+                message_get_int32_header(m, ConnIdHeader, &sm.conn_id);
+                message_get_int32_header(m, FlagsHeader, &sm.flags);
+                result.push_back(sm);
+            }
+        }
+        return result;
+    }
+
+    // pretend that everything sent to the channel was written
+    static void complete_writes(ziti_channel_t *c, int status = 0) {
+        while (model_list_size(&c->corked_reqs) > 0) {
+            auto req = (struct ziti_write_req_s *) model_list_pop(&c->corked_reqs);
+            on_channel_send(&req->w, status);
+        }
+    }
+
+    // edge router sends message to the SDK
+    static void deliver(ziti_channel_t *c, uint32_t content, std::vector<hdr_t> hdrs, const std::string &body) {
+        message *m = message_new(nullptr, content, hdrs.data(), (int) hdrs.size(), body.size());
+        memcpy(m->body, body.data(), body.size());
+        buffer_append_copy(c->incoming, m->msgbufp, m->msgbuflen);
+        pool_return_obj(m);
+        ziti_channel_prepare(c);
+    }
+
+    static void reply(ziti_channel_t *c, const sent_msg &req, uint32_t content, const std::string &body = "") {
+        int32_t conn_id = req.conn_id;
+        int32_t reply_for = (int32_t) req.seq;
+        deliver(c, content, {
+                var_header(ConnIdHeader, conn_id),
+                var_header(ReplyForHeader, reply_for),
+        }, body);
+    }
+
+    // close and wait for StateClosed to be written
+    void close(ziti_connection conn) {
+        ziti_close(conn, nullptr);
+        uv_run(loop, UV_RUN_NOWAIT);
+        for (auto c: ch) {
+            if (c) {
+                complete_writes(c);
+            }
+        }
+        reap();
+    }
+
+    // edge router channel is lost
+    void drop(ziti_channel_t *c, int err) {
+        for (auto &slot: ch) {
+            if (slot == c) {
+                ziti_channel_close(c, err);
+                slot = nullptr;
+            }
+        }
+    }
+
+    // edge router accepts the dial, secretstream is used if service is encrypted
+    void accept(ziti_connection conn, crypto_peer &peer) {
+        ziti_channel_t *c = conn->channel;
+        auto connects = sent(c, ContentTypeConnect);
+        REQUIRE(connects.size() == 1);
+        if (conn->encrypted) {
+            peer.init(conn->key_pair.pk);
+        }
+
+        int32_t conn_id = conn->conn_id;
+        deliver(c, ContentTypeStateConnected, {
+                var_header(ConnIdHeader, conn_id),
+                var_header(ReplyForHeader, connects[0].seq),
+                header(PublicKeyHeader, sizeof(peer.pk), peer.pk),
+        }, "");
+        REQUIRE(std::string(ziti_conn_state(conn)) == "Connected");
+        // send our crypto header
+        uv_run(loop, UV_RUN_NOWAIT);
+        if (conn->encrypted) {
+            auto data = sent(c, ContentTypeData);
+            REQUIRE(data.size() == 1);
+            peer.init_pull(data[0].body);
+        }
+        complete_writes(c);
+    }
+
+    void accept(ziti_connection conn) {
+        crypto_peer peer;
+        accept(conn, peer);
+    }
+
+    static ssize_t discard_data(ziti_connection, const uint8_t *, ssize_t len) {
+        return len;
+    }
+
+    ziti_connection dial(ziti_conn_cb cb, void *ctx, ziti_data_cb data_cb = discard_data,
+                         ziti_dial_opts *opts = nullptr) {
+        ziti_connection conn;
+        ziti_conn_init(ztx, &conn, ctx);
+        REQUIRE(ziti_dial_with_options(conn, "test-service", opts, cb, data_cb) == ZITI_OK);
+        return conn;
+    }
+
+    ziti_service *service() {
+        return (ziti_service *) model_map_get(&ztx->services, "test-service");
+    }
+
+    uv_loop_t *loop;
+    ziti_context ztx;
+    ziti_channel_t *ch[2] = {};
+};
+
+struct dial_result {
+    int count = 0;
+    int status = 0;
+};
+
+static void dial_cb(ziti_connection conn, int status) {
+    auto r = (dial_result *) ziti_conn_data(conn);
+    r->count++;
+    r->status = status;
+}
+
+TEST_CASE_METHOD(conn_fixture, "dial racing", "[conn]") {
+    ztx->opts.dial_racing = true;
+    // race delay is at its minimum
+    ztx->dial_time = 1;
+
+    dial_result res;
+    ziti_connection conn = dial(dial_cb, &res);
+    REQUIRE(conn->channel != nullptr);
+    ziti_channel_t *first = conn->channel;
+    ziti_channel_t *second = first == ch[0] ? ch[1] : ch[0];
+
+    auto connects = sent(first, ContentTypeConnect);
+    REQUIRE(connects.size() == 1);
+    auto connect1 = connects[0];
+    CHECK(sent(second, ContentTypeConnect).empty());
+
+    SECTION("first reply before race delay") {
+        reply(first, connect1, ContentTypeStateConnected);
+        CHECK(res.count == 1);
+        CHECK(res.status == ZITI_OK);
+        run_for(100);
+        CHECK(sent(second, ContentTypeConnect).empty());
+        CHECK(conn->channel == first);
+    }
+
+    SECTION("raced connect") {
+        run_for(100);
+        connects = sent(second, ContentTypeConnect);
+        REQUIRE(connects.size() == 1);
+        auto connect2 = connects[0];
+        CHECK(res.count == 0);
+        CHECK(connect1.conn_id == connect2.conn_id);
+        CHECK(connect1.body == connect2.body);
+
+        SECTION("second wins, late first is closed") {
+            reply(second, connect2, ContentTypeStateConnected);
+            CHECK(res.count == 1);
+            CHECK(res.status == ZITI_OK);
+            CHECK(conn->channel == second);
+            CHECK(std::string(ziti_conn_state(conn)) == "Connected");
+
+            reply(first, connect1, ContentTypeStateConnected);
+            CHECK(res.count == 1);
+            auto closed = sent(first, ContentTypeStateClosed);
+            REQUIRE(closed.size() == 1);
+            CHECK(closed[0].conn_id == connect1.conn_id);
+        }
+
+        SECTION("first wins, late second is closed") {
+            reply(first, connect1, ContentTypeStateConnected);
+            CHECK(res.count == 1);
+            CHECK(res.status == ZITI_OK);
+            CHECK(conn->channel == first);
+
+            reply(second, connect2, ContentTypeStateConnected);
+            CHECK(res.count == 1);
+            CHECK(sent(second, ContentTypeStateClosed).size() == 1);
+        }
+
+        SECTION("first fails, second connects") {
+            reply(first, connect1, ContentTypeStateClosed, "no terminators");
+            CHECK(res.count == 0);
+            CHECK(std::string(ziti_conn_state(conn)) == "Connecting");
+            CHECK(conn->channel == second);
+
+            reply(second, connect2, ContentTypeStateConnected);
+            CHECK(res.count == 1);
+            CHECK(res.status == ZITI_OK);
+            CHECK(conn->channel == second);
+        }
+
+        SECTION("second fails, first connects") {
+            reply(second, connect2, ContentTypeStateClosed, "no terminators");
+            CHECK(res.count == 0);
+            CHECK(conn->channel == first);
+
+            reply(first, connect1, ContentTypeStateConnected);
+            CHECK(res.count == 1);
+            CHECK(res.status == ZITI_OK);
+            CHECK(conn->channel == first);
+        }
+
+        SECTION("both fail, only the last failure is reported") {
+            reply(first, connect1, ContentTypeStateClosed, "no terminators");
+            CHECK(res.count == 0);
+            reply(second, connect2, ContentTypeStateClosed, "no terminators");
+            CHECK(res.count == 1);
+            CHECK(res.status == ZITI_CONN_CLOSED);
+            CHECK(std::string(ziti_conn_state(conn)) == "Disconnected");
+        }
+
+        SECTION("closed while racing, both circuits are closed") {
+            ziti_close(conn, nullptr);
+            reply(first, connect1, ContentTypeStateConnected);
+            reply(second, connect2, ContentTypeStateConnected);
+            uv_run(loop, UV_RUN_NOWAIT);
+            CHECK(sent(first, ContentTypeStateClosed).size() == 1);
+            CHECK(sent(second, ContentTypeStateClosed).size() == 1);
+        }
+    }
+
+    close(conn);
+    CHECK(model_map_size(&ztx->connections) == 0);
+}
+
+struct read_result {
+    dial_result dial;
+    std::string data;
+    ssize_t err = 0;
+};
+
+static ssize_t read_cb(ziti_connection conn, const uint8_t *data, ssize_t len) {
+    auto r = (read_result *) ziti_conn_data(conn);
+    if (len > 0) {
+        r->data.append((const char *) data, len);
+    } else if (len < 0 && r->err == 0) {
+        // first error is the cause, ZITI_EOF/ZITI_CONN_CLOSED may follow
+        r->err = len;
+    }
+    return len;
+}
+
+TEST_CASE_METHOD(conn_fixture, "inbound cipher is detected by crypto header size", "[conn]") {
+    service()->encryption = true;
+    ztx->opts.prefer_aes_gcm = true;
+    bool gcm = gcm_stream_available();
+
+    read_result res;
+    ziti_connection conn = dial(dial_cb, &res, read_cb);
+    ziti_channel_t *c = conn->channel;
+    REQUIRE(c != nullptr);
+    auto connects = sent(c, ContentTypeConnect);
+    REQUIRE(connects.size() == 1);
+    int32_t conn_id = connects[0].conn_id;
+
+    crypto_peer peer;
+    peer.init(conn->key_pair.pk);
+
+    int32_t offer = CryptoMethodAES256GCM;
+    std::vector<hdr_t> hdrs = {
+            var_header(ConnIdHeader, conn_id),
+            var_header(ReplyForHeader, connects[0].seq),
+            header(PublicKeyHeader, sizeof(peer.pk), peer.pk),
+    };
+
+    SECTION("peer uses AES-256-GCM") {
+        if (!gcm) {
+            WARN("AES-256-GCM is not available on this CPU");
+            close(conn);
+            return;
+        }
+        hdrs.push_back(var_header(CryptoMethodHeader, offer));
+        deliver(c, ContentTypeStateConnected, hdrs, "");
+        REQUIRE(res.dial.count == 1);
+        REQUIRE(res.dial.status == ZITI_OK);
+        uv_run(loop, UV_RUN_NOWAIT);
+
+        // our outbound stream follows peer's offer
+        auto data = sent(c, ContentTypeData);
+        REQUIRE(data.size() == 1);
+        CHECK(data[0].body.size() == GCM_STREAM_HEADERBYTES);
+
+        gcm_stream out = {};
+        uint8_t h[GCM_STREAM_HEADERBYTES];
+        REQUIRE(gcm_stream_init_push(&out, h, peer.tx) == 0);
+        deliver(c, ContentTypeData, {var_header(ConnIdHeader, conn_id)}, std::string((char *) h, sizeof(h)));
+        uv_run(loop, UV_RUN_NOWAIT);
+        CHECK(conn->crypt_method_i == CryptoMethodAES256GCM);
+
+        std::string msg = "hello from the other side";
+        std::string ct(msg.size() + GCM_STREAM_ABYTES, 0);
+        REQUIRE(gcm_stream_push(&out, (uint8_t *) &ct[0], (const uint8_t *) msg.data(), msg.size()) == 0);
+        deliver(c, ContentTypeData, {var_header(ConnIdHeader, conn_id)}, ct);
+        uv_run(loop, UV_RUN_NOWAIT);
+        CHECK(res.data == msg);
+        CHECK(res.err == 0);
+    }
+
+    SECTION("peer uses secretstream") {
+        deliver(c, ContentTypeStateConnected, hdrs, "");
+        REQUIRE(res.dial.count == 1);
+        REQUIRE(res.dial.status == ZITI_OK);
+        uv_run(loop, UV_RUN_NOWAIT);
+
+        // peer did not offer AES-256-GCM
+        auto data = sent(c, ContentTypeData);
+        REQUIRE(data.size() == 1);
+        CHECK(data[0].body.size() == crypto_secretstream_xchacha20poly1305_HEADERBYTES);
+
+        crypto_secretstream_xchacha20poly1305_state out;
+        uint8_t h[crypto_secretstream_xchacha20poly1305_HEADERBYTES];
+        crypto_secretstream_xchacha20poly1305_init_push(&out, h, peer.tx);
+        deliver(c, ContentTypeData, {var_header(ConnIdHeader, conn_id)}, std::string((char *) h, sizeof(h)));
+        uv_run(loop, UV_RUN_NOWAIT);
+        CHECK(conn->crypt_method_i == CryptoMethodLibsodium);
+
+        std::string msg = "hello from the other side";
+        std::string ct(msg.size() + crypto_secretstream_xchacha20poly1305_ABYTES, 0);
+        crypto_secretstream_xchacha20poly1305_push(&out, (uint8_t *) &ct[0], nullptr,
+                                                   (const uint8_t *) msg.data(), msg.size(), nullptr, 0, 0);
+        deliver(c, ContentTypeData, {var_header(ConnIdHeader, conn_id)}, ct);
+        uv_run(loop, UV_RUN_NOWAIT);
+        CHECK(res.data == msg);
+        CHECK(res.err == 0);
+    }
+
+    SECTION("unknown crypto header is rejected") {
+        deliver(c, ContentTypeStateConnected, hdrs, "");
+        REQUIRE(res.dial.status == ZITI_OK);
+
+        deliver(c, ContentTypeData, {var_header(ConnIdHeader, conn_id)}, std::string(20, 'x'));
+        uv_run(loop, UV_RUN_NOWAIT);
+        CHECK(res.err == ZITI_CRYPTO_FAIL);
+        CHECK(std::string(ziti_conn_state(conn)) == "Disconnected");
+    }
+
+    close(conn);
+}
+
+struct write_result {
+    int count = 0;
+    ssize_t status = 0;
+};
+
+static void write_cb(ziti_connection, ssize_t status, void *ctx) {
+    auto r = (write_result *) ctx;
+    r->count++;
+    r->status = status;
+}
+
+TEST_CASE_METHOD(conn_fixture, "channel lost during offloaded encryption", "[conn]") {
+    service()->encryption = true;
+    ztx->opts.crypto_offload = true;
+
+    read_result res;
+    ziti_connection conn = dial(dial_cb, &res, read_cb);
+    ziti_channel_t *c = conn->channel;
+    REQUIRE(c != nullptr);
+    crypto_peer peer;
+    accept(conn, peer);
+
+    std::string payload(64 * 1024, 'x');
+    write_result wr;
+    REQUIRE(ziti_write(conn, (uint8_t *) payload.data(), payload.size(), write_cb, &wr) == ZITI_OK);
+
+    // runs after connection flusher has handed the payload to the threadpool,
+    // and before the loop polls for its completion
+    struct drop_s {
+        conn_fixture *f;
+        ziti_connection conn;
+        bool offloaded;
+    } drop = {this, conn, false};
+    uv_prepare_t p;
+    uv_prepare_init(loop, &p);
+    p.data = &drop;
+    uv_prepare_start(&p, [](uv_prepare_t *p) {
+        auto d = (drop_s *) p->data;
+        uv_prepare_stop(p);
+        d->offloaded = d->conn->crypt_o_work != nullptr;
+        d->f->drop(d->conn->channel, ZITI_GATEWAY_UNAVAILABLE);
+    });
+
+    run_for(100);
+    uv_close((uv_handle_t *) &p, nullptr);
+    CHECK(drop.offloaded);
+    CHECK(conn->channel == nullptr);
+    CHECK(wr.count == 1);
+    CHECK(wr.status == ZITI_CONN_CLOSED);
+    CHECK(res.err == ZITI_GATEWAY_UNAVAILABLE);
+
+    close(conn);
+}
+
+TEST_CASE_METHOD(conn_fixture, "channel lost with corked writes", "[conn]") {
+    read_result res;
+    ziti_connection conn = dial(dial_cb, &res, read_cb);
+    ziti_channel_t *c = conn->channel;
+    accept(conn);
+
+    std::string payload = "never sent";
+    write_result wr;
+
+    SECTION("channel closed") {
+        REQUIRE(ziti_write(conn, (uint8_t *) payload.data(), payload.size(), write_cb, &wr) == ZITI_OK);
+        uv_run(loop, UV_RUN_NOWAIT);
+        REQUIRE(sent(c, ContentTypeData).size() == 1);
+
+        drop(c, ZITI_GATEWAY_UNAVAILABLE);
+        CHECK(wr.count == 1);
+        CHECK(wr.status < 0);
+        // channel error is reported, not the failed write
+        CHECK(res.err == ZITI_GATEWAY_UNAVAILABLE);
+    }
+
+    SECTION("uncorked without connection") {
+        auto tls = c->connection;
+        c->connection = nullptr;
+        REQUIRE(ziti_write(conn, (uint8_t *) payload.data(), payload.size(), write_cb, &wr) == ZITI_OK);
+        uv_run(loop, UV_RUN_NOWAIT);
+        REQUIRE(sent(c, ContentTypeData).size() == 1);
+
+        ziti_channel_uncork(c);
+        CHECK(model_list_size(&c->corked_reqs) == 0);
+        CHECK(wr.count == 1);
+        CHECK(wr.status < 0);
+
+        // failed write takes the channel down
+        CHECK_FALSE(ziti_channel_is_connected(c));
+        tlsuv_stream_close(tls, [](uv_handle_t *h) {
+            tlsuv_stream_free((tlsuv_stream_t *) h);
+            free(h);
+        });
+    }
+
+    close(conn);
+}
+
+TEST_CASE_METHOD(conn_fixture, "scatter-gather write", "[conn]") {
+    std::vector<std::string> parts = {"GET / HTTP/1.1\r\n", "", "Host: example.com\r\n", "\r\n"};
+    std::string whole;
+    std::vector<uv_buf_t> bufs;
+    for (auto &p: parts) {
+        whole += p;
+        bufs.push_back(uv_buf_init((char *) p.data(), (unsigned int) p.size()));
+    }
+
+    read_result res;
+    crypto_peer peer;
+    write_result wr;
+
+    SECTION("single message") {
+        ziti_connection conn = dial(dial_cb, &res);
+        ziti_channel_t *c = conn->channel;
+        accept(conn);
+
+        REQUIRE(ziti_writev(conn, bufs.data(), (unsigned int) bufs.size(), write_cb, &wr) == ZITI_OK);
+        uv_run(loop, UV_RUN_NOWAIT);
+        auto data = sent(c, ContentTypeData);
+        REQUIRE(data.size() == 1);
+        CHECK(data[0].body == whole);
+        CHECK(wr.count == 0);
+
+        complete_writes(c);
+        CHECK(wr.count == 1);
+        CHECK(wr.status == (ssize_t) whole.size());
+        close(conn);
+    }
+
+    SECTION("encrypted") {
+        service()->encryption = true;
+        ziti_connection conn = dial(dial_cb, &res);
+        ziti_channel_t *c = conn->channel;
+        accept(conn, peer);
+
+        REQUIRE(ziti_writev(conn, bufs.data(), (unsigned int) bufs.size(), write_cb, &wr) == ZITI_OK);
+        uv_run(loop, UV_RUN_NOWAIT);
+        auto data = sent(c, ContentTypeData);
+        REQUIRE(data.size() == 1);
+        CHECK(peer.open(data[0].body) == whole);
+
+        complete_writes(c);
+        CHECK(wr.count == 1);
+        CHECK(wr.status == (ssize_t) whole.size());
+        close(conn);
+    }
+
+    SECTION("chained with other writes") {
+        service()->encryption = true;
+        ziti_dial_opts opts = {};
+        opts.stream = true;
+        ziti_connection conn = dial(dial_cb, &res, read_cb, &opts);
+        ziti_channel_t *c = conn->channel;
+        accept(conn, peer);
+
+        std::string before = "before;", after = ";after";
+        write_result wr1, wr2;
+        REQUIRE(ziti_write(conn, (uint8_t *) before.data(), before.size(), write_cb, &wr1) == ZITI_OK);
+        REQUIRE(ziti_writev(conn, bufs.data(), (unsigned int) bufs.size(), write_cb, &wr) == ZITI_OK);
+        REQUIRE(ziti_write(conn, (uint8_t *) after.data(), after.size(), write_cb, &wr2) == ZITI_OK);
+        uv_run(loop, UV_RUN_NOWAIT);
+
+        auto data = sent(c, ContentTypeData);
+        REQUIRE(data.size() == 1);
+        CHECK(peer.open(data[0].body) == before + whole + after);
+
+        complete_writes(c);
+        CHECK(wr1.count == 1);
+        CHECK(wr1.status == (ssize_t) before.size());
+        CHECK(wr.count == 1);
+        CHECK(wr.status == (ssize_t) whole.size());
+        CHECK(wr2.count == 1);
+        CHECK(wr2.status == (ssize_t) after.size());
+        close(conn);
+    }
+}
+
+TEST_CASE_METHOD(conn_fixture, "write coalescing", "[conn]") {
+    read_result res;
+    ziti_dial_opts opts = {};
+    opts.stream = true;
+    write_result wr1, wr2;
+    std::string a = "0123456789", b = "abcdefghij";
+
+    SECTION("corked writes are sent on uncork") {
+        ziti_connection conn = dial(dial_cb, &res, read_cb, &opts);
+        ziti_channel_t *c = conn->channel;
+        accept(conn);
+
+        REQUIRE(ziti_conn_cork(conn) == ZITI_OK);
+        REQUIRE(ziti_write(conn, (uint8_t *) a.data(), a.size(), write_cb, &wr1) == ZITI_OK);
+        REQUIRE(ziti_write(conn, (uint8_t *) b.data(), b.size(), write_cb, &wr2) == ZITI_OK);
+        run_for(20);
+        CHECK(sent(c, ContentTypeData).empty());
+
+        REQUIRE(ziti_conn_uncork(conn) == ZITI_OK);
+        uv_run(loop, UV_RUN_NOWAIT);
+        auto data = sent(c, ContentTypeData);
+        REQUIRE(data.size() == 1);
+        CHECK(data[0].body == a + b);
+
+        complete_writes(c);
+        CHECK(wr1.status == (ssize_t) a.size());
+        CHECK(wr2.status == (ssize_t) b.size());
+        close(conn);
+    }
+
+    SECTION("full frame is not held") {
+        opts.max_frame_size = a.size() + b.size() - 1;
+        ziti_connection conn = dial(dial_cb, &res, read_cb, &opts);
+        ziti_channel_t *c = conn->channel;
+        accept(conn);
+
+        REQUIRE(ziti_conn_cork(conn) == ZITI_OK);
+        REQUIRE(ziti_write(conn, (uint8_t *) a.data(), a.size(), write_cb, &wr1) == ZITI_OK);
+        uv_run(loop, UV_RUN_NOWAIT);
+        CHECK(sent(c, ContentTypeData).empty());
+
+        // does not fit in one frame with the first write
+        REQUIRE(ziti_write(conn, (uint8_t *) b.data(), b.size(), write_cb, &wr2) == ZITI_OK);
+        uv_run(loop, UV_RUN_NOWAIT);
+        auto data = sent(c, ContentTypeData);
+        REQUIRE(data.size() == 1);
+        CHECK(data[0].body == a);
+
+        REQUIRE(ziti_conn_uncork(conn) == ZITI_OK);
+        uv_run(loop, UV_RUN_NOWAIT);
+        data = sent(c, ContentTypeData);
+        REQUIRE(data.size() == 2);
+        CHECK(data[1].body == b);
+        close(conn);
+    }
+
+    SECTION("writes are held for coalesce delay") {
+        opts.coalesce_delay_ms = 50;
+        ziti_connection conn = dial(dial_cb, &res, read_cb, &opts);
+        ziti_channel_t *c = conn->channel;
+        accept(conn);
+
+        REQUIRE(ziti_write(conn, (uint8_t *) a.data(), a.size(), write_cb, &wr1) == ZITI_OK);
+        run_for(10);
+        CHECK(sent(c, ContentTypeData).empty());
+        REQUIRE(ziti_write(conn, (uint8_t *) b.data(), b.size(), write_cb, &wr2) == ZITI_OK);
+        run_for(10);
+        CHECK(sent(c, ContentTypeData).empty());
+
+        // delay is counted from the oldest write
+        run_for(50);
+        auto data = sent(c, ContentTypeData);
+        REQUIRE(data.size() == 1);
+        CHECK(data[0].body == a + b);
+        close(conn);
+    }
+
+    SECTION("FIN pushes out held data") {
+        ziti_connection conn = dial(dial_cb, &res, read_cb, &opts);
+        ziti_channel_t *c = conn->channel;
+        accept(conn);
+
+        REQUIRE(ziti_conn_cork(conn) == ZITI_OK);
+        REQUIRE(ziti_write(conn, (uint8_t *) a.data(), a.size(), write_cb, &wr1) == ZITI_OK);
+        REQUIRE(ziti_close_write(conn) == ZITI_OK);
+        uv_run(loop, UV_RUN_NOWAIT);
+        auto data = sent(c, ContentTypeData);
+        REQUIRE(data.size() == 2);
+        CHECK(data[0].body == a);
+        CHECK(data[1].body.empty());
+        CHECK((data[1].flags & EDGE_FIN) != 0);
+        close(conn);
+    }
+}
+
+TEST_CASE_METHOD(conn_fixture, "write request pool", "[conn]") {
+    read_result res;
+    ziti_connection conn = dial(dial_cb, &res, read_cb);
+    ziti_channel_t *c = conn->channel;
+    accept(conn);
+    size_t pooled = conn->wreq_pool_count;
+
+    std::string payload = "payload";
+    std::vector<write_result> wr(40);
+
+    SECTION("completed requests are reused") {
+        REQUIRE(ziti_write(conn, (uint8_t *) payload.data(), payload.size(), write_cb, &wr[0]) == ZITI_OK);
+        uv_run(loop, UV_RUN_NOWAIT);
+        auto req = TAILQ_FIRST(&conn->pending_wreqs);
+        REQUIRE(req != nullptr);
+        complete_writes(c);
+        CHECK(wr[0].count == 1);
+        CHECK(conn->wreq_pool_count == pooled + 1);
+        CHECK(TAILQ_FIRST(&conn->wreq_pool) == req);
+
+        REQUIRE(ziti_write(conn, (uint8_t *) payload.data(), 3, write_cb, &wr[1]) == ZITI_OK);
+        CHECK(conn->wreq_pool_count == pooled);
+        CHECK(TAILQ_FIRST(&conn->wreqs) == req);
+        uv_run(loop, UV_RUN_NOWAIT);
+        complete_writes(c);
+        // reused request does not carry previous state
+        CHECK(wr[0].count == 1);
+        CHECK(wr[1].count == 1);
+        CHECK(wr[1].status == 3);
+    }
+
+    SECTION("pool is bounded") {
+        for (auto &r: wr) {
+            REQUIRE(ziti_write(conn, (uint8_t *) payload.data(), payload.size(), write_cb, &r) == ZITI_OK);
+        }
+        uv_run(loop, UV_RUN_NOWAIT);
+        CHECK(sent(c, ContentTypeData).size() == wr.size());
+        complete_writes(c);
+        for (auto &r: wr) {
+            CHECK(r.count == 1);
+            CHECK(r.status == (ssize_t) payload.size());
+        }
+        // WRITE_REQ_POOL_MAX
+        CHECK(conn->wreq_pool_count == 32);
+    }
+
+    SECTION("vectored requests are not pooled") {
+        uv_buf_t bufs[] = {
+                uv_buf_init((char *) payload.data(), 3),
+                uv_buf_init((char *) payload.data() + 3, (unsigned int) payload.size() - 3),
+        };
+        REQUIRE(ziti_writev(conn, bufs, 2, write_cb, &wr[0]) == ZITI_OK);
+        uv_run(loop, UV_RUN_NOWAIT);
+        complete_writes(c);
+        CHECK(wr[0].count == 1);
+        CHECK(wr[0].status == (ssize_t) payload.size());
+        CHECK(conn->wreq_pool_count == pooled);
+    }
+
+    SECTION("chained requests are returned to the pool") {
+        ziti_conn_cork(conn);
+        conn->flags |= EDGE_STREAM;
+        for (int i = 0; i < 3; i++) {
+            REQUIRE(ziti_write(conn, (uint8_t *) payload.data(), payload.size(), write_cb, &wr[i]) == ZITI_OK);
+        }
+        ziti_conn_uncork(conn);
+        uv_run(loop, UV_RUN_NOWAIT);
+        CHECK(sent(c, ContentTypeData).size() == 1);
+        complete_writes(c);
+        for (int i = 0; i < 3; i++) {
+            CHECK(wr[i].count == 1);
+        }
+        CHECK(conn->wreq_pool_count == pooled + 3);
+    }
+
+    close(conn);
+}
+
+TEST_CASE_METHOD(conn_fixture, "zero-copy write", "[conn]") {
+    read_result res;
+    crypto_peer peer;
+    write_result wr1, wr2;
+    std::string a = "first message", b = "second";
+
+    SECTION("not before connected") {
+        ziti_connection conn = dial(dial_cb, &res, read_cb);
+        CHECK(ziti_write_alloc(conn, 100) == nullptr);
+        accept(conn);
+        close(conn);
+    }
+
+    SECTION("plain") {
+        ziti_connection conn = dial(dial_cb, &res, read_cb);
+        ziti_channel_t *c = conn->channel;
+        accept(conn);
+
+        uint8_t *buf = ziti_write_alloc(conn, 100);
+        REQUIRE(buf != nullptr);
+        memcpy(buf, a.data(), a.size());
+        REQUIRE(ziti_write_submit(conn, buf, a.size(), write_cb, &wr1) == ZITI_OK);
+        CHECK(model_map_size(&conn->write_bufs) == 0);
+        uv_run(loop, UV_RUN_NOWAIT);
+
+        auto data = sent(c, ContentTypeData);
+        REQUIRE(data.size() == 1);
+        // unused space is trimmed
+        CHECK(data[0].body == a);
+        complete_writes(c);
+        CHECK(wr1.count == 1);
+        CHECK(wr1.status == (ssize_t) a.size());
+        close(conn);
+    }
+
+    SECTION("encrypted in submit order") {
+        service()->encryption = true;
+        ziti_connection conn = dial(dial_cb, &res, read_cb);
+        ziti_channel_t *c = conn->channel;
+        accept(conn, peer);
+
+        uint8_t *buf1 = ziti_write_alloc(conn, a.size());
+        uint8_t *buf2 = ziti_write_alloc(conn, b.size());
+        REQUIRE(buf1 != nullptr);
+        REQUIRE(buf2 != nullptr);
+        memcpy(buf1, a.data(), a.size());
+        memcpy(buf2, b.data(), b.size());
+        REQUIRE(ziti_write_submit(conn, buf2, b.size(), write_cb, &wr2) == ZITI_OK);
+        REQUIRE(ziti_write_submit(conn, buf1, a.size(), write_cb, &wr1) == ZITI_OK);
+        uv_run(loop, UV_RUN_NOWAIT);
+
+        auto data = sent(c, ContentTypeData);
+        REQUIRE(data.size() == 2);
+        CHECK(peer.open(data[0].body) == b);
+        CHECK(peer.open(data[1].body) == a);
+        complete_writes(c);
+        CHECK(wr1.status == (ssize_t) a.size());
+        CHECK(wr2.status == (ssize_t) b.size());
+        close(conn);
+    }
+
+    SECTION("discard and invalid submit") {
+        ziti_connection conn = dial(dial_cb, &res, read_cb);
+        ziti_channel_t *c = conn->channel;
+        accept(conn);
+
+        uint8_t *buf = ziti_write_alloc(conn, 10);
+        REQUIRE(buf != nullptr);
+        // larger than allocated, buffer stays with the application
+        CHECK(ziti_write_submit(conn, buf, 11, write_cb, &wr1) == ZITI_INVALID_STATE);
+        CHECK(model_map_size(&conn->write_bufs) == 1);
+
+        ziti_write_discard(conn, buf);
+        CHECK(model_map_size(&conn->write_bufs) == 0);
+        CHECK(ziti_write_submit(conn, buf, 10, write_cb, &wr1) == ZITI_INVALID_STATE);
+
+        uv_run(loop, UV_RUN_NOWAIT);
+        CHECK(sent(c, ContentTypeData).empty());
+        CHECK(wr1.count == 0);
+        close(conn);
+    }
+
+    SECTION("outstanding buffers are released on close") {
+        ziti_connection conn = dial(dial_cb, &res, read_cb);
+        accept(conn);
+        REQUIRE(ziti_write_alloc(conn, 1024) != nullptr);
+        REQUIRE(ziti_write_alloc(conn, 10) != nullptr);
+        close(conn);
+    }
+}
+
+struct reader {
+    dial_result dial;
+    std::string data;
+    std::vector<ssize_t> errors;
+    char buf[1024];
+};
+
+TEST_CASE_METHOD(conn_fixture, "paused reading", "[conn]") {
+    reader rd;
+    crypto_peer peer;
+    crypto_secretstream_xchacha20poly1305_state out;
+    bool encrypted = false;
+
+    SECTION("plain") {}
+    SECTION("encrypted") {
+        encrypted = true;
+        service()->encryption = true;
+    }
+    ziti_connection conn = dial(dial_cb, &rd);
+    ziti_channel_t *c = conn->channel;
+    accept(conn, peer);
+
+    int32_t conn_id = conn->conn_id;
+    if (encrypted) {
+        uint8_t h[crypto_secretstream_xchacha20poly1305_HEADERBYTES];
+        crypto_secretstream_xchacha20poly1305_init_push(&out, h, peer.tx);
+        deliver(c, ContentTypeData, {var_header(ConnIdHeader, conn_id)}, std::string((char *) h, sizeof(h)));
+    }
+    auto send_data = [&](const std::string &d, int32_t flags = 0) {
+        std::string body = d;
+        if (encrypted) {
+            body.resize(d.size() + crypto_secretstream_xchacha20poly1305_ABYTES);
+            crypto_secretstream_xchacha20poly1305_push(&out, (uint8_t *) &body[0], nullptr,
+                                                       (const uint8_t *) d.data(), d.size(), nullptr, 0, 0);
+        }
+        deliver(c, ContentTypeData, {var_header(ConnIdHeader, conn_id), var_header(FlagsHeader, flags)}, body);
+    };
+
+    REQUIRE(ziti_conn_read_start(
+            conn,
+            [](ziti_connection conn, size_t, uv_buf_t *b) {
+                auto r = (reader *) ziti_conn_data(conn);
+                *b = uv_buf_init(r->buf, sizeof(r->buf));
+            },
+            [](ziti_connection conn, ssize_t len, const uv_buf_t *b) {
+                auto r = (reader *) ziti_conn_data(conn);
+                if (len > 0) {
+                    r->data.append(b->base, len);
+                } else if (len < 0) {
+                    r->errors.push_back(len);
+                }
+            }) == ZITI_OK);
+
+    send_data("hello ");
+    uv_run(loop, UV_RUN_NOWAIT);
+    CHECK(rd.data == "hello ");
+    REQUIRE(ziti_conn_read_stop(conn) == ZITI_OK);
+
+    SECTION("data is held") {
+        send_data("world");
+        run_for(10);
+        CHECK(rd.data == "hello ");
+
+        REQUIRE(ziti_conn_read_start(conn, conn->alloc_cb, conn->read_cb) == ZITI_OK);
+        uv_run(loop, UV_RUN_NOWAIT);
+        CHECK(rd.data == "hello world");
+        CHECK(rd.errors.empty());
+    }
+
+    SECTION("EOF is held") {
+        send_data("world", EDGE_FIN);
+        run_for(10);
+        CHECK(rd.data == "hello ");
+        CHECK(rd.errors.empty());
+
+        REQUIRE(ziti_conn_read_start(conn, conn->alloc_cb, conn->read_cb) == ZITI_OK);
+        uv_run(loop, UV_RUN_NOWAIT);
+        CHECK(rd.data == "hello world");
+        REQUIRE(rd.errors.size() == 1);
+        CHECK(rd.errors[0] == ZITI_EOF);
+    }
+
+    SECTION("channel loss is held") {
+        send_data("world");
+        uv_run(loop, UV_RUN_NOWAIT);
+        drop(c, ZITI_GATEWAY_UNAVAILABLE);
+        run_for(10);
+        CHECK(rd.data == "hello ");
+        CHECK(rd.errors.empty());
+
+        REQUIRE(ziti_conn_read_start(conn, conn->alloc_cb, conn->read_cb) == ZITI_OK);
+        uv_run(loop, UV_RUN_NOWAIT);
+        CHECK(rd.data == "hello world");
+        REQUIRE_FALSE(rd.errors.empty());
+        CHECK(rd.errors[0] == ZITI_GATEWAY_UNAVAILABLE);
+    }
+
+    SECTION("no buffer for held data") {
+        auto alloc_cb = conn->alloc_cb;
+        auto read_cb = conn->read_cb;
+        send_data("world");
+        run_for(10);
+
+        REQUIRE(ziti_conn_read_start(conn, [](ziti_connection, size_t, uv_buf_t *b) {
+            *b = uv_buf_init(nullptr, 0);
+        }, read_cb) == ZITI_OK);
+        run_for(10);
+        // reported once, and reading is stopped
+        REQUIRE(rd.errors.size() == 1);
+        CHECK(rd.errors[0] == UV_ENOBUFS);
+        CHECK(rd.data == "hello ");
+
+        REQUIRE(ziti_conn_read_start(conn, alloc_cb, read_cb) == ZITI_OK);
+        uv_run(loop, UV_RUN_NOWAIT);
+        CHECK(rd.data == "hello world");
+        CHECK(rd.errors.size() == 1);
+    }
+
+    SECTION("no buffer for incoming data") {
+        auto alloc_cb = conn->alloc_cb;
+        auto read_cb = conn->read_cb;
+        REQUIRE(ziti_conn_read_start(conn, [](ziti_connection, size_t, uv_buf_t *b) {
+            *b = uv_buf_init(nullptr, 0);
+        }, read_cb) == ZITI_OK);
+
+        send_data("world");
+        send_data("!");
+        run_for(10);
+        REQUIRE(rd.errors.size() == 1);
+        CHECK(rd.errors[0] == UV_ENOBUFS);
+        CHECK(rd.data == "hello ");
+
+        REQUIRE(ziti_conn_read_start(conn, alloc_cb, read_cb) == ZITI_OK);
+        uv_run(loop, UV_RUN_NOWAIT);
+        CHECK(rd.data == "hello world!");
+        CHECK(rd.errors.size() == 1);
+    }
+
+    if (encrypted) {
+        SECTION("decryption failure is held") {
+            send_data("world");
+            deliver(c, ContentTypeData, {var_header(ConnIdHeader, conn_id)}, std::string(64, 'x'));
+            run_for(10);
+            CHECK(rd.data == "hello ");
+            CHECK(rd.errors.empty());
+
+            REQUIRE(ziti_conn_read_start(conn, conn->alloc_cb, conn->read_cb) == ZITI_OK);
+            uv_run(loop, UV_RUN_NOWAIT);
+            CHECK(rd.data == "hello world");
+            REQUIRE_FALSE(rd.errors.empty());
+            CHECK(rd.errors[0] == ZITI_CRYPTO_FAIL);
+        }
+    }
+
+    close(conn);
+}
+
+static uint32_t rtt_samples(ziti_channel_t *c) {
+    uint32_t n = 0;
+    for (auto count: c->rtt_hist) {
+        n += count;
+    }
+    return n;
+}
+
+TEST_CASE_METHOD(conn_fixture, "round trip samples", "[conn]") {
+    ziti_channel_t *c = ch[0];
+    auto ignore_reply = [](void *, message *, int) {};
+    auto body = (const uint8_t *) "";
+
+    // replies depending on hosting side or controller are not sampled
+    for (uint32_t content: {ContentTypeConnect, ContentTypeBind, ContentTypeUnbind, ContentTypeUpdateToken}) {
+        ziti_channel_send_for_reply(c, content, nullptr, 0, body, 0, ignore_reply, nullptr);
+        auto reqs = sent(c, content);
+        REQUIRE(reqs.size() == 1);
+        reply(c, reqs[0], ContentTypeResultType);
+        complete_writes(c);
+    }
+    CHECK(rtt_samples(c) == 0);
+    CHECK(c->rtt == UINT64_MAX);
+
+    ziti_channel_send_for_reply(c, ContentTypeLatencyType, nullptr, 0, body, 0, ignore_reply, nullptr);
+    auto probes = sent(c, ContentTypeLatencyType);
+    REQUIRE(probes.size() == 1);
+    reply(c, probes[0], ContentTypeLatencyType);
+    complete_writes(c);
+    CHECK(rtt_samples(c) == 1);
+    CHECK(c->rtt != UINT64_MAX);
+}
+
+TEST_CASE_METHOD(conn_fixture, "edge router limit", "[conn]") {
+    ztx->opts.max_edge_routers = 2;
+
+    // both fixture channels are active, new router is only added
+    ztx_add_edge_router(ztx, "er2", "tls://er2.test:3022");
+    auto er2 = (ziti_channel_t *) model_map_get(&ztx->channels, "tls://er2.test:3022");
+    REQUIRE(er2 != nullptr);
+    CHECK(er2->state == CH_INITIAL);
+    CHECK(ziti_channel_is_disconnected(er2));
+
+    // known router is not duplicated
+    ztx_add_edge_router(ztx, "er0", "tls://er0.test:3022");
+    CHECK(model_map_get(&ztx->channels, "tls://er0.test:3022") == ch[0]);
+    CHECK(ch[0]->state == CH_CONNECTED);
+    CHECK(model_map_size(&ztx->channels) == 3);
+
+    ziti_channel_close(er2, ZITI_DISABLED);
+}
+
+TEST_CASE_METHOD(conn_fixture, "slowest channel swap", "[conn]") {
+    ztx->opts.max_edge_routers = 2;
+    ch[0]->rtt = 100;
+    ch[1]->rtt = 50;
+    auto er2 = ziti_channel_add(ztx, "er2", "tls://er2.test:3022");
+
+    SECTION("untried router") {
+        CHECK(ziti_channel_swap_candidate(ch[0]) == er2);
+        // only the slowest one is swapped
+        CHECK(ziti_channel_swap_candidate(ch[1]) == nullptr);
+
+        ziti_channel_add_receiver(ch[0], 1, nullptr, nullptr);
+        CHECK(ziti_channel_swap_candidate(ch[0]) == nullptr);
+        ziti_channel_rem_receiver(ch[0], 1);
+
+        ztx->opts.max_edge_routers = 0;
+        CHECK(ziti_channel_swap_candidate(ch[0]) == nullptr);
+    }
+
+    SECTION("tried router") {
+        er2->state = CH_DISCONNECTED;
+        er2->last_rtt = 80;
+        CHECK(ziti_channel_swap_candidate(ch[0]) == nullptr);
+
+        // at least 30% faster
+        er2->last_rtt = 70;
+        CHECK(ziti_channel_swap_candidate(ch[0]) == er2);
+
+        // untried router goes first
+        auto er3 = ziti_channel_add(ztx, "er3", "tls://er3.test:3022");
+        CHECK(ziti_channel_swap_candidate(ch[0]) == er3);
+        ziti_channel_close(er3, ZITI_DISABLED);
+    }
+
+    ziti_channel_close(er2, ZITI_DISABLED);
+}
+
+TEST_CASE_METHOD(conn_fixture, "idle disconnect", "[conn]") {
+    ztx->opts.max_edge_routers = 1;
+    ch[0]->rtt = 10;
+    ch[1]->rtt = 100;
+    uint64_t idle_since = uv_now(loop) - 5 * 60 * 1000;
+    ch[0]->last_used = idle_since;
+    ch[1]->last_used = idle_since;
+
+    SECTION("slower channel") {
+        CHECK(ziti_channel_is_idle(ch[1]));
+        // fastest channel is kept
+        CHECK_FALSE(ziti_channel_is_idle(ch[0]));
+
+        ziti_channel_add_receiver(ch[1], 1, nullptr, nullptr);
+        CHECK_FALSE(ziti_channel_is_idle(ch[1]));
+        ziti_channel_rem_receiver(ch[1], 1);
+
+        ch[1]->last_used = uv_now(loop);
+        CHECK_FALSE(ziti_channel_is_idle(ch[1]));
+
+        ch[1]->last_used = idle_since;
+        ztx->opts.max_edge_routers = 0;
+        CHECK_FALSE(ziti_channel_is_idle(ch[1]));
+    }
+
+    SECTION("newly connected channel") {
+        auto c = ziti_channel_add(ztx, "er2", "tls://er2.test:3022");
+        c->connection = (tlsuv_stream_t *) calloc(1, sizeof(tlsuv_stream_t));
+        tlsuv_stream_init(loop, c->connection, nullptr);
+        c->connection->data = c;
+        c->state = CH_CONNECTING;
+        c->rtt = 1000;
+
+        uint8_t ok = 1;
+        std::string version = "v1.0.0";
+        deliver(c, ContentTypeResultType, {
+                header(ResultSuccessHeader, 1, &ok),
+                header(HelloVersionHeader, version.size(), (uint8_t *) version.data()),
+        }, "");
+        REQUIRE(c->state == CH_CONNECTED);
+        // connect counts as use
+        CHECK_FALSE(ziti_channel_is_idle(c));
+        ziti_channel_close(c, ZITI_DISABLED);
+    }
+}
+
+TEST_CASE("terminator cost change detection", "[conn]") {
+    CHECK_FALSE(terminator_cost_changed(0, 0));
+    CHECK(terminator_cost_changed(0, 1));
+
+    // small costs move with every connection
+    CHECK(terminator_cost_changed(5, 6));
+    CHECK(terminator_cost_changed(5, 4));
+
+    // large costs need to move by 10%
+    CHECK_FALSE(terminator_cost_changed(1000, 1000));
+    CHECK_FALSE(terminator_cost_changed(1000, 1099));
+    CHECK_FALSE(terminator_cost_changed(1000, 901));
+    CHECK(terminator_cost_changed(1000, 1100));
+    CHECK(terminator_cost_changed(1000, 900));
+    CHECK(terminator_cost_changed(1000, 0));
+
+    CHECK_FALSE(terminator_cost_changed(UINT16_MAX, UINT16_MAX - 1));
+    CHECK(terminator_cost_changed(UINT16_MAX, 0));
+    CHECK(terminator_cost_changed(0, UINT16_MAX));
+}
+
+// API session refresh is only counted
+struct counting_auth {
+    ziti_auth_method_t api = {};
+    int refreshes = 0;
+};
+
+// no 'Dial' session yet, it is requested from controller played by `srv`
+class session_fixture : public conn_fixture {
+public:
+    session_fixture() : srv(loop) {
+        free_ziti_session_ptr((ziti_session *) model_map_remove(&ztx->sessions, "test-service-id"));
+
+        auth.api.force_refresh = [](ziti_auth_method_t *self) {
+            ((counting_auth *) self)->refreshes++;
+            return 0;
+        };
+        ztx->auth_method = &auth.api;
+
+        srv.handler = [this](const std::string &method, const std::string &path) {
+            fake_ctrl::response r;
+            if (method == "POST" && path == "/edge/client/v1/sessions") {
+                if (failures > 0) {
+                    failures--;
+                    r.code = 401;
+                    r.body = fake_ctrl::error(failure, "session request failed");
+                } else {
+                    r.body = fake_ctrl::data(R"({"id":"new-session-id","token":"new-session-token",)"
+                                             R"("serviceId":"test-service-id","edgeRouters":[)"
+                                             R"({"name":"er0","supportedProtocols":{"tls":"tls://er0.test:3022"}},)"
+                                             R"({"name":"er1","supportedProtocols":{"tls":"tls://er1.test:3022"}}]})");
+                }
+            } else {
+                r.code = 404;
+                r.body = fake_ctrl::error("NOT_FOUND", "not found");
+            }
+            return r;
+        };
+
+        model_list urls = {};
+        model_list_append(&urls, (void *) srv.url.c_str());
+        REQUIRE(ziti_ctrl_init(loop, &ztx->ctrl, &urls, nullptr) == ZITI_OK);
+        model_list_clear(&urls, nullptr);
+        ztx->ctrl.has_token = true;
+
+        // wait for version request
+        run_until([this] { return ztx->ctrl.active_reqs == 0; });
+    }
+
+    ~session_fixture() {
+        ziti_ctrl_close(&ztx->ctrl);
+        model_list_clear(&ztx->prefetch_queue, free);
+        srv.close();
+        uv_run(loop, UV_RUN_NOWAIT);
+    }
+
+    void run_until(const std::function<bool()> &done, uint64_t timeout = 5000) {
+        // keeps the loop from blocking if nothing else happens
+        uv_timer_t t;
+        uv_timer_init(loop, &t);
+        uv_timer_start(&t, [](uv_timer_t *) {}, 10, 10);
+        uint64_t end = uv_now(loop) + timeout;
+        while (!done() && uv_now(loop) < end) {
+            uv_run(loop, UV_RUN_ONCE);
+        }
+        uv_close((uv_handle_t *) &t, nullptr);
+        uv_run(loop, UV_RUN_NOWAIT);
+        REQUIRE(done());
+    }
+
+    fake_ctrl srv;
+    counting_auth auth;
+    // number of session requests that fail with `failure` code
+    int failures = 0;
+    std::string failure;
+};
+
+TEST_CASE_METHOD(session_fixture, "concurrent dials share session request", "[conn]") {
+    dial_result res[3];
+    ziti_connection conns[3];
+    for (int i = 0; i < 3; i++) {
+        conns[i] = dial(dial_cb, &res[i]);
+        CHECK(conns[i]->channel == nullptr);
+    }
+    CHECK(model_map_size(&ztx->session_requests) == 1);
+
+    SECTION("all waiters connect") {
+        run_until([&] {
+            return conns[0]->channel && conns[1]->channel && conns[2]->channel;
+        });
+        for (auto c: conns) {
+            int connects = 0;
+            for (auto &m: sent(c->channel, ContentTypeConnect)) {
+                connects += m.conn_id == (int32_t) c->conn_id;
+            }
+            CHECK(connects == 1);
+        }
+    }
+
+    SECTION("waiter closed before reply") {
+        close(conns[1]);
+        conns[1] = nullptr;
+        run_until([&] { return conns[0]->channel && conns[2]->channel; });
+        CHECK(res[1].count == 0);
+        CHECK(model_map_size(&ztx->connections) == 2);
+    }
+
+    SECTION("not authorized restarts waiters") {
+        failures = 1;
+        failure = "COULD_NOT_VALIDATE";
+        run_until([&] {
+            return conns[0]->channel && conns[1]->channel && conns[2]->channel;
+        });
+        CHECK(auth.refreshes == 1);
+        for (int i = 0; i < 3; i++) {
+            CHECK(res[i].count == 0);
+            CHECK(std::string(ziti_conn_state(conns[i])) == "Connecting");
+        }
+        // restarted waiters share the new request too
+        CHECK(srv.count("POST /edge/client/v1/sessions") == 2);
+    }
+
+    SECTION("failure is reported to all waiters") {
+        failures = 1;
+        failure = "NOT_FOUND";
+        run_until([&] { return res[0].count && res[1].count && res[2].count; });
+        for (auto &r: res) {
+            CHECK(r.count == 1);
+            CHECK(r.status == ZITI_SERVICE_UNAVAILABLE);
+        }
+        CHECK(auth.refreshes == 0);
+    }
+
+    if (failures == 0 && failure.empty()) {
+        CHECK(srv.count("POST /edge/client/v1/sessions") == 1);
+    }
+    CHECK(model_map_size(&ztx->session_requests) == 0);
+    for (auto c: conns) {
+        if (c) {
+            close(c);
+        }
+    }
+}
+
+TEST_CASE_METHOD(session_fixture, "prefetch dial sessions", "[conn]") {
+    ztx->opts.api_page_concurrency = 2;
+    for (auto id: {"test-service-id", "svc-a-id", "svc-b-id", "svc-c-id"}) {
+        model_list_append(&ztx->prefetch_queue, strdup(id));
+    }
+
+    ztx_prefetch_next(ztx);
+    CHECK(ztx->prefetch_inflight == 2);
+    CHECK(model_list_size(&ztx->prefetch_queue) == 2);
+    CHECK(model_map_size(&ztx->session_requests) == 2);
+
+    // joins prefetch that is in flight
+    CHECK_FALSE(ziti_prefetch_dial_session(ztx, "test-service-id"));
+    dial_result res;
+    ziti_connection conn = dial(dial_cb, &res);
+    CHECK(model_map_size(&ztx->session_requests) == 2);
+
+    run_until([&] {
+        return ztx->prefetch_inflight == 0 && model_list_size(&ztx->prefetch_queue) == 0 &&
+               conn->channel != nullptr;
+    });
+    CHECK(srv.count("POST /edge/client/v1/sessions") == 4);
+    CHECK(model_map_size(&ztx->sessions) == 4);
+    CHECK(model_map_size(&ztx->session_requests) == 0);
+    CHECK(sent(conn->channel, ContentTypeConnect).size() == 1);
+
+    close(conn);
+}
+
+TEST_CASE_METHOD(session_fixture, "invalid session abandons raced connect", "[conn]") {
+    ztx->opts.dial_racing = true;
+    // race delay is at its minimum
+    ztx->dial_time = 1;
+
+    dial_result res;
+    ziti_connection conn = dial(dial_cb, &res);
+    run_until([&] { return conn->channel != nullptr; });
+    ziti_channel_t *first = conn->channel;
+    ziti_channel_t *second = first == ch[0] ? ch[1] : ch[0];
+
+    run_for(100);
+    auto connects = sent(second, ContentTypeConnect);
+    REQUIRE(connects.size() == 1);
+    complete_writes(first);
+    complete_writes(second);
+
+    // edge router rejects the first circuit without replying to connect
+    int32_t conn_id = conn->conn_id;
+    deliver(first, ContentTypeStateClosed, {var_header(ConnIdHeader, conn_id)}, "Invalid Session");
+    uv_run(loop, UV_RUN_NOWAIT);
+    CHECK(res.count == 0);
+    CHECK(model_map_getl(&second->receivers, conn_id) == nullptr);
+
+    // late reply to the raced connect is closed, and not taken for the restarted one
+    reply(second, connects[0], ContentTypeStateConnected);
+    CHECK(res.count == 0);
+    auto closed = sent(second, ContentTypeStateClosed);
+    REQUIRE(closed.size() == 1);
+    CHECK(closed[0].conn_id == conn_id);
+
+    run_until([&] { return conn->channel != nullptr; });
+    CHECK(srv.count("POST /edge/client/v1/sessions") == 2);
+    CHECK(std::string(ziti_conn_state(conn)) == "Connecting");
+    accept(conn);
+    CHECK(res.count == 1);
+    CHECK(res.status == ZITI_OK);
+
+    close(conn);
+}
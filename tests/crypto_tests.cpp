@@ -0,0 +1,226 @@
+// Copyright (c) 2024.  NetFoundry Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+#include <vector>
+
+#include "catch2/catch_test_macros.hpp"
+#include "zt_internal.h"
+
+static std::vector<uint8_t> push(gcm_stream &s, const std::string &m) {
+    std::vector<uint8_t> c(m.size() + GCM_STREAM_ABYTES);
+    REQUIRE(gcm_stream_push(&s, c.data(), (const uint8_t *) m.data(), m.size()) == 0);
+    return c;
+}
+
+static int pull(gcm_stream &s, const std::vector<uint8_t> &c, std::string &m) {
+    std::vector<uint8_t> buf(c.size());
+    unsigned long long len = 0;
+    int rc = gcm_stream_pull(&s, buf.data(), &len, c.data(), c.size());
+    m = rc == 0 ? std::string((char *) buf.data(), len) : "";
+    return rc;
+}
+
+TEST_CASE("gcm stream", "[crypto]") {
+    if (!gcm_stream_available()) {
+        WARN("AES-256-GCM is not available on this CPU");
+        return;
+    }
+
+    uint8_t key[crypto_aead_aes256gcm_KEYBYTES];
+    randombytes_buf(key, sizeof(key));
+
+    gcm_stream out = {}, in = {};
+    uint8_t header[GCM_STREAM_HEADERBYTES];
+    REQUIRE(gcm_stream_init_push(&out, header, key) == 0);
+    CHECK(header[0] == CryptoMethodAES256GCM);
+    REQUIRE(gcm_stream_init_pull(&in, header, key) == 0);
+
+    std::string m;
+    SECTION("round trip") {
+        auto c1 = push(out, "this is a test");
+        CHECK(c1.size() == strlen("this is a test") + GCM_STREAM_ABYTES);
+        auto c2 = push(out, "");
+        auto c3 = push(out, "another message");
+
+        CHECK(pull(in, c1, m) == 0);
+        CHECK(m == "this is a test");
+        CHECK(pull(in, c2, m) == 0);
+        CHECK(m.empty());
+        CHECK(pull(in, c3, m) == 0);
+        CHECK(m == "another message");
+        CHECK(in.counter == 3);
+        CHECK(out.counter == 3);
+    }
+
+    SECTION("every message gets its own nonce") {
+        auto c1 = push(out, "same message");
+        auto c2 = push(out, "same message");
+        CHECK(c1 != c2);
+        // nonce base is random for every stream
+        gcm_stream other = {};
+        uint8_t other_header[GCM_STREAM_HEADERBYTES];
+        REQUIRE(gcm_stream_init_push(&other, other_header, key) == 0);
+        CHECK(memcmp(header, other_header, sizeof(header)) != 0);
+        CHECK(push(other, "same message") != c1);
+    }
+
+    SECTION("messages must be pulled in order") {
+        auto c1 = push(out, "first");
+        auto c2 = push(out, "second");
+        CHECK(pull(in, c2, m) != 0);
+
+        // counter advances on failure, stream cannot be resynced
+        gcm_stream fresh = {};
+        REQUIRE(gcm_stream_init_pull(&fresh, header, key) == 0);
+        CHECK(pull(fresh, c1, m) == 0);
+        CHECK(m == "first");
+        CHECK(pull(fresh, c2, m) == 0);
+        CHECK(m == "second");
+    }
+
+    SECTION("tampered message is rejected") {
+        auto c = push(out, "do not touch");
+        SECTION("payload") {
+            c[0] ^= 1;
+        }
+        SECTION("tag") {
+            c.back() ^= 1;
+        }
+        SECTION("truncated") {
+            c.pop_back();
+        }
+        CHECK(pull(in, c, m) != 0);
+    }
+
+    SECTION("wrong key") {
+        uint8_t other_key[crypto_aead_aes256gcm_KEYBYTES];
+        randombytes_buf(other_key, sizeof(other_key));
+        gcm_stream other = {};
+        REQUIRE(gcm_stream_init_pull(&other, header, other_key) == 0);
+        CHECK(pull(other, push(out, "secret"), m) != 0);
+    }
+
+    SECTION("header of another cipher") {
+        header[0] = CryptoMethodLibsodium;
+        gcm_stream other = {};
+        CHECK(gcm_stream_init_pull(&other, header, key) != 0);
+    }
+}
+
+class key_pool_fixture {
+public:
+    key_pool_fixture() {
+        loop = uv_loop_new();
+        ztx = (ziti_context) calloc(1, sizeof(*ztx));
+        ztx->loop = loop;
+        ztx->opts.key_pool_size = 4;
+    }
+
+    ~key_pool_fixture() {
+        ztx_free_key_pool(ztx);
+        uv_run(loop, UV_RUN_DEFAULT);
+        free(ztx);
+        CHECK(uv_loop_close(loop) == 0);
+        free(loop);
+    }
+
+    // wait for pool refill to complete
+    void run() {
+        uv_run(loop, UV_RUN_DEFAULT);
+    }
+
+    static bool is_valid(const key_pair &kp) {
+        uint8_t pk[crypto_kx_PUBLICKEYBYTES];
+        crypto_scalarmult_base(pk, kp.sk);
+        return memcmp(pk, kp.pk, sizeof(pk)) == 0;
+    }
+
+    uv_loop_t *loop;
+    ziti_context ztx;
+};
+
+TEST_CASE_METHOD(key_pool_fixture, "key pool", "[crypto]") {
+    key_pair kp = {};
+
+    SECTION("pop and refill") {
+        ztx_fill_key_pool(ztx);
+        REQUIRE(ztx->key_pool_work != nullptr);
+        run();
+        REQUIRE(ztx->key_pool_count == 4);
+        REQUIRE(ztx->key_pool_work == nullptr);
+
+        // pooled keys are handed out, until it is half empty
+        key_pair top = ztx->key_pool[3];
+        ztx_get_key_pair(ztx, &kp);
+        CHECK(memcmp(&kp, &top, sizeof(kp)) == 0);
+        CHECK(is_valid(kp));
+        CHECK(ztx->key_pool_count == 3);
+        CHECK(ztx->key_pool_work == nullptr);
+
+        ztx_get_key_pair(ztx, &kp);
+        CHECK(ztx->key_pool_count == 2);
+        CHECK(ztx->key_pool_work != nullptr);
+
+        // only one batch at a time
+        auto work = ztx->key_pool_work;
+        ztx_get_key_pair(ztx, &kp);
+        CHECK(ztx->key_pool_work == work);
+        CHECK(ztx->key_pool_count == 1);
+
+        // batch was sized when pool had two keys
+        run();
+        CHECK(ztx->key_pool_count == 3);
+        for (unsigned int i = 0; i < ztx->key_pool_count; i++) {
+            CHECK(is_valid(ztx->key_pool[i]));
+        }
+    }
+
+    SECTION("empty pool") {
+        // key pair is generated inline
+        ztx_get_key_pair(ztx, &kp);
+        CHECK(is_valid(kp));
+        CHECK(ztx->key_pool_count == 0);
+        CHECK(ztx->key_pool_work != nullptr);
+
+        run();
+        CHECK(ztx->key_pool_count == 4);
+    }
+
+    SECTION("pool size change") {
+        ztx_fill_key_pool(ztx);
+        run();
+        REQUIRE(ztx->key_pool_count == 4);
+
+        ztx->opts.key_pool_size = 2;
+        ztx_get_key_pair(ztx, &kp);
+        CHECK(ztx->key_pool_cap == 2);
+        CHECK(ztx->key_pool_count == 2);
+        CHECK(ztx->key_pool_work == nullptr);
+        CHECK(is_valid(ztx->key_pool[0]));
+        CHECK(is_valid(ztx->key_pool[1]));
+    }
+
+    SECTION("released with refill in flight") {
+        ztx_fill_key_pool(ztx);
+        REQUIRE(ztx->key_pool_work != nullptr);
+
+        // batch is detached and freed by its done callback
+        ztx_free_key_pool(ztx);
+        CHECK(ztx->key_pool_work == nullptr);
+        CHECK(ztx->key_pool == nullptr);
+        run();
+        CHECK(ztx->key_pool_count == 0);
+    }
+}
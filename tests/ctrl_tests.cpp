@@ -0,0 +1,429 @@
+// Copyright (c) 2024.  NetFoundry Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <functional>
+#include <string>
+
+#include "catch2/catch_test_macros.hpp"
+#include "zt_internal.h"
+#include "fake_ctrl.h"
+
+// two HA endpoints that accept connections but never respond
+class ctrl_fixture {
+public:
+    ctrl_fixture() {
+        loop = uv_loop_new();
+        model_list urls = {};
+        for (int i = 0; i < 2; i++) {
+            struct sockaddr_in addr = {};
+            uv_ip4_addr("127.0.0.1", 0, &addr);
+            uv_tcp_init(loop, &srv[i]);
+            uv_tcp_bind(&srv[i], (const struct sockaddr *) &addr, 0);
+            uv_listen((uv_stream_t *) &srv[i], 5, [](uv_stream_t *, int) {});
+
+            int len = sizeof(addr);
+            uv_tcp_getsockname(&srv[i], (struct sockaddr *) &addr, &len);
+            url[i] = "https://127.0.0.1:" + std::to_string(ntohs(addr.sin_port));
+            model_list_append(&urls, (void *) url[i].c_str());
+        }
+
+        REQUIRE(ziti_ctrl_init(loop, &ctrl, &urls, nullptr) == ZITI_OK);
+        model_list_clear(&urls, nullptr);
+        drain();
+    }
+
+    ~ctrl_fixture() {
+        close();
+        for (auto &s: srv) {
+            uv_close((uv_handle_t *) &s, nullptr);
+        }
+        uv_run(loop, UV_RUN_DEFAULT);
+        uv_loop_close(loop);
+        free(loop);
+    }
+
+    // cancel requests in flight(e.g. GET /version after switching endpoints)
+    void drain() {
+        ziti_ctrl_cancel(&ctrl);
+        uv_run(loop, UV_RUN_NOWAIT);
+        REQUIRE(ctrl.active_reqs == 0);
+    }
+
+    void close() {
+        if (ctrl.client) {
+            ziti_ctrl_close(&ctrl);
+        }
+    }
+
+    void run_for(uint64_t ms) {
+        uv_timer_t t;
+        bool done = false;
+        uv_timer_init(loop, &t);
+        t.data = &done;
+        uv_timer_start(&t, [](uv_timer_t *t) { *(bool *) t->data = true; }, ms, 0);
+        while (!done) {
+            uv_run(loop, UV_RUN_ONCE);
+        }
+        uv_close((uv_handle_t *) &t, nullptr);
+        uv_run(loop, UV_RUN_NOWAIT);
+    }
+
+    ziti_controller_detail *ep(const std::string &u) {
+        return (ziti_controller_detail *) model_map_get(&ctrl.endpoints, u.c_str());
+    }
+
+    std::string other(const std::string &u) {
+        return u == url[0] ? url[1] : url[0];
+    }
+
+    uv_loop_t *loop;
+    uv_tcp_t srv[2];
+    std::string url[2];
+    ziti_controller ctrl;
+};
+
+TEST_CASE_METHOD(ctrl_fixture, "controller endpoint selection", "[ctrl]") {
+    std::string curr = ctrl.url;
+    std::string next = other(curr);
+
+    ep(curr)->latency = 100;
+    ep(next)->latency = 80;
+    ziti_ctrl_select_ep(&ctrl);
+    CHECK(curr == ctrl.url);
+
+    // failing endpoint is never selected
+    ep(next)->latency = 60;
+    ep(next)->failures = 1;
+    ziti_ctrl_select_ep(&ctrl);
+    CHECK(curr == ctrl.url);
+
+    ep(next)->failures = 0;
+    ziti_ctrl_select_ep(&ctrl);
+    CHECK(next == ctrl.url);
+    CHECK(ctrl.latency_count == 0);
+
+    // not while requests are in flight
+    ep(curr)->latency = 10;
+    CHECK(ctrl.active_reqs > 0);
+    ziti_ctrl_select_ep(&ctrl);
+    CHECK(next == ctrl.url);
+    drain();
+
+    // failing current endpoint is replaced even by a slower one
+    ep(curr)->latency = 200;
+    ep(next)->failures = 1;
+    ziti_ctrl_select_ep(&ctrl);
+    CHECK(curr == ctrl.url);
+    drain();
+}
+
+TEST_CASE_METHOD(ctrl_fixture, "controller hedge delay", "[ctrl]") {
+    CHECK(ziti_ctrl_hedge_delay(&ctrl) == 0);
+
+    for (unsigned int i = 0; i < 7; i++) {
+        ctrl.latency_samples[i] = 100;
+    }
+    ctrl.latency_count = 7;
+    CHECK(ziti_ctrl_hedge_delay(&ctrl) == 0);
+
+    for (unsigned int i = 0; i < CTRL_LATENCY_SAMPLES; i++) {
+        ctrl.latency_samples[i] = CTRL_LATENCY_SAMPLES - i;
+    }
+    ctrl.latency_count = CTRL_LATENCY_SAMPLES;
+    // p95 is below the minimum delay
+    CHECK(ziti_ctrl_hedge_delay(&ctrl) == 50);
+
+    for (unsigned int i = 0; i < CTRL_LATENCY_SAMPLES; i++) {
+        ctrl.latency_samples[i] = 100 + i;
+    }
+    // ring buffer wrapped around
+    ctrl.latency_count = CTRL_LATENCY_SAMPLES + 10;
+    CHECK(ziti_ctrl_hedge_delay(&ctrl) == 130);
+}
+
+struct hedge_result {
+    int count;
+    int err;
+};
+
+static void hedge_identity_cb(ziti_identity_data *id, const ziti_error *err, void *ctx) {
+    auto r = (hedge_result *) ctx;
+    r->count++;
+    r->err = err ? err->err : ZITI_OK;
+    free_ziti_identity_data_ptr(id);
+}
+
+TEST_CASE_METHOD(ctrl_fixture, "controller hedged request", "[ctrl]") {
+    std::string curr = ctrl.url;
+    std::string next = other(curr);
+
+    ctrl.is_ha = true;
+    ziti_ctrl_set_hedging(&ctrl, true);
+    ep(curr)->latency = 20;
+    ep(next)->latency = 30;
+
+    // legacy api session
+    ctrl.has_token = true;
+    ctrl.session_token = strdup("legacy-session-token");
+
+    hedge_result res = {};
+
+    SECTION("no hedging without latency samples") {
+        ziti_ctrl_current_identity(&ctrl, hedge_identity_cb, &res);
+        run_for(100);
+        CHECK(ctrl.hedge_client == nullptr);
+        CHECK(ctrl.hedge_reqs == 0);
+    }
+
+    SECTION("slow request is sent to the next endpoint") {
+        for (auto &s: ctrl.latency_samples) {
+            s = 10;
+        }
+        ctrl.latency_count = CTRL_LATENCY_SAMPLES;
+
+        ziti_ctrl_current_identity(&ctrl, hedge_identity_cb, &res);
+        run_for(20);
+        CHECK(ctrl.hedge_client == nullptr);
+
+        run_for(80);
+        REQUIRE(ctrl.hedge_client != nullptr);
+        CHECK(ctrl.hedge_reqs == 1);
+        CHECK(next == ctrl.hedge_url);
+        CHECK(res.count == 0);
+    }
+
+    // both requests of the hedged pair complete the caller only once
+    close();
+    CHECK(res.count == 1);
+    CHECK(res.err == ZITI_DISABLED);
+}
+
+// controller that actually responds, see fake_ctrl
+class http_ctrl_fixture {
+public:
+    http_ctrl_fixture() : srv((loop = uv_loop_new())) {
+        model_list urls = {};
+        model_list_append(&urls, (void *) srv.url.c_str());
+        REQUIRE(ziti_ctrl_init(loop, &ctrl, &urls, nullptr) == ZITI_OK);
+        model_list_clear(&urls, nullptr);
+        ctrl.has_token = true;
+
+        // wait for version request
+        run_until([this] { return ctrl.active_reqs == 0; });
+    }
+
+    ~http_ctrl_fixture() {
+        ziti_ctrl_close(&ctrl);
+        srv.close();
+        uv_run(loop, UV_RUN_DEFAULT);
+        CHECK(uv_loop_close(loop) == 0);
+        free(loop);
+    }
+
+    void run_until(const std::function<bool()> &done, uint64_t timeout = 5000) {
+        // keeps the loop from blocking if nothing else happens
+        uv_timer_t t;
+        uv_timer_init(loop, &t);
+        uv_timer_start(&t, [](uv_timer_t *) {}, 10, 10);
+        uint64_t end = uv_now(loop) + timeout;
+        while (!done() && uv_now(loop) < end) {
+            uv_run(loop, UV_RUN_ONCE);
+        }
+        uv_close((uv_handle_t *) &t, nullptr);
+        uv_run(loop, UV_RUN_NOWAIT);
+        REQUIRE(done());
+    }
+
+    uv_loop_t *loop;
+    fake_ctrl srv;
+    ziti_controller ctrl;
+};
+
+struct sessions_result {
+    int count;
+    int err;
+    std::vector<std::string> ids;
+};
+
+static void sessions_cb(ziti_session **sessions, const ziti_error *err, void *ctx) {
+    auto r = (sessions_result *) ctx;
+    r->count++;
+    r->err = err ? err->err : ZITI_OK;
+    for (int i = 0; sessions && sessions[i]; i++) {
+        r->ids.emplace_back(sessions[i]->id);
+    }
+    free_ziti_session_array(&sessions);
+}
+
+TEST_CASE_METHOD(http_ctrl_fixture, "controller parallel paging", "[ctrl]") {
+    const int total = 11;
+    const int limit = 2;
+    ziti_ctrl_set_page_size(&ctrl, limit);
+    ziti_ctrl_set_page_concurrency(&ctrl, 3);
+
+    int failing_offset = -1;
+    bool lost_body = false;
+    srv.handler = [&](const std::string &, const std::string &path) {
+        fake_ctrl::response r;
+        int offset = fake_ctrl::query_int(path, "offset");
+        if (offset == failing_offset && !lost_body) {
+            r.code = 500;
+            r.body = fake_ctrl::error("UNHANDLED", "page failed");
+            return r;
+        }
+
+        std::string items = "[";
+        for (int i = offset; i < offset + limit && i < total; i++) {
+            items += (i > offset ? "," : "") + std::string(R"({"id":"s)") + std::to_string(i) + R"("})";
+        }
+        items += "]";
+        r.body = fake_ctrl::page(items, offset, limit, total);
+        // earlier pages complete later
+        r.delay = offset == 0 ? 0 : (uint64_t) (total - offset) * 10;
+        r.drop = offset == failing_offset;
+        return r;
+    };
+
+    sessions_result res = {};
+
+    SECTION("pages are assembled in order") {
+        ziti_ctrl_get_sessions(&ctrl, sessions_cb, &res);
+        run_until([&] { return res.count > 0; });
+        CHECK(res.count == 1);
+        CHECK(res.err == ZITI_OK);
+        REQUIRE(res.ids.size() == total);
+        for (int i = 0; i < total; i++) {
+            CHECK(res.ids[i] == "s" + std::to_string(i));
+        }
+        CHECK(srv.count("/sessions") == (total + limit - 1) / limit);
+    }
+
+    SECTION("failing page stops paging") {
+        failing_offset = 2 * limit;
+        SECTION("error response") {}
+        SECTION("connection lost while reading page") {
+            lost_body = true;
+        }
+        ziti_ctrl_get_sessions(&ctrl, sessions_cb, &res);
+        run_until([&] { return res.count > 0 && ctrl.active_reqs == 0; });
+        CHECK(res.count == 1);
+        CHECK(res.err != ZITI_OK);
+        CHECK(res.ids.empty());
+        // remaining pages are not requested after the failure
+        CHECK(srv.count("/sessions") < (total + limit - 1) / limit);
+    }
+}
+
+struct identity_result {
+    int count;
+    int err;
+    std::string name;
+};
+
+static void identity_cb(ziti_identity_data *data, const ziti_error *err, void *ctx) {
+    auto r = (identity_result *) ctx;
+    r->count++;
+    r->err = err ? err->err : ZITI_OK;
+    if (data) {
+        r->name = data->name;
+        free_ziti_identity_data_ptr(data);
+    }
+}
+
+TEST_CASE_METHOD(http_ctrl_fixture, "joined in-flight requests", "[ctrl]") {
+    bool fail = false;
+    srv.handler = [&](const std::string &, const std::string &path) {
+        fake_ctrl::response r;
+        r.delay = 50;
+        if (fail) {
+            r.code = 404;
+            r.body = fake_ctrl::error("NOT_FOUND", "identity not found");
+        } else if (path.find("/current-identity") != std::string::npos) {
+            r.body = fake_ctrl::data(R"({"id":"identity-id","name":"identity"})");
+        } else {
+            r.body = fake_ctrl::data(R"({"id":"session-id","token":"session-token"})");
+        }
+        return r;
+    };
+
+    identity_result res[3] = {};
+
+    SECTION("every caller gets parsed result") {
+        for (auto &r: res) {
+            ziti_ctrl_current_identity(&ctrl, identity_cb, &r);
+        }
+        run_until([&] { return res[0].count && res[1].count && res[2].count; });
+        CHECK(srv.count("/current-identity") == 1);
+        for (auto &r: res) {
+            CHECK(r.count == 1);
+            CHECK(r.err == ZITI_OK);
+            CHECK(r.name == "identity");
+        }
+
+        // completed request can no longer be joined
+        ziti_ctrl_current_identity(&ctrl, identity_cb, &res[0]);
+        run_until([&] { return res[0].count == 2; });
+        CHECK(srv.count("/current-identity") == 2);
+    }
+
+    SECTION("error is reported to every caller") {
+        fail = true;
+        for (auto &r: res) {
+            ziti_ctrl_current_identity(&ctrl, identity_cb, &r);
+        }
+        run_until([&] { return res[0].count && res[1].count && res[2].count; });
+        CHECK(srv.count("/current-identity") == 1);
+        for (auto &r: res) {
+            CHECK(r.count == 1);
+            CHECK(r.err == ZITI_NOT_FOUND);
+        }
+    }
+
+    SECTION("only identical requests are joined") {
+        int count = 0;
+        auto cb = [](ziti_session *s, const ziti_error *err, void *ctx) {
+            (*(int *) ctx)++;
+            free_ziti_session_ptr(s);
+        };
+        ziti_ctrl_get_session(&ctrl, "a", cb, &count);
+        ziti_ctrl_get_session(&ctrl, "b", cb, &count);
+        ziti_ctrl_get_session(&ctrl, "a", cb, &count);
+        run_until([&] { return count == 3; });
+        CHECK(srv.count("/sessions/a") == 1);
+        CHECK(srv.count("/sessions/b") == 1);
+    }
+
+    SECTION("callers released before completion") {
+        // each caller context is freed by its callback, second call would be use-after-free
+        int calls = 0;
+        auto cb = [](ziti_service_update *update, const ziti_error *err, void *ctx) {
+            auto c = (int **) ctx;
+            (**c)++;
+            free_ziti_service_update_ptr(update);
+            delete c;
+        };
+        for (int i = 0; i < 3; i++) {
+            ziti_ctrl_get_services_update(&ctrl, cb, new int *(&calls));
+        }
+        run_until([&] { return srv.count("service-updates") == 1; });
+        ziti_ctrl_cancel(&ctrl);
+        CHECK(calls == 3);
+
+        // late response is not delivered
+        uint64_t end = uv_now(loop) + 100;
+        run_until([&] { return uv_now(loop) >= end; });
+        CHECK(calls == 3);
+        CHECK(srv.count("service-updates") == 1);
+    }
+}
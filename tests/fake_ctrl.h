@@ -0,0 +1,264 @@
+// Copyright (c) 2024.  NetFoundry Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ZITI_SDK_FAKE_CTRL_H
+#define ZITI_SDK_FAKE_CTRL_H
+
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <uv.h>
+
+// plain HTTP server playing the controller,
+// every request is answered by `handler`, responses can be delayed to reorder completions
+class fake_ctrl {
+public:
+    struct response {
+        int code = 200;
+        std::string body;
+        uint64_t delay = 0;
+        // connection is lost in the middle of the response body
+        bool drop = false;
+    };
+
+    using handler_t = std::function<response(const std::string &method, const std::string &path)>;
+
+    explicit fake_ctrl(uv_loop_t *loop) {
+        struct sockaddr_in addr = {};
+        uv_ip4_addr("127.0.0.1", 0, &addr);
+        uv_tcp_init(loop, &srv);
+        srv.data = this;
+        uv_tcp_bind(&srv, (const struct sockaddr *) &addr, 0);
+        uv_listen((uv_stream_t *) &srv, 16, on_connection);
+
+        int len = sizeof(addr);
+        uv_tcp_getsockname(&srv, (struct sockaddr *) &addr, &len);
+        url = "http://127.0.0.1:" + std::to_string(ntohs(addr.sin_port));
+    }
+
+    // handles are released on the next loop iteration
+    void close() {
+        for (auto c: clients) {
+            c->close();
+        }
+        clients.clear();
+        uv_close((uv_handle_t *) &srv, nullptr);
+    }
+
+    // number of received requests with path containing `s`
+    size_t count(const std::string &s) const {
+        size_t n = 0;
+        for (auto &r: requests) {
+            n += r.find(s) != std::string::npos;
+        }
+        return n;
+    }
+
+    // controller response envelope
+    static std::string data(const std::string &json) {
+        return R"({"meta":{},"data":)" + json + "}";
+    }
+
+    static std::string page(const std::string &json, int offset, int limit, int total) {
+        return R"({"meta":{"pagination":{"offset":)" + std::to_string(offset) +
+               R"(,"limit":)" + std::to_string(limit) +
+               R"(,"totalCount":)" + std::to_string(total) + "}},\"data\":" + json + "}";
+    }
+
+    static std::string error(const std::string &code, const std::string &msg) {
+        return R"({"meta":{},"error":{"code":")" + code + R"(","message":")" + msg + R"("}})";
+    }
+
+    // value of query parameter in request path, -1 if not present
+    static int query_int(const std::string &path, const std::string &name) {
+        auto pos = path.find(name + "=");
+        if (pos == std::string::npos || (pos > 0 && path[pos - 1] != '?' && path[pos - 1] != '&')) {
+            return -1;
+        }
+        return std::stoi(path.substr(pos + name.size() + 1));
+    }
+
+    std::string url;
+    handler_t handler;
+    std::vector<std::string> requests;
+
+private:
+    struct client;
+
+    struct pending {
+        client *clt;
+        std::string out;
+        bool drop;
+        bool ready;
+        uv_timer_t *timer;
+    };
+
+    static void close_timer(pending *p) {
+        p->timer->data = nullptr;
+        uv_close((uv_handle_t *) p->timer, [](uv_handle_t *h) { delete (uv_timer_t *) h; });
+        p->timer = nullptr;
+    }
+
+    struct client {
+        fake_ctrl *srv;
+        uv_tcp_t tcp;
+        std::string in;
+        std::deque<pending *> out;
+
+        void close() {
+            for (auto p: out) {
+                if (p->timer) {
+                    close_timer(p);
+                }
+                delete p;
+            }
+            out.clear();
+            if (!uv_is_closing((uv_handle_t *) &tcp)) {
+                uv_close((uv_handle_t *) &tcp, [](uv_handle_t *h) { delete (client *) h->data; });
+            }
+        }
+
+        void flush() {
+            while (!out.empty() && out.front()->ready) {
+                auto p = out.front();
+                out.pop_front();
+                auto w = new uv_write_t;
+                auto buf = new std::string(std::move(p->out));
+                w->data = buf;
+                uv_buf_t b = uv_buf_init((char *) buf->data(), (unsigned int) buf->size());
+                uv_write(w, (uv_stream_t *) &tcp, &b, 1, [](uv_write_t *w, int) {
+                    delete (std::string *) w->data;
+                    delete w;
+                });
+                bool drop = p->drop;
+                delete p;
+                if (drop) {
+                    auto sr = new uv_shutdown_t;
+                    sr->data = this;
+                    uv_shutdown(sr, (uv_stream_t *) &tcp, [](uv_shutdown_t *sr, int) {
+                        auto c = (client *) sr->data;
+                        delete sr;
+                        c->srv->drop(c);
+                    });
+                    return;
+                }
+            }
+        }
+    };
+
+    static void on_connection(uv_stream_t *s, int status) {
+        auto self = (fake_ctrl *) s->data;
+        if (status < 0) return;
+
+        auto c = new client;
+        c->srv = self;
+        uv_tcp_init(s->loop, &c->tcp);
+        c->tcp.data = c;
+        if (uv_accept(s, (uv_stream_t *) &c->tcp) != 0) {
+            uv_close((uv_handle_t *) &c->tcp, [](uv_handle_t *h) { delete (client *) h->data; });
+            return;
+        }
+        self->clients.push_back(c);
+        uv_read_start((uv_stream_t *) &c->tcp,
+                      [](uv_handle_t *, size_t, uv_buf_t *b) {
+                          *b = uv_buf_init((char *) malloc(64 * 1024), 64 * 1024);
+                      },
+                      on_read);
+    }
+
+    static void on_read(uv_stream_t *s, ssize_t len, const uv_buf_t *b) {
+        auto c = (client *) s->data;
+        if (len > 0) {
+            c->in.append(b->base, len);
+            c->srv->process(c);
+        } else if (len < 0) {
+            c->srv->drop(c);
+        }
+        free(b->base);
+    }
+
+    void drop(client *c) {
+        for (auto it = clients.begin(); it != clients.end(); ++it) {
+            if (*it == c) {
+                clients.erase(it);
+                break;
+            }
+        }
+        c->close();
+    }
+
+    void process(client *c) {
+        size_t end;
+        while ((end = c->in.find("\r\n\r\n")) != std::string::npos) {
+            std::string head = c->in.substr(0, end);
+            size_t body_len = 0;
+            auto cl = head.find("Content-Length:");
+            if (cl == std::string::npos) cl = head.find("content-length:");
+            if (cl != std::string::npos) {
+                body_len = std::stoul(head.substr(cl + strlen("Content-Length:")));
+            }
+            if (c->in.size() < end + 4 + body_len) {
+                return;
+            }
+            c->in.erase(0, end + 4 + body_len);
+
+            auto sp1 = head.find(' ');
+            auto sp2 = head.find(' ', sp1 + 1);
+            std::string method = head.substr(0, sp1);
+            std::string path = head.substr(sp1 + 1, sp2 - sp1 - 1);
+            requests.push_back(method + " " + path);
+
+            response r;
+            if (path.find("/version") != std::string::npos) {
+                r.body = data(R"({"version":"v1.0.0","apiVersions":{"edge":{"v1":{"path":"/edge/client/v1"}}}})");
+            } else if (handler) {
+                r = handler(method, path);
+            } else {
+                r.code = 404;
+                r.body = error("NOT_FOUND", "not found");
+            }
+
+            auto p = new pending;
+            p->clt = c;
+            p->out = "HTTP/1.1 " + std::to_string(r.code) + " X\r\n"
+                     "Content-Type: application/json\r\n"
+                     "Content-Length: " + std::to_string(r.body.size()) + "\r\n\r\n" +
+                     (r.drop ? r.body.substr(0, r.body.size() / 2) : r.body);
+            p->drop = r.drop;
+            p->ready = r.delay == 0;
+            p->timer = nullptr;
+            c->out.push_back(p);
+            if (!p->ready) {
+                p->timer = new uv_timer_t;
+                uv_timer_init(c->tcp.loop, p->timer);
+                p->timer->data = p;
+                uv_timer_start(p->timer, [](uv_timer_t *t) {
+                    auto p = (pending *) t->data;
+                    p->ready = true;
+                    close_timer(p);
+                    p->clt->flush();
+                }, r.delay, 0);
+            }
+        }
+        c->flush();
+    }
+
+    uv_tcp_t srv;
+    std::vector<client *> clients;
+};
+
+#endif //ZITI_SDK_FAKE_CTRL_H
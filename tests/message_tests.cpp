@@ -15,6 +15,7 @@
 #include "catch2_includes.hpp"
 
 #include <cstring>
+#include <string>
 #include "message.h"
 #include "edge_protocol.h"
 #include "ziti/errors.h"
@@ -74,6 +75,59 @@ TEST_CASE("simple", "[model]") {
     pool_destroy(p);
 }
 
+TEST_CASE("clone", "[model]") {
+    auto p = pool_new(sizeof(message) + 200, 2, (void (*)(void *)) message_free);
+
+    int32_t conn_id = 42;
+    hdr_t headers[] = {
+            var_header(ConnIdHeader, conn_id),
+            {
+                    .header_id = 2,
+                    .length = 3,
+                    .value = (uint8_t *) "bar"
+            },
+    };
+    auto content1 = "this is a message";
+    uint32_t seq = 3333;
+    auto m1 = message_new(p, ContentTypeData, headers, 2, strlen(content1));
+    memcpy(m1->body, content1, strlen(content1));
+    message_set_seq(m1, &seq);
+
+    // same as channel does on inbound message
+    message *m2;
+    REQUIRE(message_new_from_header(p, m1->msgbufp, &m2) == ZITI_OK);
+    memcpy(m2->msgbufp, m1->msgbufp, m1->msgbuflen);
+    m2->nhdrs = parse_hdrs(m2->headers, m2->header.headers_len, &m2->hdrs);
+    REQUIRE(m2->nhdrs == 2);
+
+    // copy is made outside of exhausted pool
+    CHECK_FALSE(pool_has_available(p));
+    message *copy = message_clone(m2);
+    REQUIRE(copy != nullptr);
+    pool_return_obj(m2);
+
+    CHECK(copy->header.content == ContentTypeData);
+    CHECK(copy->header.seq == 3334);
+    CHECK(copy->header.headers_len == m1->header.headers_len);
+    CHECK(copy->header.body_len == strlen(content1));
+    CHECK(copy->msgbuflen == m1->msgbuflen);
+    CHECK(memcmp(copy->msgbufp, m1->msgbufp, m1->msgbuflen) == 0);
+    CHECK(copy->nhdrs == 2);
+
+    int32_t id;
+    CHECK(message_get_int32_header(copy, ConnIdHeader, &id));
+    CHECK(id == conn_id);
+    const uint8_t *hdrval;
+    size_t hdrlen;
+    CHECK(message_get_bytes_header(copy, 2, &hdrval, &hdrlen));
+    CHECK(std::string((const char *) hdrval, hdrlen) == "bar");
+    CHECK(std::string((const char *) copy->body, copy->header.body_len) == content1);
+
+    pool_return_obj(copy);
+    pool_return_obj(m1);
+    pool_destroy(p);
+}
+
 TEST_CASE("large", "[model]") {
     auto p = pool_new(sizeof(message) + 20, 3, (void (*)(void *)) message_free);
 
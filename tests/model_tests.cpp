@@ -825,3 +825,156 @@ TEST_CASE("parse duration", "[model]") {
         // check it matches the pre-calculated data
     REQUIRE(d.timeout == expected_output);
 }
+
+#define FAST_BAR_MODEL(xx, ...) \
+BAR_MODEL(xx, __VA_ARGS__)      \
+xx(bars, Bar, list, bars, __VA_ARGS__) \
+xx(tags, model_string, map, tags, __VA_ARGS__) \
+xx(local, model_number, none, , __VA_ARGS__)
+
+DECLARE_MODEL(FastBar, FAST_BAR_MODEL)
+IMPL_MODEL_SPECIALIZED(FastBar, FAST_BAR_MODEL)
+
+TEST_CASE("specialized model", "[model]") {
+    const char *json = R"({
+"num":42,
+"ok": false,
+"unknown": { "ignored": true },
+"time": "2020-07-20T14:14:14.666666Z",
+"msg":"this is a message",
+"errors": ["error1", "error2"],
+"codes": [401, 403],
+"shoes": [ "sandals", "slippers", "boots" ],
+"bars": [ { "num": 1 }, { "num": 2, "msg": "two" } ],
+"tags": { "color": "red" },
+"local": 13
+})";
+    FastBar fb;
+    REQUIRE(parse_FastBar(&fb, json, strlen(json)) == strlen(json));
+
+    Bar &bar = *(Bar *) &fb; // BAR_MODEL fields are laid out first
+    checkBar1(bar);
+    CHECK(model_list_size(&fb.shoes) == 3);
+    CHECK(model_list_size(&fb.bars) == 2);
+    CHECK_THAT((const char *) model_map_get(&fb.tags, "color"), Equals("red"));
+    CHECK(fb.local == 0);
+
+    Bar generic;
+    REQUIRE(parse_Bar(&generic, json, strlen(json)) == strlen(json));
+    CHECK(cmp_Bar(&bar, &generic) == 0);
+
+    auto generic_json = Bar_to_json(&generic, MODEL_JSON_COMPACT, nullptr);
+    auto fast_json = FastBar_to_json(&fb, MODEL_JSON_COMPACT, nullptr);
+    CHECK_THAT(fast_json, StartsWith(std::string(generic_json, strlen(generic_json) - 1)));
+
+    FastBar fb2;
+    REQUIRE(parse_FastBar(&fb2, fast_json, strlen(fast_json)) == strlen(fast_json));
+    CHECK(cmp_FastBar(&fb, &fb2) == 0);
+
+    fb2.num = 43;
+    CHECK(cmp_FastBar(&fb, &fb2) != 0);
+
+    free(fast_json);
+    free(generic_json);
+    free_Bar(&generic);
+    free_FastBar(&fb);
+    free_FastBar(&fb2);
+
+    const char *bad_json = R"({"num": "forty-two"})";
+    CHECK(parse_FastBar(&fb, bad_json, strlen(bad_json)) < 0);
+}
+
+// index is built on first parse, do it from several threads at once
+DECLARE_MODEL(RaceBar, FAST_BAR_MODEL)
+IMPL_MODEL_SPECIALIZED(RaceBar, FAST_BAR_MODEL)
+
+TEST_CASE("specialized model parsed from multiple threads", "[model]") {
+    struct parse_s {
+        int parsed;
+        int matched;
+    } results[4] = {};
+
+    uv_thread_t threads[4];
+    for (int i = 0; i < 4; i++) {
+        uv_thread_create(&threads[i], [](void *arg) {
+            auto r = (parse_s *) arg;
+            const char *json = R"({"num":42, "msg": "hello", "local": 13})";
+            for (int n = 0; n < 100; n++) {
+                RaceBar rb;
+                if (parse_RaceBar(&rb, json, strlen(json)) == (ssize_t) strlen(json)) {
+                    r->parsed++;
+                    if (rb.num == 42 && rb.msg != nullptr && strcmp(rb.msg, "hello") == 0) {
+                        r->matched++;
+                    }
+                    free_RaceBar(&rb);
+                }
+            }
+        }, &results[i]);
+    }
+
+    for (int i = 0; i < 4; i++) {
+        uv_thread_join(&threads[i]);
+        CHECK(results[i].parsed == 100);
+        CHECK(results[i].matched == 100);
+    }
+}
+
+TEST_CASE("string escape long runs", "[model]") {
+    // exercise vector scan across block boundaries with escapes at every position
+    for (size_t len : {1, 15, 16, 17, 31, 32, 33, 63, 64, 100}) {
+        for (size_t pos = 0; pos < len; pos++) {
+            for (char special : {'"', '\\', '\n', '\x01', '\x1f'}) {
+                std::string msg(len, 'a');
+                msg[pos] = special;
+
+                Bar bar = {0};
+                bar.msg = msg.c_str();
+                char *json = Bar_to_json(&bar, MODEL_JSON_COMPACT, nullptr);
+                REQUIRE(json != nullptr);
+
+                Bar parsed;
+                CAPTURE(len, pos, (int) special);
+                REQUIRE(parse_Bar(&parsed, json, strlen(json)) > 0);
+                CHECK(msg == parsed.msg);
+                free_Bar(&parsed);
+                free(json);
+            }
+        }
+    }
+
+    char small[16];
+    Bar bar = {0};
+    bar.msg = "this message does not fit";
+    CHECK(Bar_to_json_r(&bar, MODEL_JSON_COMPACT, small, sizeof(small)) == -1);
+}
+
+TEST_CASE("parse timestamps", "[model]") {
+    auto cmp = [](const char *lh, const char *rh) {
+        timestamp l, r;
+        REQUIRE(model_timestamp_from_string(&l, lh) == 0);
+        REQUIRE(model_timestamp_from_string(&r, rh) == 0);
+        return model_cmp(&l, &r, get_timestamp_meta());
+    };
+
+    timestamp t;
+    REQUIRE(model_timestamp_from_string(&t, "2024-01-01T00:00:00.5Z") == 0);
+    CHECK(t.tv_sec == 1704067200);
+    CHECK(t.tv_usec == 500000);
+
+    // fractional seconds with different precision
+    CHECK(cmp("2024-01-01T00:00:00.5Z", "2024-01-01T00:00:00.123456Z") > 0);
+    CHECK(cmp("2024-01-01T00:00:00.123456Z", "2024-01-01T00:00:00.5Z") < 0);
+    CHECK(cmp("2024-01-01T00:00:00.5Z", "2024-01-01T00:00:00.500000Z") == 0);
+    CHECK(cmp("2024-01-01T00:00:01Z", "2024-01-01T00:00:00.999999999Z") > 0);
+    CHECK(cmp("2024-01-01T00:00:00Z", "2024-01-01T00:00:00.000Z") == 0);
+
+    // time zone offsets
+    CHECK(cmp("2024-01-01T01:00:00+01:00", "2024-01-01T00:00:00Z") == 0);
+    CHECK(cmp("2023-12-31T23:30:00-01:00", "2024-01-01T00:00:00Z") > 0);
+
+    CHECK(cmp("2024-02-01T00:00:00Z", "2024-01-31T23:59:59.9Z") > 0);
+
+    CHECK(model_timestamp_from_string(&t, nullptr) != 0);
+    CHECK(model_timestamp_from_string(&t, "garbage") != 0);
+    CHECK(model_timestamp_from_string(&t, "2024-01-01T00:00:00") != 0);
+}
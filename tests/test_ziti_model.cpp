@@ -168,6 +168,7 @@ TEST_CASE("multi-edge-router session", "[model]") {
     ziti_session *s;
     REQUIRE(parse_ziti_session_ptr(&s, session_json, (int) strlen(session_json)) == strlen(session_json));
 
+    REQUIRE(s->type == ziti_session_types.Dial);
     REQUIRE(model_list_size(&s->edge_routers) == 3);
 
     auto it = model_list_iterator(&s->edge_routers);
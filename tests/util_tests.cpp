@@ -20,7 +20,9 @@
 
 #if _WIN32
 #include <io.h>
+#define dup(o) _dup(o)
 #define dup2(o,n) _dup2(o,n)
+#define close(fd) _close(fd)
 #else
 #include <unistd.h>
 #endif
@@ -63,7 +65,11 @@ TEST_CASE("read_file_stdin", "[util]") {
 
     auto input = uv_fs_open(nullptr, &req, test_path, 0, O_RDONLY, nullptr);
     REQUIRE(input > 0);
+    // load_file() closes stdin, it is restored so that later tests don't get it for their sockets
+    auto saved_stdin = dup(fileno(stdin));
+    REQUIRE(saved_stdin > 0);
     REQUIRE(dup2(input, fileno(stdin)) == 0);
+    close(input);
 
 
     char *content = nullptr;
@@ -81,6 +87,8 @@ TEST_CASE("read_file_stdin", "[util]") {
 
     free(content);
     uv_fs_req_cleanup(&req);
+    dup2(saved_stdin, fileno(stdin));
+    close(saved_stdin);
 }
 
 TEST_CASE("check hostname/domainname") {
@@ -92,4 +100,4 @@ TEST_CASE("check hostname/domainname") {
 
     printf("hostname = %s\n", info->hostname);
     printf("domain = %s\n", info->domain);
-}
\ No newline at end of file
+}
@@ -0,0 +1,164 @@
+// Copyright (c) 2024.  NetFoundry Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <functional>
+#include <string>
+
+#include "catch2/catch_test_macros.hpp"
+#include "fake_ctrl.h"
+#include "zt_internal.h"
+#include "posture.h"
+
+TEST_CASE("service update check", "[ztx]") {
+    ziti_service_update update = {};
+    update.last_change = (char *) "2024-01-01T00:00:00Z";
+
+    CHECK(ztx_service_check(nullptr, &update) == SERVICES_CHANGED);
+    CHECK(ztx_service_check("2023-12-31T00:00:00Z", &update) == SERVICES_CHANGED);
+    CHECK(ztx_service_check("2024-01-01T00:00:00Z", &update) == SERVICES_UNCHANGED);
+
+    // not modified
+    CHECK(ztx_service_check("2024-01-01T00:00:00Z", nullptr) == SERVICES_UNCHANGED);
+    // not modified, but previous fetch failed and dropped the marker
+    CHECK(ztx_service_check(nullptr, nullptr) == SERVICES_CHECK_AGAIN);
+}
+
+// context as it is before authentication completes, controller is played by `srv`
+class startup_fixture {
+public:
+    startup_fixture() : srv((loop = uv_loop_new())) {
+        ztx = (ziti_context) calloc(1, sizeof(*ztx));
+        ztx->loop = loop;
+        ztx->enabled = true;
+        ztx->refresh_timer = new_ztx_timer(ztx);
+        ztx->auth_method = &auth;
+        auth.kind = LEGACY;
+        // identity has its own certificate, no session cert request
+        ztx->id_creds.key = (tlsuv_private_key_t) &auth;
+        ztx->id_creds.cert = (tlsuv_certificate_t) &auth;
+
+        ztx->opts.events = ZitiServiceEvent;
+        ztx->opts.event_cb = [](ziti_context ztx, const ziti_event_t *ev) {
+            auto f = (startup_fixture *) ztx->opts.app_ctx;
+            f->service_events++;
+        };
+        ztx->opts.app_ctx = this;
+
+        model_list urls = {};
+        model_list_append(&urls, (void *) srv.url.c_str());
+        REQUIRE(ziti_ctrl_init(loop, &ztx->ctrl, &urls, nullptr) == ZITI_OK);
+        model_list_clear(&urls, nullptr);
+        ztx->ctrl.has_token = true;
+    }
+
+    ~startup_fixture() {
+        ziti_ctrl_close(&ztx->ctrl);
+        ziti_posture_checks_free(ztx->posture_checks);
+        uv_close((uv_handle_t *) ztx->refresh_timer, (uv_close_cb) free);
+        ztx_free_key_pool(ztx);
+        srv.close();
+        uv_run(loop, UV_RUN_DEFAULT);
+
+        model_map_clear(&ztx->services, (_free_f) free_ziti_service_ptr);
+        free(ztx->session_token);
+        free(ztx->last_update);
+        free(ztx);
+        CHECK(uv_loop_close(loop) == 0);
+        free(loop);
+    }
+
+    void authenticated() {
+        ztx_auth_state_cb(ztx, ZitiAuthStateFullyAuthenticated, "api-session-token");
+        // not testing posture responses
+        uv_timer_stop(ztx->posture_checks->timer);
+    }
+
+    void run_until(const std::function<bool()> &done, uint64_t timeout = 5000) {
+        uint64_t end = uv_now(loop) + timeout;
+        while (!done() && uv_now(loop) < end) {
+            uv_run(loop, UV_RUN_ONCE);
+        }
+        REQUIRE(done());
+    }
+
+    void run_for(uint64_t ms) {
+        uv_timer_t t;
+        bool done = false;
+        uv_timer_init(loop, &t);
+        t.data = &done;
+        uv_timer_start(&t, [](uv_timer_t *t) { *(bool *) t->data = true; }, ms, 0);
+        while (!done) {
+            uv_run(loop, UV_RUN_ONCE);
+        }
+        uv_close((uv_handle_t *) &t, nullptr);
+        uv_run(loop, UV_RUN_NOWAIT);
+    }
+
+    uv_loop_t *loop;
+    fake_ctrl srv;
+    ziti_context ztx;
+    ziti_auth_method_t auth = {};
+    int service_events = 0;
+};
+
+TEST_CASE_METHOD(startup_fixture, "startup requests after authentication", "[ztx]") {
+    uint64_t update_delay = 0;
+    uint64_t list_delay = 0;
+    srv.handler = [&](const std::string &, const std::string &path) {
+        fake_ctrl::response r;
+        if (path.find("/current-identity/edge-routers") != std::string::npos) {
+            r.body = fake_ctrl::page("[]", 0, 25, 0);
+        } else if (path.find("/current-api-session/service-updates") != std::string::npos) {
+            r.body = fake_ctrl::data(R"({"lastChangeAt":"2024-01-01T00:00:00Z"})");
+            r.delay = update_delay;
+        } else if (path.find("/services") != std::string::npos) {
+            r.body = fake_ctrl::page(R"([{"id":"s1","name":"service1","permissions":["Dial"],"postureQueries":[]}])", 0, 25, 1);
+            r.delay = list_delay;
+        } else {
+            r.code = 404;
+            r.body = fake_ctrl::error("NOT_FOUND", "not found");
+        }
+        return r;
+    };
+
+    SECTION("update check completes first") {
+        list_delay = 100;
+        authenticated();
+        CHECK(ztx->initial_list_pending);
+        run_until([&] { return service_events > 0; });
+        REQUIRE(ztx->last_update != nullptr);
+        CHECK(std::string(ztx->last_update) == "2024-01-01T00:00:00Z");
+    }
+
+    SECTION("service list completes first") {
+        update_delay = 100;
+        authenticated();
+        run_until([&] { return service_events > 0; });
+        run_until([&] { return srv.count("/current-api-session/service-updates") == 1 &&
+                               ztx->ctrl.active_reqs == 0; });
+        // marker may be newer than the list, next poll has to fetch services
+        CHECK(ztx->last_update == nullptr);
+    }
+
+    // requests are issued together, without waiting for each other
+    CHECK(srv.count("/current-identity/edge-routers") == 1);
+    CHECK(srv.count("/current-api-session/service-updates") == 1);
+    CHECK(srv.count("/services") == 1);
+
+    run_for(200);
+    CHECK_FALSE(ztx->initial_list_pending);
+    CHECK(service_events == 1);
+    CHECK(srv.count("/services") == 1);
+    CHECK(model_map_get(&ztx->services, "service1") != nullptr);
+}